@@ -21,7 +21,12 @@
 #include <android-base/scopeguard.h>
 #include <nnapi/SharedMemory.h>
 #include <nnapi/TypeUtils.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <utility>
@@ -66,8 +71,9 @@ class OperationExecutionContext : public IOperationExecutionContext {
     DISALLOW_IMPLICIT_CONSTRUCTORS(OperationExecutionContext);
 
    public:
-    OperationExecutionContext(const Operation* operation, RunTimeOperandInfo* operands)
-        : operation(operation), operands(operands) {}
+    OperationExecutionContext(const Operation* operation, RunTimeOperandInfo* operands,
+                              OperationCache* cache)
+        : operation(operation), operands(operands), cache(cache) {}
 
     uint32_t getNumInputs() const override;
     OperandType getInputType(uint32_t index) const override;
@@ -87,6 +93,12 @@ class OperationExecutionContext : public IOperationExecutionContext {
 
     bool isOmittedInput(uint32_t index) const override;
     bool isOmittedOutput(uint32_t index) const override;
+    bool isConstantInput(uint32_t index) const override;
+
+    bool hasOperationCache() const override;
+    std::shared_ptr<const void> getCachedData(uint32_t tag) const override;
+    void setCachedData(uint32_t tag, std::shared_ptr<const void> data) override;
+    float getHybridWeightsTolerance() const override;
 
     // Return false if any of inputs or outputs is omitted, i.e. has lifetime of NO_VALUE.
     bool checkNoOmittedOperand() const;
@@ -100,6 +112,7 @@ class OperationExecutionContext : public IOperationExecutionContext {
 
     const Operation* operation;
     RunTimeOperandInfo* operands;
+    OperationCache* cache;
 
     int result = ANEURALNETWORKS_NO_ERROR;
 };
@@ -253,6 +266,28 @@ bool OperationExecutionContext::isOmittedOutput(uint32_t index) const {
     return getOutputInfo(index)->lifetime == Operand::LifeTime::NO_VALUE;
 }
 
+bool OperationExecutionContext::isConstantInput(uint32_t index) const {
+    return getInputInfo(index)->isConstant();
+}
+
+bool OperationExecutionContext::hasOperationCache() const {
+    return cache != nullptr;
+}
+
+std::shared_ptr<const void> OperationExecutionContext::getCachedData(uint32_t tag) const {
+    return cache != nullptr ? cache->get(operation, tag) : nullptr;
+}
+
+void OperationExecutionContext::setCachedData(uint32_t tag, std::shared_ptr<const void> data) {
+    if (cache != nullptr) {
+        cache->set(operation, tag, std::move(data));
+    }
+}
+
+float OperationExecutionContext::getHybridWeightsTolerance() const {
+    return cache != nullptr ? cache->getHybridWeightsTolerance() : 0.0f;
+}
+
 bool OperationExecutionContext::checkNoOmittedOperand() const {
     for (uint32_t i = 0; i < operation->inputs.size(); i++) {
         NN_RET_CHECK(!isOmittedInput(i))
@@ -362,6 +397,61 @@ const SharedMemory& RunTimePoolInfo::getMemory() const {
     return mImpl->getMemory();
 }
 
+bool RunTimePoolInfo::advise(AccessHint hint, uint32_t offset, uint32_t length) const {
+    return adviseRanges(hint, {{offset, length}});
+}
+
+bool RunTimePoolInfo::adviseRanges(AccessHint hint,
+                                   std::vector<std::pair<uint32_t, uint32_t>> ranges) const {
+    int advice = 0;
+    switch (hint) {
+        case AccessHint::WILL_NEED:
+            advice = MADV_WILLNEED;
+            break;
+        case AccessHint::HUGE_PAGES:
+#ifdef MADV_HUGEPAGE
+            advice = MADV_HUGEPAGE;
+            break;
+#else
+            return false;
+#endif  // MADV_HUGEPAGE
+    }
+    static const uintptr_t kPageSize = getpagesize();
+    const uint32_t size = getSize();
+    const uintptr_t buffer = reinterpret_cast<uintptr_t>(getBuffer());
+    bool result = true;
+    // The range of addresses to advise next, which starts at a page boundary.
+    // Ranges that overlap or touch the same page are merged into it.
+    uintptr_t begin = 0, end = 0;
+    const auto adviseMerged = [&] {
+        if (begin != end && madvise(reinterpret_cast<void*>(begin), end - begin, advice) != 0) {
+            VLOG(CPUEXE) << "madvise(" << advice << ") failed: " << strerror(errno);
+            result = false;
+        }
+    };
+    std::sort(ranges.begin(), ranges.end());
+    for (auto [offset, length] : ranges) {
+        if (offset >= size) {
+            result = false;
+            continue;
+        }
+        if (length == 0 || length > size - offset) {
+            length = size - offset;
+        }
+        const uintptr_t rangeBegin = (buffer + offset) & ~(kPageSize - 1);
+        const uintptr_t rangeEnd = buffer + offset + length;
+        if (begin != end && rangeBegin <= ((end + kPageSize - 1) & ~(kPageSize - 1))) {
+            end = std::max(end, rangeEnd);
+        } else {
+            adviseMerged();
+            begin = rangeBegin;
+            end = rangeEnd;
+        }
+    }
+    adviseMerged();
+    return result;
+}
+
 bool setRunTimePoolInfosFromCanonicalMemories(std::vector<RunTimePoolInfo>* poolInfos,
                                               const std::vector<SharedMemory>& pools) {
     CHECK(poolInfos != nullptr);
@@ -402,6 +492,18 @@ bool setRunTimePoolInfosFromMemoryPools(std::vector<RunTimePoolInfo>* poolInfos,
     return true;
 }
 
+std::shared_ptr<const void> OperationCache::get(const Operation* operation, uint32_t tag) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    const auto it = mData.find({operation, tag});
+    return it != mData.end() ? it->second : nullptr;
+}
+
+void OperationCache::set(const Operation* operation, uint32_t tag,
+                         std::shared_ptr<const void> data) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mData[{operation, tag}] = std::move(data);
+}
+
 #ifdef NN_INCLUDE_CPU_IMPLEMENTATION
 template <typename T>
 inline bool convertToNhwcImpl(T* to, const T* from, const std::vector<uint32_t>& fromDim) {
@@ -720,6 +822,10 @@ int CpuExecutor::executeOperation(const Operation& operation, RunTimeOperandInfo
     if (hasDeadlinePassed(mDeadline)) {
         return ANEURALNETWORKS_MISSED_DEADLINE_TRANSIENT;
     }
+    if (isCancelled()) {
+        VLOG(CPUEXE) << "CpuExecutor::executeOperation: cancelled";
+        return ANEURALNETWORKS_OP_FAILED;
+    }
     if (operation.type == OperationType::IF) {
         int result = executeIfOperation(operation, operands);
         if (result != ANEURALNETWORKS_NO_ERROR) {
@@ -1086,7 +1192,7 @@ int CpuExecutor::executeOperation(const Operation& operation, RunTimeOperandInfo
             RunTimeOperandInfo& output = operands[outs[SVDF::kOutputTensor]];
 
             Shape stateShape, outputShape;
-            SVDF svdf(operation, operands);
+            SVDF svdf(operation, operands, mOperationCache);
 
             success = SVDF::Prepare(operation, operands, &stateShape, &outputShape) &&
                       setInfoAndAllocateIfNeeded(&stateOut, stateShape, &result) &&
@@ -1653,7 +1759,7 @@ int CpuExecutor::executeOperation(const Operation& operation, RunTimeOperandInfo
                        operationRegistration->execute == nullptr) {
                 LOG(ERROR) << "Incomplete operation registration: " << operation.type;
             } else {
-                OperationExecutionContext context(&operation, operands);
+                OperationExecutionContext context(&operation, operands, mOperationCache);
                 success = operationRegistration->flags.allowOmittedOperand ||
                           context.checkNoOmittedOperand();
                 success = success && (operationRegistration->flags.allowZeroSizedInput ||
@@ -1814,6 +1920,11 @@ int CpuExecutor::executeWhileOperation(const Operation& operation, RunTimeOperan
                        << " ms";
             return ANEURALNETWORKS_MISSED_DEADLINE_TRANSIENT;
         }
+        if (isCancelled()) {
+            VLOG(CPUEXE) << "CpuExecutor::executeWhileOperation: cancelled after " << iteration
+                         << " iterations";
+            return ANEURALNETWORKS_OP_FAILED;
+        }
 
         // Set body inputs from condition inputs.
         for (uint32_t i = 0, n = bodySubgraph.inputIndexes.size(); i < n; ++i) {
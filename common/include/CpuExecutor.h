@@ -18,11 +18,16 @@
 #define ANDROID_FRAMEWORKS_ML_NN_COMMON_CPU_EXECUTOR_H
 
 #include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
 #include <nnapi/Types.h>
 
 #include <algorithm>
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "ControlFlow.h"
@@ -83,6 +88,13 @@ struct RunTimeOperandInfo {
         };
     }
 
+    // Whether the value is a constant of the model, i.e. the same for every execution.
+    bool isConstant() const {
+        return lifetime == Operand::LifeTime::CONSTANT_COPY ||
+               lifetime == Operand::LifeTime::CONSTANT_REFERENCE ||
+               lifetime == Operand::LifeTime::POINTER;
+    }
+
     bool isSufficient() const {
         if (isExtension(type)) {
             // We don't know sizes of extension types.
@@ -108,11 +120,32 @@ class RunTimePoolInfo {
     static std::optional<RunTimePoolInfo> createFromMemory(const SharedMemory& memory);
     static RunTimePoolInfo createFromExistingBuffer(uint8_t* buffer, uint32_t size = 0);
 
+    // How a range of the pool is going to be accessed (see madvise(2)).
+    enum class AccessHint {
+        // The range will be read soon, so the kernel may start reading a
+        // file-backed range ahead of the first access.
+        WILL_NEED,
+        // The range is large and long-lived, and may be backed by huge pages
+        // where the kernel supports it.
+        HUGE_PAGES,
+    };
+
     uint8_t* getBuffer() const;
     bool flush() const;
     const SharedMemory& getMemory() const;
     uint32_t getSize() const;
 
+    // Gives the kernel a hint about the "length" bytes at "offset", extended
+    // to whole pages. A "length" of 0 means up to the end of the pool.
+    // Returns false if the hint is not supported, which is harmless.
+    bool advise(AccessHint hint, uint32_t offset = 0, uint32_t length = 0) const;
+
+    // Gives the kernel a hint about each of the (offset, length) "ranges", as
+    // advise() does, with one madvise(2) call for each run of ranges whose
+    // pages overlap or are adjacent. Returns false if the hint is not
+    // supported for one of them.
+    bool adviseRanges(AccessHint hint, std::vector<std::pair<uint32_t, uint32_t>> ranges) const;
+
    private:
     class RunTimePoolInfoImpl;
     RunTimePoolInfo(const std::shared_ptr<const RunTimePoolInfoImpl>& impl);
@@ -126,6 +159,53 @@ bool setRunTimePoolInfosFromCanonicalMemories(std::vector<RunTimePoolInfo>* pool
 bool setRunTimePoolInfosFromMemoryPools(std::vector<RunTimePoolInfo>* poolInfos,
                                         const std::vector<Request::MemoryPool>& pools);
 
+// Keeps data derived by operations from information that is fixed for the lifetime of a model,
+// e.g. lookup tables keyed on quantization parameters, so that it is computed during the first
+// execution of a prepared model and reused by all later executions.
+//
+// Entries are keyed by the address of the Operation within the Model, so a cache must only be
+// used with the Model it was first used with and must not outlive it. The class is thread-safe.
+//
+// The cache also carries the options that decide what is derived. A non-zero
+// hybridWeightsTolerance lets float operations with large constant weights quantize them to int8
+// and run hybrid kernels when the relative error of the quantized weights is within the
+// tolerance, see HybridWeights.h.
+class OperationCache {
+    DISALLOW_COPY_AND_ASSIGN(OperationCache);
+
+   public:
+    OperationCache() = default;
+    explicit OperationCache(float hybridWeightsTolerance)
+        : kHybridWeightsTolerance(hybridWeightsTolerance) {}
+
+    std::shared_ptr<const void> get(const Operation* operation, uint32_t tag) const;
+    void set(const Operation* operation, uint32_t tag, std::shared_ptr<const void> data);
+
+    // Returns the data of type T cached for "operation" under "tag". If there is none, caches and
+    // returns the result of "create". This is IOperationExecutionContext::getOrCreateCachedData
+    // for operations that are not implemented through an OperationResolver.
+    template <typename T, typename Create>
+    std::shared_ptr<const T> getOrCreate(const Operation* operation, uint32_t tag,
+                                         Create&& create) {
+        auto data = std::static_pointer_cast<const T>(get(operation, tag));
+        if (data == nullptr) {
+            data = std::forward<Create>(create)();
+            set(operation, tag, data);
+        }
+        return data;
+    }
+
+    float getHybridWeightsTolerance() const { return kHybridWeightsTolerance; }
+
+   private:
+    using Key = std::pair<const Operation*, uint32_t>;
+
+    const float kHybridWeightsTolerance = 0.0f;
+
+    mutable std::mutex mMutex;
+    std::map<Key, std::shared_ptr<const void>> mData GUARDED_BY(mMutex);
+};
+
 // This class is used to execute a model on the CPU.
 class CpuExecutor {
    public:
@@ -158,6 +238,15 @@ class CpuExecutor {
     void setDeadline(const TimePoint& deadline) { mDeadline = deadline; }
     void setLoopTimeout(uint64_t duration) { mLoopTimeoutDuration = duration; }
 
+    // Lets another thread cancel the execution: once "*cancelled" is true, the
+    // execution fails with ANEURALNETWORKS_OP_FAILED before its next operation
+    // or WHILE iteration. The flag must outlive the executor.
+    void setCancellationFlag(const std::atomic<bool>* cancelled) { mCancelled = cancelled; }
+
+    // Lets operations reuse data cached by previous executions. The cache must belong to the
+    // model passed to run() and must outlive the executor.
+    void setOperationCache(OperationCache* cache) { mOperationCache = cache; }
+
    private:
     // Creates runtime info from what's in the model.
     std::vector<RunTimeOperandInfo> initializeRunTimeInfo(const Model::Subgraph& subgraph);
@@ -177,6 +266,10 @@ class CpuExecutor {
     void setOutputShapes(const std::vector<uint32_t>& outputIndexes,
                          const std::vector<RunTimeOperandInfo>& operands);
 
+    bool isCancelled() const {
+        return mCancelled != nullptr && mCancelled->load(std::memory_order_relaxed);
+    }
+
     // Compile-time operand value information used by initializeRunTimeInfo.
     // The fields are only valid while run() is being executed.
     const uint8_t* mModelOperandValues = nullptr;
@@ -198,6 +291,12 @@ class CpuExecutor {
     // WHILE loop.
     uint64_t mLoopTimeoutDuration = operation_while::kTimeoutNsDefault;
 
+    // Optional flag set when the execution is cancelled.
+    const std::atomic<bool>* mCancelled = nullptr;
+
+    // Optional cache of data derived by operations, shared by all executions of a prepared model.
+    OperationCache* mOperationCache = nullptr;
+
     const IOperationResolver* mOperationResolver;
 };
 
@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "nnapi/TypeUtils.h"
@@ -91,6 +93,24 @@ class IOperationExecutionContext {
     virtual bool isOmittedInput(uint32_t index) const = 0;
     virtual bool isOmittedOutput(uint32_t index) const = 0;
 
+    // Returns true if the input is a constant of the model, i.e. its value is the same for every
+    // execution of the model.
+    virtual bool isConstantInput(uint32_t index) const { return false; }
+
+    // Returns true if the executor keeps data cached by this operation across executions, see
+    // OperationCache in CpuExecutor.h.
+    virtual bool hasOperationCache() const { return false; }
+
+    // Returns the data this operation cached under "tag", or nullptr if there is none.
+    virtual std::shared_ptr<const void> getCachedData(uint32_t tag) const { return nullptr; }
+
+    // Caches "data" for this operation under "tag". Does nothing if hasOperationCache() is false.
+    virtual void setCachedData(uint32_t tag, std::shared_ptr<const void> data) {}
+
+    // Returns the tolerance for the hybrid execution of float operations with constant weights,
+    // or 0 if hybrid execution is disabled, see OperationCache.
+    virtual float getHybridWeightsTolerance() const { return 0.0f; }
+
     template <typename T>
     const T* getInputBuffer(uint32_t index) const {
         return reinterpret_cast<const T*>(getInputBuffer(index));
@@ -105,6 +125,19 @@ class IOperationExecutionContext {
     T getInputValue(uint32_t index) const {
         return getInputBuffer<T>(index)[0];
     }
+
+    // Returns the data this operation cached under "tag", creating it with "create" if necessary.
+    // The data must only depend on information that is fixed for the lifetime of the model, such
+    // as operand types, quantization parameters and constant operand values.
+    template <typename T, typename Create>
+    std::shared_ptr<const T> getOrCreateCachedData(uint32_t tag, Create&& create) {
+        auto data = std::static_pointer_cast<const T>(getCachedData(tag));
+        if (data == nullptr) {
+            data = std::forward<Create>(create)();
+            setCachedData(tag, data);
+        }
+        return data;
+    }
 };
 
 // Verifies that the number and types of operation inputs are as expected.
@@ -33,6 +33,7 @@
 #include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
 
 #include "CpuOperationUtils.h"
+#include "QuantizedLookupTable.h"
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 namespace android {
@@ -542,15 +543,17 @@ bool executeLogistic(IOperationExecutionContext* context) {
                                  context->getOutputBuffer<float>(kOutputTensor),
                                  context->getOutputShape(kOutputTensor));
         case OperandType::TENSOR_QUANT8_ASYMM:
-            return logisticQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
-                                  context->getInputShape(kInputTensor),
-                                  context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                  context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<uint8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<uint8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), logisticQuant8);
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
-            return logisticQuant8Signed(context->getInputBuffer<int8_t>(kInputTensor),
-                                        context->getInputShape(kInputTensor),
-                                        context->getOutputBuffer<int8_t>(kOutputTensor),
-                                        context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<int8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<int8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), logisticQuant8Signed);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation LOGISTIC";
     }
@@ -571,15 +574,17 @@ bool executeTanh(IOperationExecutionContext* context) {
                                context->getOutputBuffer<float>(kOutputTensor),
                                context->getOutputShape(kOutputTensor));
         case OperandType::TENSOR_QUANT8_ASYMM:
-            return tanhQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
-                              context->getInputShape(kInputTensor),
-                              context->getOutputBuffer<uint8_t>(kOutputTensor),
-                              context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<uint8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<uint8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), tanhQuant8);
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
-            return tanhQuant8Signed(context->getInputBuffer<int8_t>(kInputTensor),
-                                    context->getInputShape(kInputTensor),
-                                    context->getOutputBuffer<int8_t>(kOutputTensor),
-                                    context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<int8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<int8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), tanhQuant8Signed);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation TANH";
     }
@@ -610,15 +615,17 @@ bool executeHardSwish(IOperationExecutionContext* context) {
             return true;
         }
         case OperandType::TENSOR_QUANT8_ASYMM:
-            return hardSwishQuant(context->getInputBuffer<uint8_t>(kInputTensor),
-                                  context->getInputShape(kInputTensor),
-                                  context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                  context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<uint8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<uint8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), hardSwishQuant<uint8_t>);
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
-            return hardSwishQuant(context->getInputBuffer<int8_t>(kInputTensor),
-                                  context->getInputShape(kInputTensor),
-                                  context->getOutputBuffer<int8_t>(kOutputTensor),
-                                  context->getOutputShape(kOutputTensor));
+            return evalWithQuantizedLookupTable(
+                    context, context->getInputBuffer<int8_t>(kInputTensor),
+                    context->getInputShape(kInputTensor),
+                    context->getOutputBuffer<int8_t>(kOutputTensor),
+                    context->getOutputShape(kOutputTensor), hardSwishQuant<int8_t>);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation TANH";
     }
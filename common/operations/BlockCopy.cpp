@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Operations"
+
+#include "BlockCopy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "OperationsUtils.h"
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// Copies "count" elements of kElementSize bytes that are "inputStride" bytes apart in the input
+// and contiguous in the output. The fixed size lets the compiler turn each memcpy into a move.
+template <uint32_t kElementSize>
+void gatherElements(const uint8_t* input, uint64_t inputStride, uint32_t count, uint8_t* output) {
+    for (uint32_t i = 0; i < count; ++i, input += inputStride, output += kElementSize) {
+        std::memcpy(output, input, kElementSize);
+    }
+}
+
+}  // namespace
+
+bool BlockCopyPlan::initialize(uint32_t elementSize, const BlockCopyDimension* dimensions,
+                               uint32_t numDimensions) {
+    mElementSize = elementSize;
+    mNumDimensions = 0;
+    uint32_t inputStrides[kMaxBlockCopyDimensions];
+    for (uint32_t i = 0; i < numDimensions; ++i) {
+        const BlockCopyDimension& dimension = dimensions[i];
+        if (dimension.size == 0) {
+            // The output is empty.
+            mNumDimensions = 0;
+            mRunSize = 0;
+            return true;
+        }
+        if (dimension.size == 1) {
+            continue;
+        }
+        if (mNumDimensions > 0 && inputStrides[mNumDimensions - 1] ==
+                                          static_cast<uint64_t>(dimension.inputStride) *
+                                                  dimension.size) {
+            // The previous dimension steps over exactly one slice of this one, so the two
+            // dimensions can be walked as one.
+            mSizes[mNumDimensions - 1] *= dimension.size;
+            inputStrides[mNumDimensions - 1] = dimension.inputStride;
+            continue;
+        }
+        NN_RET_CHECK_LT(mNumDimensions, kMaxBlockCopyDimensions);
+        mSizes[mNumDimensions] = dimension.size;
+        inputStrides[mNumDimensions] = dimension.inputStride;
+        ++mNumDimensions;
+    }
+
+    mRunSize = elementSize;
+    if (mNumDimensions > 0 && inputStrides[mNumDimensions - 1] == 1) {
+        --mNumDimensions;
+        mRunSize *= mSizes[mNumDimensions];
+    }
+    uint64_t outputStride = mRunSize;
+    for (uint32_t i = mNumDimensions; i-- > 0;) {
+        mInputStrides[i] = static_cast<uint64_t>(inputStrides[i]) * elementSize;
+        mOutputStrides[i] = outputStride;
+        outputStride *= mSizes[i];
+    }
+    return true;
+}
+
+void BlockCopyPlan::execute(const void* input, void* output) const {
+    if (isIdentity() && input == output) {
+        return;
+    }
+    copy(0, static_cast<const uint8_t*>(input), static_cast<uint8_t*>(output));
+}
+
+void BlockCopyPlan::copy(uint32_t dimension, const uint8_t* input, uint8_t* output) const {
+    if (dimension == mNumDimensions) {
+        std::memcpy(output, input, mRunSize);
+        return;
+    }
+    const uint32_t size = mSizes[dimension];
+    const uint64_t inputStride = mInputStrides[dimension];
+    const uint64_t outputStride = mOutputStrides[dimension];
+
+    if (inputStride == 0) {
+        // Broadcast: produce the first slice, then replicate the already written output,
+        // doubling the replicated region on every memcpy.
+        copy(dimension + 1, input, output);
+        const uint64_t total = outputStride * size;
+        for (uint64_t done = outputStride; done < total;) {
+            const uint64_t count = std::min(done, total - done);
+            std::memcpy(output + done, output, count);
+            done += count;
+        }
+        return;
+    }
+
+    if (dimension + 1 == mNumDimensions && mRunSize == mElementSize) {
+        switch (mElementSize) {
+            case 1:
+                gatherElements<1>(input, inputStride, size, output);
+                return;
+            case 2:
+                gatherElements<2>(input, inputStride, size, output);
+                return;
+            case 4:
+                gatherElements<4>(input, inputStride, size, output);
+                return;
+            default:
+                break;
+        }
+    }
+    for (uint32_t i = 0; i < size; ++i, input += inputStride, output += outputStride) {
+        copy(dimension + 1, input, output);
+    }
+}
+
+}  // namespace nn
+}  // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_COPY_H
+#define ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_COPY_H
+
+#include <array>
+#include <cstdint>
+
+namespace android {
+namespace nn {
+
+// A block copy engine for pure data movement operations such as DEPTH_TO_SPACE, SPACE_TO_DEPTH,
+// BATCH_TO_SPACE_ND, SPACE_TO_BATCH_ND, CHANNEL_SHUFFLE and TILE.
+//
+// The output is written contiguously and is described as a row-major view over a list of
+// dimensions, each of which advances the input by a fixed stride. For example, DEPTH_TO_SPACE on
+// an NHWC tensor writes the output viewed as [batches, height, block, width, block, depth]. An
+// input stride of 0 broadcasts the input along that dimension, which expresses TILE.
+//
+// Planning drops unit dimensions and merges adjacent dimensions that are contiguous in the input,
+// so that the copy is issued as memcpy runs that are as long as possible. The engine only looks
+// at the element size, so all data types share the same code and are copied bit-exactly.
+
+// The view of an operation may have up to this many dimensions after unit dimensions are dropped.
+constexpr uint32_t kMaxBlockCopyDimensions = 16;
+
+struct BlockCopyDimension {
+    uint32_t size;
+    // In elements.
+    uint32_t inputStride;
+};
+
+class BlockCopyPlan {
+   public:
+    // Plans the copy of the view described by the "numDimensions" entries of "dimensions", from
+    // the outermost to the innermost. Returns false if the view has too many dimensions.
+    bool initialize(uint32_t elementSize, const BlockCopyDimension* dimensions,
+                    uint32_t numDimensions);
+
+    // Copies from "input" to "output", which must not overlap unless they are the same buffer and
+    // the plan is the identity, in which case nothing is copied.
+    void execute(const void* input, void* output) const;
+
+    // Whether the output is a plain copy of the input.
+    bool isIdentity() const { return mNumDimensions == 0; }
+
+   private:
+    void copy(uint32_t dimension, const uint8_t* input, uint8_t* output) const;
+
+    uint32_t mElementSize = 0;
+    // The number of bytes in each contiguous run, i.e. the innermost merged dimension when it is
+    // contiguous in the input, or a single element otherwise.
+    uint32_t mRunSize = 0;
+    // The dimensions around the runs, from the outermost to the innermost, with strides in bytes.
+    uint32_t mNumDimensions = 0;
+    std::array<uint32_t, kMaxBlockCopyDimensions> mSizes;
+    std::array<uint64_t, kMaxBlockCopyDimensions> mInputStrides;
+    std::array<uint64_t, kMaxBlockCopyDimensions> mOutputStrides;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_COPY_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "BlockCopy.h"
+
+namespace android {
+namespace nn {
+namespace {
+
+// Evaluates the view element by element.
+template <typename T>
+std::vector<T> referenceCopy(const std::vector<T>& input,
+                             const std::vector<BlockCopyDimension>& dimensions) {
+    uint32_t numElements = 1;
+    for (const auto& dimension : dimensions) {
+        numElements *= dimension.size;
+    }
+    std::vector<T> output(numElements);
+    for (uint32_t i = 0; i < numElements; ++i) {
+        uint32_t remainder = i;
+        uint32_t inputIndex = 0;
+        for (uint32_t d = dimensions.size(); d-- > 0;) {
+            inputIndex += (remainder % dimensions[d].size) * dimensions[d].inputStride;
+            remainder /= dimensions[d].size;
+        }
+        output[i] = input[inputIndex];
+    }
+    return output;
+}
+
+template <typename T>
+void testCopy(uint32_t inputSize, const std::vector<BlockCopyDimension>& dimensions) {
+    std::vector<T> input(inputSize);
+    std::iota(input.begin(), input.end(), static_cast<T>(1));
+    const std::vector<T> expected = referenceCopy(input, dimensions);
+
+    BlockCopyPlan plan;
+    ASSERT_TRUE(plan.initialize(sizeof(T), dimensions.data(), dimensions.size()));
+    std::vector<T> output(expected.size());
+    plan.execute(input.data(), output.data());
+    EXPECT_EQ(output, expected);
+}
+
+template <typename T>
+void testAllViews() {
+    // DEPTH_TO_SPACE of a [2, 3, 5, 8] tensor with a block size of 2.
+    testCopy<T>(240, {{2, 120}, {3, 40}, {2, 4}, {5, 8}, {2, 2}, {2, 1}});
+    // SPACE_TO_DEPTH of a [2, 4, 6, 3] tensor with a block size of 2.
+    testCopy<T>(144, {{2, 72}, {2, 36}, {3, 6}, {2, 18}, {2, 3}, {3, 1}});
+    // BATCH_TO_SPACE_ND of a [6, 2, 3, 5] tensor with a [3, 2] block.
+    testCopy<T>(180, {{1, 30}, {2, 15}, {3, 60}, {3, 5}, {2, 30}, {5, 1}});
+    // CHANNEL_SHUFFLE of a [3, 12, 4] tensor with 3 groups along axis 1.
+    testCopy<T>(144, {{3, 48}, {4, 4}, {3, 16}, {4, 1}});
+    // CHANNEL_SHUFFLE of a [5, 12] tensor with 4 groups along the innermost axis.
+    testCopy<T>(60, {{5, 12}, {3, 1}, {4, 3}, {1, 1}});
+    // TILE of a [2, 3] tensor with multiples [3, 2].
+    testCopy<T>(6, {{3, 0}, {2, 3}, {2, 0}, {3, 1}});
+    // TILE of a [4, 1] tensor with multiples [1, 7], which broadcasts single elements.
+    testCopy<T>(4, {{1, 0}, {4, 1}, {7, 0}, {1, 1}});
+}
+
+TEST(BlockCopyTest, Int8) {
+    testAllViews<int8_t>();
+}
+
+TEST(BlockCopyTest, Float16) {
+    testAllViews<_Float16>();
+}
+
+TEST(BlockCopyTest, Float32) {
+    testAllViews<float>();
+}
+
+TEST(BlockCopyTest, Int64) {
+    testAllViews<int64_t>();
+}
+
+TEST(BlockCopyTest, ContiguousViewIsIdentity) {
+    // CHANNEL_SHUFFLE with a single group.
+    const BlockCopyDimension dimensions[] = {{3, 48}, {12, 4}, {1, 48}, {4, 1}};
+    BlockCopyPlan plan;
+    ASSERT_TRUE(plan.initialize(sizeof(float), dimensions, std::size(dimensions)));
+    EXPECT_TRUE(plan.isIdentity());
+
+    std::vector<float> data(144);
+    std::iota(data.begin(), data.end(), 0.0f);
+    const std::vector<float> expected = data;
+    plan.execute(data.data(), data.data());
+    EXPECT_EQ(data, expected);
+
+    std::vector<float> output(data.size());
+    plan.execute(data.data(), output.data());
+    EXPECT_EQ(output, expected);
+}
+
+TEST(BlockCopyTest, ShuffleIsNotIdentity) {
+    const BlockCopyDimension dimensions[] = {{3, 48}, {4, 4}, {3, 16}, {4, 1}};
+    BlockCopyPlan plan;
+    ASSERT_TRUE(plan.initialize(sizeof(float), dimensions, std::size(dimensions)));
+    EXPECT_FALSE(plan.isIdentity());
+}
+
+TEST(BlockCopyTest, EmptyOutput) {
+    const BlockCopyDimension dimensions[] = {{3, 4}, {0, 1}};
+    BlockCopyPlan plan;
+    ASSERT_TRUE(plan.initialize(sizeof(float), dimensions, std::size(dimensions)));
+    plan.execute(nullptr, nullptr);
+}
+
+TEST(BlockCopyTest, TooManyDimensions) {
+    // Alternating strides prevent any merging.
+    std::vector<BlockCopyDimension> dimensions;
+    uint32_t stride = 1;
+    for (uint32_t i = 0; i <= kMaxBlockCopyDimensions; ++i) {
+        dimensions.insert(dimensions.begin(), {2, stride});
+        stride *= 3;
+    }
+    BlockCopyPlan plan;
+    EXPECT_FALSE(plan.initialize(sizeof(float), dimensions.data(), dimensions.size()));
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_SPARSE_MATRIX_H
+#define ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_SPARSE_MATRIX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Tracing.h"
+
+namespace android {
+namespace nn {
+
+// A row-major matrix in blocked compressed sparse row (CSR) format.
+//
+// Every row is split into blocks of kBlockSize consecutive columns and only the blocks that contain
+// a non-zero value are stored. Compared to plain CSR this keeps one column index per block instead
+// of one per value and lets the inner loop work on short contiguous runs of the input.
+//
+// ValueT is the type the values are stored and multiplied in. Quantized weights are stored with
+// their zero point already subtracted, e.g. as int16_t, so that a stored zero is a real zero.
+template <typename ValueT>
+class BlockSparseMatrix {
+   public:
+    static constexpr uint32_t kBlockSize = 4;
+
+    // Builds the matrix from the row-major "data". Elements equal to "zero" are treated as zeros
+    // and every stored element is converted to ValueT(element) - ValueT(zero).
+    template <typename T>
+    BlockSparseMatrix(const T* data, uint32_t numRows, uint32_t numColumns, T zero)
+        : mNumRows(numRows), mNumColumns(numColumns) {
+        NNTRACE_COMP("BlockSparseMatrix::BlockSparseMatrix");
+        mRowBegins.reserve(numRows + 1);
+        mRowBegins.push_back(0);
+        for (uint32_t row = 0; row < numRows; ++row) {
+            const T* rowData = data + static_cast<size_t>(row) * numColumns;
+            for (uint32_t column = 0; column < numColumns; column += kBlockSize) {
+                const uint32_t width = std::min(kBlockSize, numColumns - column);
+                if (std::all_of(rowData + column, rowData + column + width,
+                                [zero](T value) { return value == zero; })) {
+                    continue;
+                }
+                mBlockColumns.push_back(column);
+                for (uint32_t i = 0; i < kBlockSize; ++i) {
+                    mValues.push_back(i < width ? static_cast<ValueT>(rowData[column + i]) -
+                                                          static_cast<ValueT>(zero)
+                                                : ValueT(0));
+                }
+            }
+            mRowBegins.push_back(mBlockColumns.size());
+        }
+    }
+
+    uint32_t getNumRows() const { return mNumRows; }
+    uint32_t getNumColumns() const { return mNumColumns; }
+
+    // The fraction of blocks that are stored.
+    float getBlockDensity() const {
+        const uint64_t numBlocks =
+                static_cast<uint64_t>(mNumRows) * ((mNumColumns + kBlockSize - 1) / kBlockSize);
+        return numBlocks == 0 ? 0.0f : static_cast<float>(mBlockColumns.size()) / numBlocks;
+    }
+
+    // Returns the dot product of "row" with "input", which has getNumColumns() elements. The
+    // products are accumulated in AccT, in increasing column order.
+    template <typename AccT, typename InputT>
+    AccT dotRow(uint32_t row, const InputT* input) const {
+        AccT acc = 0;
+        const uint32_t end = mRowBegins[row + 1];
+        for (uint32_t block = mRowBegins[row]; block < end; ++block) {
+            const uint32_t column = mBlockColumns[block];
+            const ValueT* values = mValues.data() + static_cast<size_t>(block) * kBlockSize;
+            const InputT* in = input + column;
+            if (column + kBlockSize <= mNumColumns) {
+                for (uint32_t i = 0; i < kBlockSize; ++i) {
+                    acc += static_cast<AccT>(values[i]) * static_cast<AccT>(in[i]);
+                }
+            } else {
+                for (uint32_t i = 0; i < mNumColumns - column; ++i) {
+                    acc += static_cast<AccT>(values[i]) * static_cast<AccT>(in[i]);
+                }
+            }
+        }
+        return acc;
+    }
+
+    // Returns the sum of the stored values of "row".
+    template <typename AccT>
+    AccT sumRow(uint32_t row) const {
+        AccT acc = 0;
+        const auto begin = mValues.begin() + static_cast<size_t>(mRowBegins[row]) * kBlockSize;
+        const auto end = mValues.begin() + static_cast<size_t>(mRowBegins[row + 1]) * kBlockSize;
+        for (auto it = begin; it != end; ++it) {
+            acc += static_cast<AccT>(*it);
+        }
+        return acc;
+    }
+
+   private:
+    uint32_t mNumRows;
+    uint32_t mNumColumns;
+    // The stored blocks of row r are [mRowBegins[r], mRowBegins[r + 1]).
+    std::vector<uint32_t> mRowBegins;
+    // The first column of every stored block.
+    std::vector<uint32_t> mBlockColumns;
+    // kBlockSize values per stored block. Values past the last column are zero.
+    std::vector<ValueT> mValues;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_BLOCK_SPARSE_MATRIX_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "BlockSparseMatrix.h"
+
+namespace android {
+namespace nn {
+namespace {
+
+// Not a multiple of the block size, so that every row ends with a partial block.
+constexpr uint32_t kNumRows = 13;
+constexpr uint32_t kNumColumns = 70;
+
+// Returns a row-major matrix in which each element is "zero" with probability "sparsity".
+template <typename T>
+std::vector<T> makeSparseData(float sparsity, T zero) {
+    std::mt19937 generator(kNumRows * kNumColumns);
+    std::bernoulli_distribution isZero(sparsity);
+    std::uniform_int_distribution<int> value(0, 255);
+    std::vector<T> data(kNumRows * kNumColumns);
+    for (T& element : data) {
+        element = isZero(generator) ? zero : static_cast<T>(value(generator) - 128);
+    }
+    return data;
+}
+
+TEST(BlockSparseMatrixTest, FloatDotRowMatchesDense) {
+    const std::vector<float> data = makeSparseData<float>(0.9f, 0.0f);
+    const BlockSparseMatrix<float> matrix(data.data(), kNumRows, kNumColumns, 0.0f);
+    EXPECT_LT(matrix.getBlockDensity(), 1.0f);
+
+    std::vector<float> input(kNumColumns);
+    for (uint32_t i = 0; i < kNumColumns; ++i) {
+        input[i] = 0.25f * i - 3.0f;
+    }
+    for (uint32_t row = 0; row < kNumRows; ++row) {
+        // Summing the non-zero products in column order is exact for these values.
+        float expected = 0.0f;
+        for (uint32_t column = 0; column < kNumColumns; ++column) {
+            expected += data[row * kNumColumns + column] * input[column];
+        }
+        EXPECT_EQ(matrix.dotRow<float>(row, input.data()), expected) << "row " << row;
+    }
+}
+
+TEST(BlockSparseMatrixTest, QuantizedDotRowMatchesDense) {
+    constexpr uint8_t kZeroPoint = 131;
+    const std::vector<uint8_t> data = makeSparseData<uint8_t>(0.8f, kZeroPoint);
+    const BlockSparseMatrix<int16_t> matrix(data.data(), kNumRows, kNumColumns, kZeroPoint);
+
+    std::vector<uint8_t> input(kNumColumns);
+    for (uint32_t i = 0; i < kNumColumns; ++i) {
+        input[i] = static_cast<uint8_t>(i * 37);
+    }
+    for (uint32_t row = 0; row < kNumRows; ++row) {
+        int32_t expectedDot = 0;
+        int32_t expectedSum = 0;
+        for (uint32_t column = 0; column < kNumColumns; ++column) {
+            const int32_t weight = data[row * kNumColumns + column] - kZeroPoint;
+            expectedDot += weight * input[column];
+            expectedSum += weight;
+        }
+        EXPECT_EQ(matrix.dotRow<int32_t>(row, input.data()), expectedDot) << "row " << row;
+        EXPECT_EQ(matrix.sumRow<int32_t>(row), expectedSum) << "row " << row;
+    }
+}
+
+TEST(BlockSparseMatrixTest, BlockDensity) {
+    std::vector<float> data(kNumRows * kNumColumns, 0.0f);
+    const BlockSparseMatrix<float> empty(data.data(), kNumRows, kNumColumns, 0.0f);
+    EXPECT_EQ(empty.getBlockDensity(), 0.0f);
+
+    // One non-zero value in each row touches one of its 18 blocks.
+    for (uint32_t row = 0; row < kNumRows; ++row) {
+        data[row * kNumColumns + row] = 1.0f;
+    }
+    const BlockSparseMatrix<float> diagonal(data.data(), kNumRows, kNumColumns, 0.0f);
+    EXPECT_FLOAT_EQ(diagonal.getBlockDensity(), 1.0f / 18);
+
+    std::vector<float> input(kNumColumns, 2.0f);
+    for (uint32_t row = 0; row < kNumRows; ++row) {
+        EXPECT_EQ(diagonal.dotRow<float>(row, input.data()), 2.0f);
+    }
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
@@ -16,6 +16,9 @@
 
 #define LOG_TAG "Operations"
 
+#include <iterator>
+
+#include "BlockCopy.h"
 #include "OperationResolver.h"
 #include "OperationsUtils.h"
 #include "Tracing.h"
@@ -41,19 +44,19 @@ inline bool eval(const T* inputData, const Shape& inputShape, int32_t numGroups,
     const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
     const uint32_t innerSize =
             getNumberOfElements(inputShape, axis + 1, getNumberOfDimensions(inputShape));
-    const uint32_t groupSize = axisSize / numGroups;
-    for (uint32_t outer = 0; outer < outerSize; ++outer) {
-        for (uint32_t inner = 0; inner < innerSize; ++inner) {
-            const T* inputBase = inputData + outer * axisSize * innerSize + inner;
-            T* outputBase = outputData + outer * axisSize * innerSize + inner;
-            for (uint32_t i = 0; i < groupSize; i++) {
-                for (uint32_t j = 0; j < static_cast<uint32_t>(numGroups);
-                     j++, outputBase += innerSize) {
-                    *outputBase = inputBase[innerSize * (i + j * groupSize)];
-                }
-            }
-        }
-    }
+    const uint32_t groups = static_cast<uint32_t>(numGroups);
+    const uint32_t groupSize = axisSize / groups;
+    // Output channel i * numGroups + j is input channel j * groupSize + i, so the output is
+    // viewed as [outerSize, groupSize, numGroups, innerSize].
+    const BlockCopyDimension dimensions[] = {
+            {outerSize, axisSize * innerSize},
+            {groupSize, innerSize},
+            {groups, groupSize * innerSize},
+            {innerSize, 1},
+    };
+    BlockCopyPlan plan;
+    NN_RET_CHECK(plan.initialize(sizeof(T), dimensions, std::size(dimensions)));
+    plan.execute(inputData, outputData);
     return true;
 }
 
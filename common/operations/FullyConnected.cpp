@@ -16,6 +16,9 @@
 
 #define LOG_TAG "Operations"
 
+#include <algorithm>
+#include <memory>
+#include <type_traits>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -27,7 +30,9 @@
 #include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
 #include <tensorflow/lite/kernels/internal/types.h>
 
+#include "BlockSparseMatrix.h"
 #include "CpuOperationUtils.h"
+#include "HybridWeights.h"
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 namespace android {
@@ -180,6 +185,172 @@ bool fullyConnectedQuant8(const int8_t* inputData, const Shape& inputShape,
 
     return true;
 }
+
+// Constant weights with at most this fraction of non-zero blocks are multiplied in the blocked CSR
+// format of BlockSparseMatrix instead of densely.
+constexpr float kMaxSparseWeightsBlockDensity = 0.3f;
+// Smaller weights are always multiplied densely.
+constexpr uint32_t kMinSparseWeightsSize = 4096;
+
+// The tag under which the operation caches its SparseWeights.
+constexpr uint32_t kSparseWeightsCacheTag = 0;
+
+// Float weights are stored as they are, quantized ones with the zero point subtracted.
+template <typename T>
+using SparseWeightsValueType = std::conditional_t<std::is_same_v<T, float>, float, int16_t>;
+
+template <typename T>
+struct SparseWeights {
+    // Null if the weights are too dense for the sparse kernels to pay off.
+    std::unique_ptr<const BlockSparseMatrix<SparseWeightsValueType<T>>> matrix;
+    // The sum of every row of the matrix, used to apply the input zero point. Quantized only.
+    std::vector<int32_t> rowSums;
+};
+
+template <typename T>
+std::shared_ptr<const SparseWeights<T>> makeSparseWeights(const T* weightsData,
+                                                          const Shape& weightsShape) {
+    NNTRACE_TRANS("makeSparseWeights");
+    auto weights = std::make_shared<SparseWeights<T>>();
+    if (getNumberOfElements(weightsShape) < kMinSparseWeightsSize) {
+        return weights;
+    }
+    auto matrix = std::make_unique<BlockSparseMatrix<SparseWeightsValueType<T>>>(
+            weightsData, getSizeOfDimension(weightsShape, 0), getSizeOfDimension(weightsShape, 1),
+            static_cast<T>(weightsShape.offset));
+    if (matrix->getBlockDensity() > kMaxSparseWeightsBlockDensity) {
+        return weights;
+    }
+    if constexpr (!std::is_same_v<T, float>) {
+        weights->rowSums.resize(matrix->getNumRows());
+        for (uint32_t row = 0; row < matrix->getNumRows(); ++row) {
+            weights->rowSums[row] = matrix->template sumRow<int32_t>(row);
+        }
+    }
+    weights->matrix = std::move(matrix);
+    return weights;
+}
+
+// Returns the sparse form of the weights, or nullptr if they are to be multiplied densely. The
+// conversion costs a pass over the weights, so it is only done for constant weights and only when
+// the result can be reused by later executions.
+template <typename T>
+std::shared_ptr<const SparseWeights<T>> getSparseWeights(IOperationExecutionContext* context) {
+    if (!context->hasOperationCache() || !context->isConstantInput(kWeightsTensor)) {
+        return nullptr;
+    }
+    auto weights = context->getOrCreateCachedData<SparseWeights<T>>(kSparseWeightsCacheTag, [&] {
+        return makeSparseWeights(context->getInputBuffer<T>(kWeightsTensor),
+                                 context->getInputShape(kWeightsTensor));
+    });
+    return weights->matrix != nullptr ? weights : nullptr;
+}
+
+bool fullyConnectedFloat32Sparse(const float* inputData, const SparseWeights<float>& weights,
+                                 const float* biasData, int32_t activation, float* outputData,
+                                 const Shape& outputShape) {
+    NNTRACE_TRANS("fullyConnectedFloat32Sparse");
+    float outputActivationMin, outputActivationMax;
+    CalculateActivationRangeFloat(activation, &outputActivationMin, &outputActivationMax);
+
+    const auto& matrix = *weights.matrix;
+    const uint32_t batchSize = getSizeOfDimension(outputShape, 0);
+    const uint32_t numUnits = matrix.getNumRows();
+    const uint32_t inputSize = matrix.getNumColumns();
+    NNTRACE_COMP_SWITCH("BlockSparseMatrix::dotRow");
+    for (uint32_t b = 0; b < batchSize; ++b) {
+        const float* input = inputData + b * inputSize;
+        float* output = outputData + b * numUnits;
+        for (uint32_t unit = 0; unit < numUnits; ++unit) {
+            const float value = matrix.dotRow<float>(unit, input) + biasData[unit];
+            output[unit] = std::min(outputActivationMax, std::max(outputActivationMin, value));
+        }
+    }
+    return true;
+}
+
+// Returns the int8 form of the constant float weights if hybrid execution is enabled and the
+// weights qualify, or nullptr if they are used as they are.
+std::shared_ptr<const CachedHybridWeights> getHybridWeights(IOperationExecutionContext* context) {
+    const float tolerance = context->getHybridWeightsTolerance();
+    if (tolerance <= 0.0f || !context->isConstantInput(kWeightsTensor)) {
+        return nullptr;
+    }
+    auto cached = context->getOrCreateCachedData<CachedHybridWeights>(kHybridWeightsCacheTag, [&] {
+        return makeCachedHybridWeights(context->getInputBuffer<float>(kWeightsTensor),
+                                       context->getInputShape(kWeightsTensor), tolerance);
+    });
+    return cached->weights != nullptr ? cached : nullptr;
+}
+
+bool fullyConnectedFloat32Hybrid(const float* inputData, const HybridWeights& weights,
+                                 const float* biasData, int32_t activation, float* outputData,
+                                 const Shape& outputShape) {
+    NNTRACE_TRANS("fullyConnectedFloat32Hybrid");
+    float outputActivationMin, outputActivationMax;
+    CalculateActivationRangeFloat(activation, &outputActivationMin, &outputActivationMax);
+
+    const uint32_t batchSize = getSizeOfDimension(outputShape, 0);
+    const uint32_t numUnits = weights.getNumRows();
+    const uint32_t inputSize = weights.getNumColumns();
+    NNTRACE_COMP_SWITCH("HybridWeights::dotRow");
+    for (uint32_t b = 0; b < batchSize; ++b) {
+        const float* input = inputData + b * inputSize;
+        float* output = outputData + b * numUnits;
+        for (uint32_t unit = 0; unit < numUnits; ++unit) {
+            const float value = weights.dotRow(unit, input) + biasData[unit];
+            output[unit] = std::min(outputActivationMax, std::max(outputActivationMin, value));
+        }
+    }
+    return true;
+}
+
+// Computes the same integer arithmetic as the dense kernels, so the results are identical.
+template <typename T>
+bool fullyConnectedQuant8Sparse(const T* inputData, const Shape& inputShape,
+                                const SparseWeights<T>& weights, const Shape& weightsShape,
+                                const int32_t* biasData, const Shape& biasShape,
+                                int32_t activation, T* outputData, const Shape& outputShape) {
+    NNTRACE_TRANS("fullyConnectedQuant8Sparse");
+    double realMultiplier = 0.0;
+    int32_t outputMultiplier = 0;
+    int32_t outputShift = 0;
+    int32_t outputActivationMin = 0;
+    int32_t outputActivationMax = 0;
+    NN_RET_CHECK(GetQuantizedConvolutionMultipler(inputShape, weightsShape, biasShape, outputShape,
+                                                  &realMultiplier));
+    NN_RET_CHECK(QuantizeMultiplier(realMultiplier, &outputMultiplier, &outputShift));
+    if constexpr (std::is_same_v<T, uint8_t>) {
+        CalculateActivationRangeUint8(activation, outputShape, &outputActivationMin,
+                                      &outputActivationMax);
+    } else {
+        CalculateActivationRangeInt8(activation, outputShape, &outputActivationMin,
+                                     &outputActivationMax);
+    }
+
+    const auto& matrix = *weights.matrix;
+    const int32_t inputOffset = -inputShape.offset;
+    const int32_t outputOffset = outputShape.offset;
+    const uint32_t batchSize = getSizeOfDimension(outputShape, 0);
+    const uint32_t numUnits = matrix.getNumRows();
+    const uint32_t inputSize = matrix.getNumColumns();
+    NNTRACE_COMP_SWITCH("BlockSparseMatrix::dotRow");
+    for (uint32_t b = 0; b < batchSize; ++b) {
+        const T* input = inputData + b * inputSize;
+        T* output = outputData + b * numUnits;
+        for (uint32_t unit = 0; unit < numUnits; ++unit) {
+            // sum((input + inputOffset) * weight) is split into the sparse dot product of the
+            // input and the constant inputOffset * sum(weight).
+            int32_t acc = matrix.template dotRow<int32_t>(unit, input) +
+                          inputOffset * weights.rowSums[unit] + biasData[unit];
+            acc = tflite::MultiplyByQuantizedMultiplier(acc, outputMultiplier, outputShift);
+            acc += outputOffset;
+            acc = std::min(outputActivationMax, std::max(outputActivationMin, acc));
+            output[unit] = static_cast<T>(acc);
+        }
+    }
+    return true;
+}
 #endif  // NN_INCLUDE_CPU_IMPLEMENTATION
 
 bool validateShapes(const Shape& input, const Shape& weights, const Shape& bias,
@@ -306,6 +477,22 @@ bool execute(IOperationExecutionContext* context) {
     if (getNumberOfElements(context->getOutputShape(kOutputTensor)) == 0) return true;
     switch (context->getInputType(kInputTensor)) {
         case OperandType::TENSOR_FLOAT32:
+            if (const auto weights = getSparseWeights<float>(context)) {
+                return fullyConnectedFloat32Sparse(
+                        context->getInputBuffer<float>(kInputTensor), *weights,
+                        context->getInputBuffer<float>(kBiasTensor),
+                        context->getInputValue<int32_t>(kActivationScalar),
+                        context->getOutputBuffer<float>(kOutputTensor),
+                        context->getOutputShape(kOutputTensor));
+            }
+            if (const auto cached = getHybridWeights(context)) {
+                return fullyConnectedFloat32Hybrid(
+                        context->getInputBuffer<float>(kInputTensor), *cached->weights,
+                        context->getInputBuffer<float>(kBiasTensor),
+                        context->getInputValue<int32_t>(kActivationScalar),
+                        context->getOutputBuffer<float>(kOutputTensor),
+                        context->getOutputShape(kOutputTensor));
+            }
             return fullyConnectedFloat32(context->getInputBuffer<float>(kInputTensor),
                                          context->getInputShape(kInputTensor),
                                          context->getInputBuffer<float>(kWeightsTensor),
@@ -326,6 +513,17 @@ bool execute(IOperationExecutionContext* context) {
                                          context->getOutputBuffer<_Float16>(kOutputTensor),
                                          context->getOutputShape(kOutputTensor));
         case OperandType::TENSOR_QUANT8_ASYMM:
+            if (const auto weights = getSparseWeights<uint8_t>(context)) {
+                return fullyConnectedQuant8Sparse(
+                        context->getInputBuffer<uint8_t>(kInputTensor),
+                        context->getInputShape(kInputTensor), *weights,
+                        context->getInputShape(kWeightsTensor),
+                        context->getInputBuffer<int32_t>(kBiasTensor),
+                        context->getInputShape(kBiasTensor),
+                        context->getInputValue<int32_t>(kActivationScalar),
+                        context->getOutputBuffer<uint8_t>(kOutputTensor),
+                        context->getOutputShape(kOutputTensor));
+            }
             return fullyConnectedQuant8(context->getInputBuffer<uint8_t>(kInputTensor),
                                         context->getInputShape(kInputTensor),
                                         context->getInputBuffer<uint8_t>(kWeightsTensor),
@@ -336,6 +534,17 @@ bool execute(IOperationExecutionContext* context) {
                                         context->getOutputBuffer<uint8_t>(kOutputTensor),
                                         context->getOutputShape(kOutputTensor));
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
+            if (const auto weights = getSparseWeights<int8_t>(context)) {
+                return fullyConnectedQuant8Sparse(
+                        context->getInputBuffer<int8_t>(kInputTensor),
+                        context->getInputShape(kInputTensor), *weights,
+                        context->getInputShape(kWeightsTensor),
+                        context->getInputBuffer<int32_t>(kBiasTensor),
+                        context->getInputShape(kBiasTensor),
+                        context->getInputValue<int32_t>(kActivationScalar),
+                        context->getOutputBuffer<int8_t>(kOutputTensor),
+                        context->getOutputShape(kOutputTensor));
+            }
             return fullyConnectedQuant8(context->getInputBuffer<int8_t>(kInputTensor),
                                         context->getInputShape(kInputTensor),
                                         context->getInputBuffer<int8_t>(kWeightsTensor),
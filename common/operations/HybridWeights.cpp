@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Operations"
+
+#include "HybridWeights.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Tracing.h"
+
+namespace android {
+namespace nn {
+
+HybridWeights::HybridWeights(const float* weights, uint32_t numRows, uint32_t numColumns)
+    : mNumRows(numRows),
+      mNumColumns(numColumns),
+      mValues(static_cast<size_t>(numRows) * numColumns),
+      mScales(numRows) {
+    NNTRACE_COMP("HybridWeights::HybridWeights");
+    double squaredError = 0.0;
+    double squaredNorm = 0.0;
+    for (uint32_t row = 0; row < numRows; ++row) {
+        const float* in = weights + static_cast<size_t>(row) * numColumns;
+        int8_t* out = mValues.data() + static_cast<size_t>(row) * numColumns;
+        float maxAbs = 0.0f;
+        for (uint32_t i = 0; i < numColumns; ++i) {
+            maxAbs = std::max(maxAbs, std::abs(in[i]));
+        }
+        const float scale = maxAbs / 127.0f;
+        mScales[row] = scale;
+        for (uint32_t i = 0; i < numColumns; ++i) {
+            out[i] = scale == 0.0f ? 0 : static_cast<int8_t>(std::round(in[i] / scale));
+            const double error = static_cast<double>(in[i]) - static_cast<double>(scale) * out[i];
+            squaredError += error * error;
+            squaredNorm += static_cast<double>(in[i]) * in[i];
+        }
+    }
+    mRelativeError = squaredNorm == 0.0 ? 0.0f : std::sqrt(squaredError / squaredNorm);
+}
+
+float HybridWeights::dotRow(uint32_t row, const float* input) const {
+    const int8_t* values = mValues.data() + static_cast<size_t>(row) * mNumColumns;
+    float acc = 0.0f;
+    for (uint32_t i = 0; i < mNumColumns; ++i) {
+        acc += static_cast<float>(values[i]) * input[i];
+    }
+    return mScales[row] * acc;
+}
+
+void HybridWeights::multiplyAccumulate(const float* input, uint32_t batchSize,
+                                       float* output) const {
+    NNTRACE_COMP("HybridWeights::multiplyAccumulate");
+    for (uint32_t b = 0; b < batchSize; ++b) {
+        const float* in = input + static_cast<size_t>(b) * mNumColumns;
+        float* out = output + static_cast<size_t>(b) * mNumRows;
+        for (uint32_t row = 0; row < mNumRows; ++row) {
+            out[row] += dotRow(row, in);
+        }
+    }
+}
+
+std::shared_ptr<const CachedHybridWeights> makeCachedHybridWeights(const float* weights,
+                                                                   const Shape& weightsShape,
+                                                                   float tolerance) {
+    NNTRACE_TRANS("makeCachedHybridWeights");
+    auto cached = std::make_shared<CachedHybridWeights>();
+    if (getNumberOfDimensions(weightsShape) != 2 ||
+        getNumberOfElements(weightsShape) < kMinHybridWeightsSize) {
+        return cached;
+    }
+    auto hybrid = std::make_unique<HybridWeights>(weights, getSizeOfDimension(weightsShape, 0),
+                                                  getSizeOfDimension(weightsShape, 1));
+    if (hybrid->getRelativeError() > tolerance) {
+        return cached;
+    }
+    cached->weights = std::move(hybrid);
+    return cached;
+}
+
+}  // namespace nn
+}  // namespace android
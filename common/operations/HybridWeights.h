@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_HYBRID_WEIGHTS_H
+#define ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_HYBRID_WEIGHTS_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "OperationsUtils.h"
+
+namespace android {
+namespace nn {
+
+// A row-major float matrix quantized to int8 with one symmetric scale per row, used for the
+// hybrid execution of float operations: the weights are read as int8 and multiplied with the
+// float activations, which cuts the bandwidth of reading large weight matrices by about 4x.
+// It does not save memory: the float weights stay in the model's pools, so the int8 copy and
+// its scales add about a quarter of their size.
+//
+// Hybrid execution is opt-in, see OperationCache, since it changes the results. It is controlled
+// by a tolerance on the relative error ||W - Q(W)|| / ||W|| of the quantized weights in the
+// Frobenius norm.
+class HybridWeights {
+   public:
+    HybridWeights(const float* weights, uint32_t numRows, uint32_t numColumns);
+
+    uint32_t getNumRows() const { return mNumRows; }
+    uint32_t getNumColumns() const { return mNumColumns; }
+
+    // The relative error of the quantized weights.
+    float getRelativeError() const { return mRelativeError; }
+
+    // Returns the dot product of "row" with "input", which has getNumColumns() elements.
+    float dotRow(uint32_t row, const float* input) const;
+
+    // For every batch b and row r, adds the dot product of row r with the input vector b to
+    // output[b * getNumRows() + r]. The input is [batchSize, getNumColumns()].
+    void multiplyAccumulate(const float* input, uint32_t batchSize, float* output) const;
+
+   private:
+    uint32_t mNumRows;
+    uint32_t mNumColumns;
+    float mRelativeError = 0.0f;
+    std::vector<int8_t> mValues;
+    std::vector<float> mScales;
+};
+
+// Smaller weights are never quantized; they are too small for the saved bandwidth to matter.
+constexpr uint32_t kMinHybridWeightsSize = 4096;
+
+// The tag under which operations cache their CachedHybridWeights.
+constexpr uint32_t kHybridWeightsCacheTag = 1;
+
+// What an operation caches for its weights: the hybrid form, or null if the weights do not
+// qualify.
+struct CachedHybridWeights {
+    std::unique_ptr<const HybridWeights> weights;
+};
+
+// Quantizes the 2-D "weights" if they have at least kMinHybridWeightsSize elements and the
+// relative error of the result is within "tolerance".
+std::shared_ptr<const CachedHybridWeights> makeCachedHybridWeights(const float* weights,
+                                                                   const Shape& weightsShape,
+                                                                   float tolerance);
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_HYBRID_WEIGHTS_H
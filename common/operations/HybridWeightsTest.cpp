@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "HybridWeights.h"
+
+namespace android {
+namespace nn {
+namespace {
+
+constexpr uint32_t kNumRows = 64;
+constexpr uint32_t kNumColumns = 96;
+
+std::vector<float> randomFloats(uint32_t size, float min, float max) {
+    std::mt19937 generator(size);
+    std::uniform_real_distribution<float> distribution(min, max);
+    std::vector<float> values(size);
+    std::generate(values.begin(), values.end(), [&] { return distribution(generator); });
+    return values;
+}
+
+Shape makeWeightsShape() {
+    return {.type = OperandType::TENSOR_FLOAT32, .dimensions = {kNumRows, kNumColumns}};
+}
+
+TEST(HybridWeightsTest, QuantizesWithinHalfAStepPerRow) {
+    std::vector<float> weights = randomFloats(kNumRows * kNumColumns, -2.0f, 2.0f);
+    // A row of zeros and a row with a much smaller range than the others.
+    std::fill_n(weights.begin(), kNumColumns, 0.0f);
+    std::transform(weights.begin() + kNumColumns, weights.begin() + 2 * kNumColumns,
+                   weights.begin() + kNumColumns, [](float value) { return value * 1e-3f; });
+    const HybridWeights hybrid(weights.data(), kNumRows, kNumColumns);
+    EXPECT_GT(hybrid.getRelativeError(), 0.0f);
+    EXPECT_LT(hybrid.getRelativeError(), 0.01f);
+
+    // Each quantized weight is within half a quantization step of the original, so the error of
+    // a dot product with a one-hot input is bounded by the row's half step.
+    std::vector<float> input(kNumColumns, 0.0f);
+    for (uint32_t row = 0; row < kNumRows; ++row) {
+        const float* rowWeights = weights.data() + row * kNumColumns;
+        float maxAbs = 0.0f;
+        for (uint32_t i = 0; i < kNumColumns; ++i) {
+            maxAbs = std::max(maxAbs, std::abs(rowWeights[i]));
+        }
+        const float halfStep = maxAbs / 127.0f / 2.0f;
+        for (uint32_t column = 0; column < kNumColumns; column += 7) {
+            input[column] = 1.0f;
+            EXPECT_NEAR(hybrid.dotRow(row, input.data()), rowWeights[column], halfStep * 1.001f)
+                    << "row " << row << " column " << column;
+            input[column] = 0.0f;
+        }
+    }
+}
+
+TEST(HybridWeightsTest, MultiplyAccumulateMatchesDotRow) {
+    constexpr uint32_t kBatchSize = 3;
+    const std::vector<float> weights = randomFloats(kNumRows * kNumColumns, -1.0f, 1.0f);
+    const std::vector<float> input = randomFloats(kBatchSize * kNumColumns, -1.0f, 1.0f);
+    const HybridWeights hybrid(weights.data(), kNumRows, kNumColumns);
+
+    std::vector<float> output(kBatchSize * kNumRows, 1.0f);
+    hybrid.multiplyAccumulate(input.data(), kBatchSize, output.data());
+    for (uint32_t b = 0; b < kBatchSize; ++b) {
+        for (uint32_t row = 0; row < kNumRows; ++row) {
+            EXPECT_EQ(output[b * kNumRows + row],
+                      1.0f + hybrid.dotRow(row, input.data() + b * kNumColumns));
+        }
+    }
+}
+
+TEST(HybridWeightsTest, CachedWeightsRespectTolerance) {
+    const std::vector<float> weights = randomFloats(kNumRows * kNumColumns, -1.0f, 1.0f);
+    const Shape shape = makeWeightsShape();
+    const HybridWeights hybrid(weights.data(), kNumRows, kNumColumns);
+    const float error = hybrid.getRelativeError();
+
+    const auto accepted = makeCachedHybridWeights(weights.data(), shape, error * 2);
+    ASSERT_NE(accepted, nullptr);
+    EXPECT_NE(accepted->weights, nullptr);
+
+    const auto rejected = makeCachedHybridWeights(weights.data(), shape, error / 2);
+    ASSERT_NE(rejected, nullptr);
+    EXPECT_EQ(rejected->weights, nullptr);
+}
+
+TEST(HybridWeightsTest, SmallWeightsAreNotQuantized) {
+    const std::vector<float> weights = randomFloats(16 * 16, -1.0f, 1.0f);
+    Shape shape = makeWeightsShape();
+    shape.dimensions = {16, 16};
+    const auto cached = makeCachedHybridWeights(weights.data(), shape, 1.0f);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->weights, nullptr);
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
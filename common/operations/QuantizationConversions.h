@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZATION_CONVERSIONS_H
+#define ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZATION_CONVERSIONS_H
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif  // defined(__aarch64__)
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "OperationsUtils.h"
+
+// Element conversion kernels shared by QUANTIZE, DEQUANTIZE and CAST.
+//
+// All kernels produce results identical to the scalar reference formulas:
+//   quantize:   q = clamp(zeroPoint + round(x / scale), min(Q), max(Q))
+//               where round() rounds half away from zero (std::round).
+//   dequantize: x = scale * (q - zeroPoint)
+//   cast:       static_cast, with [0, 255] saturation for TENSOR_QUANT8_ASYMM.
+//
+// The loops are written without data-dependent branches so that they are
+// auto-vectorized, and the hottest float32 <-> 8-bit paths use NEON directly on
+// aarch64, where vcvtaq_s32_f32 implements the same rounding as std::round.
+
+namespace android {
+namespace nn {
+namespace conversions {
+
+template <typename QuantT>
+inline void quantizeFloat32(const float* __restrict input, uint32_t numElements, float scale,
+                            int32_t zeroPoint, QuantT* __restrict output) {
+    static_assert(std::is_same_v<QuantT, uint8_t> || std::is_same_v<QuantT, int8_t>);
+    uint32_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    const int32x4_t vZeroPoint = vdupq_n_s32(zeroPoint);
+    for (; i + 8 <= numElements; i += 8) {
+        // vcvtaq saturates to the int32 range and vqaddq saturates the offset, so the final
+        // saturating narrows clamp to the output type exactly like the scalar path does.
+        const int32x4_t lo = vqaddq_s32(
+                vcvtaq_s32_f32(vdivq_f32(vld1q_f32(input + i), vScale)), vZeroPoint);
+        const int32x4_t hi = vqaddq_s32(
+                vcvtaq_s32_f32(vdivq_f32(vld1q_f32(input + i + 4), vScale)), vZeroPoint);
+        const int16x8_t narrowed = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+        if constexpr (std::is_same_v<QuantT, uint8_t>) {
+            vst1_u8(output + i, vqmovun_s16(narrowed));
+        } else {
+            vst1_s8(output + i, vqmovn_s16(narrowed));
+        }
+    }
+#endif  // defined(__aarch64__)
+    constexpr float kMin = std::numeric_limits<QuantT>::min();
+    constexpr float kMax = std::numeric_limits<QuantT>::max();
+    const float offset = static_cast<float>(zeroPoint);
+    for (; i < numElements; ++i) {
+        output[i] = static_cast<QuantT>(
+                std::max(kMin, std::min(kMax, offset + std::round(input[i] / scale))));
+    }
+}
+
+template <typename QuantT>
+inline void quantizeFloat16(const _Float16* __restrict input, uint32_t numElements, float scale,
+                            int32_t zeroPoint, QuantT* __restrict output) {
+    static_assert(std::is_same_v<QuantT, uint8_t> || std::is_same_v<QuantT, int8_t>);
+    constexpr float kMin = std::numeric_limits<QuantT>::min();
+    constexpr float kMax = std::numeric_limits<QuantT>::max();
+    const float offset = static_cast<float>(zeroPoint);
+    for (uint32_t i = 0; i < numElements; ++i) {
+        const float value = static_cast<float>(input[i]);
+        output[i] = static_cast<QuantT>(
+                std::max(kMin, std::min(kMax, offset + std::round(value / scale))));
+    }
+}
+
+template <typename InputT, typename QuantT>
+inline void quantize(const InputT* input, uint32_t numElements, float scale, int32_t zeroPoint,
+                     QuantT* output) {
+    if constexpr (std::is_same_v<InputT, float>) {
+        quantizeFloat32(input, numElements, scale, zeroPoint, output);
+    } else {
+        quantizeFloat16(input, numElements, scale, zeroPoint, output);
+    }
+}
+
+template <typename QuantT, typename OutputT>
+inline void dequantize(const QuantT* __restrict input, uint32_t numElements, float scale,
+                       int32_t zeroPoint, OutputT* __restrict output) {
+    static_assert(std::is_same_v<QuantT, uint8_t> || std::is_same_v<QuantT, int8_t>);
+    uint32_t i = 0;
+#if defined(__aarch64__)
+    if constexpr (std::is_same_v<OutputT, float>) {
+        const float32x4_t vScale = vdupq_n_f32(scale);
+        const int32x4_t vZeroPoint = vdupq_n_s32(zeroPoint);
+        for (; i + 8 <= numElements; i += 8) {
+            int16x8_t widened;
+            if constexpr (std::is_same_v<QuantT, uint8_t>) {
+                widened = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(input + i)));
+            } else {
+                widened = vmovl_s8(vld1_s8(input + i));
+            }
+            const int32x4_t lo = vsubq_s32(vmovl_s16(vget_low_s16(widened)), vZeroPoint);
+            const int32x4_t hi = vsubq_s32(vmovl_s16(vget_high_s16(widened)), vZeroPoint);
+            vst1q_f32(output + i, vmulq_f32(vScale, vcvtq_f32_s32(lo)));
+            vst1q_f32(output + i + 4, vmulq_f32(vScale, vcvtq_f32_s32(hi)));
+        }
+    }
+#endif  // defined(__aarch64__)
+    for (; i < numElements; ++i) {
+        const int32_t value = input[i];
+        output[i] = static_cast<OutputT>(scale * static_cast<float>(value - zeroPoint));
+    }
+}
+
+// Per-channel dequantization of TENSOR_QUANT8_SYMM_PER_CHANNEL data.
+//
+// The tensor is viewed as [outerSize, numChannels, innerSize] around channelDim so that the
+// scale is looked up once per contiguous run instead of once per element. The two common
+// layouts get dedicated loops: channelDim innermost (innerSize == 1, e.g. fully connected and
+// depthwise filters) and channelDim outermost (outerSize == 1, e.g. convolution filters).
+template <typename OutputT>
+inline void dequantizePerChannel(const int8_t* __restrict input, const Shape& inputShape,
+                                 OutputT* __restrict output) {
+    const auto& params = std::get<Operand::SymmPerChannelQuantParams>(inputShape.extraParams);
+    const uint32_t channelDim = params.channelDim;
+    const float* scales = params.scales.data();
+    const uint32_t numChannels = getSizeOfDimension(inputShape, channelDim);
+    const uint32_t outerSize = getNumberOfElements(inputShape, 0, channelDim);
+    const uint32_t innerSize =
+            getNumberOfElements(inputShape, channelDim + 1, getNumberOfDimensions(inputShape));
+    const int32_t zeroPoint = inputShape.offset;
+
+    if (innerSize == 1) {
+        for (uint32_t outer = 0; outer < outerSize; ++outer) {
+            const int8_t* in = input + outer * numChannels;
+            OutputT* out = output + outer * numChannels;
+            for (uint32_t c = 0; c < numChannels; ++c) {
+                const int32_t value = in[c];
+                out[c] = static_cast<OutputT>(scales[c] * static_cast<float>(value - zeroPoint));
+            }
+        }
+        return;
+    }
+
+    // Covers both the outermost channel dimension (outerSize == 1) and the general case: each
+    // (outer, channel) pair is a contiguous run of innerSize elements sharing one scale.
+    for (uint32_t outer = 0; outer < outerSize; ++outer) {
+        for (uint32_t c = 0; c < numChannels; ++c) {
+            const uint32_t offset = (outer * numChannels + c) * innerSize;
+            dequantize(input + offset, innerSize, scales[c], zeroPoint, output + offset);
+        }
+    }
+}
+
+// Element-wise CAST between two of {TENSOR_FLOAT16, TENSOR_FLOAT32, TENSOR_INT32,
+// TENSOR_QUANT8_ASYMM}. Identity conversions are a plain memcpy.
+template <typename FromT, typename ToT>
+inline void cast(const FromT* __restrict input, uint32_t numElements, ToT* __restrict output) {
+    if constexpr (std::is_same_v<FromT, ToT>) {
+        std::memcpy(output, input, numElements * sizeof(FromT));
+    } else if constexpr (std::is_same_v<ToT, uint8_t> && !std::is_same_v<FromT, _Float16>) {
+        // Saturate in the source type before the narrowing conversion; a float in (k, k+1)
+        // still truncates to k as in a plain static_cast.
+        const FromT kMin = 0;
+        const FromT kMax = 255;
+        for (uint32_t i = 0; i < numElements; ++i) {
+            output[i] = static_cast<uint8_t>(std::max(kMin, std::min(kMax, input[i])));
+        }
+    } else if constexpr (std::is_same_v<ToT, uint8_t>) {
+        // _Float16 comparisons are done in float to avoid per-element half promotions.
+        for (uint32_t i = 0; i < numElements; ++i) {
+            const float value = static_cast<float>(input[i]);
+            output[i] = static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, value)));
+        }
+    } else {
+        for (uint32_t i = 0; i < numElements; ++i) {
+            output[i] = static_cast<ToT>(input[i]);
+        }
+    }
+}
+
+}  // namespace conversions
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZATION_CONVERSIONS_H
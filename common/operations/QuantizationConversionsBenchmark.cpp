@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "QuantizationConversions.h"
+
+// Benchmark matrix for the QUANTIZE, DEQUANTIZE and CAST kernels. Every kernel is run over
+// tensor sizes from 1K to 1M elements; the reported bytes/second counts the bytes read plus
+// the bytes written.
+
+namespace android {
+namespace nn {
+namespace {
+
+template <typename T>
+std::vector<T> makeInput(size_t size) {
+    std::vector<T> values(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = static_cast<T>(static_cast<int>(i % 251) - 100);
+    }
+    return values;
+}
+
+template <typename FromT, typename ToT>
+void setBytesProcessed(benchmark::State& state) {
+    state.SetBytesProcessed(state.iterations() * state.range(0) * (sizeof(FromT) + sizeof(ToT)));
+}
+
+template <typename FromT, typename ToT>
+void BM_Quantize(benchmark::State& state) {
+    const std::vector<FromT> input = makeInput<FromT>(state.range(0));
+    std::vector<ToT> output(state.range(0));
+    for (auto _ : state) {
+        conversions::quantize(input.data(), input.size(), 0.5f, 3, output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    setBytesProcessed<FromT, ToT>(state);
+}
+
+template <typename FromT, typename ToT>
+void BM_Dequantize(benchmark::State& state) {
+    const std::vector<FromT> input = makeInput<FromT>(state.range(0));
+    std::vector<ToT> output(state.range(0));
+    for (auto _ : state) {
+        conversions::dequantize(input.data(), input.size(), 0.5f, 3, output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    setBytesProcessed<FromT, ToT>(state);
+}
+
+// state.range(1) selects the channel dimension of a [numChannels, size / 64 / numChannels, 64]
+// style tensor: 0 is the outermost and 2 the innermost axis.
+template <typename ToT>
+void BM_DequantizePerChannel(benchmark::State& state) {
+    constexpr uint32_t kNumChannels = 64;
+    const uint32_t size = state.range(0);
+    const uint32_t channelDim = state.range(1);
+    Shape shape = {.type = OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL};
+    shape.dimensions = {kNumChannels, kNumChannels, size / (kNumChannels * kNumChannels)};
+    std::swap(shape.dimensions[0], shape.dimensions[channelDim]);
+    shape.extraParams = Operand::SymmPerChannelQuantParams{
+            .scales = std::vector<float>(kNumChannels, 0.5f), .channelDim = channelDim};
+
+    const std::vector<int8_t> input = makeInput<int8_t>(getNumberOfElements(shape));
+    std::vector<ToT> output(input.size());
+    for (auto _ : state) {
+        conversions::dequantizePerChannel(input.data(), shape, output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    setBytesProcessed<int8_t, ToT>(state);
+}
+
+template <typename FromT, typename ToT>
+void BM_Cast(benchmark::State& state) {
+    const std::vector<FromT> input = makeInput<FromT>(state.range(0));
+    std::vector<ToT> output(state.range(0));
+    for (auto _ : state) {
+        conversions::cast(input.data(), input.size(), output.data());
+        benchmark::DoNotOptimize(output.data());
+    }
+    setBytesProcessed<FromT, ToT>(state);
+}
+
+#define NN_CONVERSION_BENCHMARK(name, ...) \
+    BENCHMARK_TEMPLATE(name, __VA_ARGS__)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)
+
+NN_CONVERSION_BENCHMARK(BM_Quantize, float, uint8_t);
+NN_CONVERSION_BENCHMARK(BM_Quantize, float, int8_t);
+NN_CONVERSION_BENCHMARK(BM_Quantize, _Float16, uint8_t);
+NN_CONVERSION_BENCHMARK(BM_Quantize, _Float16, int8_t);
+
+NN_CONVERSION_BENCHMARK(BM_Dequantize, uint8_t, float);
+NN_CONVERSION_BENCHMARK(BM_Dequantize, int8_t, float);
+NN_CONVERSION_BENCHMARK(BM_Dequantize, uint8_t, _Float16);
+NN_CONVERSION_BENCHMARK(BM_Dequantize, int8_t, _Float16);
+
+BENCHMARK_TEMPLATE(BM_DequantizePerChannel, float)
+        ->ArgsProduct({{1 << 14, 1 << 20}, {0, 1, 2}});
+BENCHMARK_TEMPLATE(BM_DequantizePerChannel, _Float16)
+        ->ArgsProduct({{1 << 14, 1 << 20}, {0, 1, 2}});
+
+#define NN_CAST_BENCHMARKS_FROM(FromT)                   \
+    NN_CONVERSION_BENCHMARK(BM_Cast, FromT, _Float16);   \
+    NN_CONVERSION_BENCHMARK(BM_Cast, FromT, float);      \
+    NN_CONVERSION_BENCHMARK(BM_Cast, FromT, int32_t);    \
+    NN_CONVERSION_BENCHMARK(BM_Cast, FromT, uint8_t)
+
+NN_CAST_BENCHMARKS_FROM(_Float16);
+NN_CAST_BENCHMARKS_FROM(float);
+NN_CAST_BENCHMARKS_FROM(int32_t);
+NN_CAST_BENCHMARKS_FROM(uint8_t);
+
+#undef NN_CAST_BENCHMARKS_FROM
+#undef NN_CONVERSION_BENCHMARK
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
+
+BENCHMARK_MAIN();
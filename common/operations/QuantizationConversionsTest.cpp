@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "QuantizationConversions.h"
+
+namespace android {
+namespace nn {
+namespace {
+
+// Odd size so that both the vectorized body and the scalar tail are exercised.
+constexpr uint32_t kNumElements = 1027;
+
+std::vector<float> randomFloats(float min, float max) {
+    std::mt19937 generator(kNumElements);
+    std::uniform_real_distribution<float> distribution(min, max);
+    std::vector<float> values(kNumElements);
+    std::generate(values.begin(), values.end(), [&] { return distribution(generator); });
+    return values;
+}
+
+template <typename QuantT>
+QuantT referenceQuantize(float value, float scale, int32_t zeroPoint) {
+    return static_cast<QuantT>(std::max<float>(
+            std::numeric_limits<QuantT>::min(),
+            std::min<float>(std::numeric_limits<QuantT>::max(),
+                            zeroPoint + std::round(value / scale))));
+}
+
+template <typename QuantT>
+void testQuantizeRoundTrip(float scale, int32_t zeroPoint) {
+    const std::vector<float> input = randomFloats(-400.0f, 400.0f);
+    std::vector<QuantT> quantized(kNumElements);
+    conversions::quantize(input.data(), kNumElements, scale, zeroPoint, quantized.data());
+    for (uint32_t i = 0; i < kNumElements; ++i) {
+        ASSERT_EQ(quantized[i], referenceQuantize<QuantT>(input[i], scale, zeroPoint))
+                << "input " << input[i] << " at index " << i;
+    }
+
+    std::vector<float> dequantized(kNumElements);
+    conversions::dequantize(quantized.data(), kNumElements, scale, zeroPoint, dequantized.data());
+    for (uint32_t i = 0; i < kNumElements; ++i) {
+        const int32_t value = quantized[i];
+        ASSERT_EQ(dequantized[i], scale * (value - zeroPoint)) << "at index " << i;
+    }
+}
+
+TEST(QuantizationConversionsTest, QuantizeDequantizeQuant8Asymm) {
+    testQuantizeRoundTrip<uint8_t>(0.5f, 127);
+    testQuantizeRoundTrip<uint8_t>(3.0f, 0);
+}
+
+TEST(QuantizationConversionsTest, QuantizeDequantizeQuant8AsymmSigned) {
+    testQuantizeRoundTrip<int8_t>(0.5f, -1);
+    testQuantizeRoundTrip<int8_t>(3.0f, 100);
+}
+
+TEST(QuantizationConversionsTest, QuantizeRoundsHalfAwayFromZero) {
+    const std::vector<float> input = {-2.5f, -1.5f, -0.5f, 0.5f, 1.5f, 2.5f, 1000.0f, -1000.0f,
+                                      -2.5f, -1.5f, -0.5f, 0.5f, 1.5f, 2.5f, 1000.0f, -1000.0f};
+    std::vector<int8_t> output(input.size());
+    conversions::quantize(input.data(), input.size(), 1.0f, 0, output.data());
+    const std::vector<int8_t> expected = {-3, -2, -1, 1, 2, 3, 127, -128,
+                                          -3, -2, -1, 1, 2, 3, 127, -128};
+    EXPECT_EQ(output, expected);
+}
+
+void testDequantizePerChannel(const std::vector<uint32_t>& dimensions, uint32_t channelDim) {
+    Shape shape = {.type = OperandType::TENSOR_QUANT8_SYMM_PER_CHANNEL,
+                   .dimensions = dimensions,
+                   .offset = 0};
+    Operand::SymmPerChannelQuantParams params = {.channelDim = channelDim};
+    for (uint32_t i = 0; i < dimensions[channelDim]; ++i) {
+        params.scales.push_back(0.25f * (i + 1));
+    }
+    shape.extraParams = params;
+
+    const uint32_t numElements = getNumberOfElements(shape);
+    std::vector<int8_t> input(numElements);
+    for (uint32_t i = 0; i < numElements; ++i) {
+        input[i] = static_cast<int8_t>(i * 7);
+    }
+    std::vector<float> output(numElements);
+    conversions::dequantizePerChannel(input.data(), shape, output.data());
+
+    uint32_t stride = 1;
+    for (uint32_t i = channelDim + 1; i < dimensions.size(); ++i) {
+        stride *= dimensions[i];
+    }
+    for (uint32_t i = 0; i < numElements; ++i) {
+        const float scale = params.scales[(i / stride) % dimensions[channelDim]];
+        ASSERT_EQ(output[i], scale * input[i]) << "at index " << i;
+    }
+}
+
+TEST(QuantizationConversionsTest, DequantizePerChannelInnermost) {
+    testDequantizePerChannel({3, 4, 5, 11}, 3);
+}
+
+TEST(QuantizationConversionsTest, DequantizePerChannelOutermost) {
+    testDequantizePerChannel({11, 4, 5, 3}, 0);
+}
+
+TEST(QuantizationConversionsTest, DequantizePerChannelMiddle) {
+    testDequantizePerChannel({3, 4, 11, 5}, 2);
+}
+
+template <typename FromT, typename ToT>
+void testCast(const std::vector<float>& values) {
+    std::vector<FromT> input(values.begin(), values.end());
+    std::vector<ToT> output(input.size());
+    conversions::cast(input.data(), input.size(), output.data());
+    for (uint32_t i = 0; i < input.size(); ++i) {
+        ToT expected;
+        if constexpr (std::is_same_v<ToT, uint8_t>) {
+            if (input[i] < 0) {
+                expected = 0;
+            } else if (input[i] > 255) {
+                expected = 255;
+            } else {
+                expected = static_cast<ToT>(input[i]);
+            }
+        } else {
+            expected = static_cast<ToT>(input[i]);
+        }
+        ASSERT_EQ(output[i], expected) << "at index " << i;
+    }
+}
+
+template <typename FromT>
+void testCastFrom(const std::vector<float>& values) {
+    testCast<FromT, _Float16>(values);
+    testCast<FromT, float>(values);
+    testCast<FromT, int32_t>(values);
+    testCast<FromT, uint8_t>(values);
+}
+
+TEST(QuantizationConversionsTest, CastMatrix) {
+    // Values representable exactly in all four types.
+    std::vector<float> values(kNumElements);
+    for (uint32_t i = 0; i < kNumElements; ++i) {
+        values[i] = static_cast<float>(i % 256);
+    }
+    testCastFrom<_Float16>(values);
+    testCastFrom<float>(values);
+    testCastFrom<int32_t>(values);
+    testCastFrom<uint8_t>(values);
+}
+
+TEST(QuantizationConversionsTest, CastSaturatesToQuant8Asymm) {
+    const std::vector<float> values = randomFloats(-1000.0f, 1000.0f);
+    testCast<float, uint8_t>(values);
+    testCast<_Float16, uint8_t>(values);
+
+    std::vector<float> integers(values.size());
+    std::transform(values.begin(), values.end(), integers.begin(),
+                   [](float value) { return std::trunc(value); });
+    testCast<int32_t, uint8_t>(integers);
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
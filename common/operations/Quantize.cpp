@@ -16,12 +16,10 @@
 
 #define LOG_TAG "Operations"
 
-#include <algorithm>
-#include <cmath>
-
 #include "IndexedShapeWrapper.h"
 #include "OperationResolver.h"
 #include "OperationsUtils.h"
+#include "QuantizationConversions.h"
 #include "Tracing.h"
 
 namespace android {
@@ -36,28 +34,11 @@ constexpr uint32_t kOutputTensor = 0;
 
 namespace {
 
-template <typename T>
-bool quantizeToQuant8(const T* inputData, uint8_t* outputData, const Shape& outputShape) {
-    NNTRACE_COMP("quantizeToQuant8");
-    uint32_t size = getNumberOfElements(outputShape);
-    for (uint32_t i = 0; i < size; ++i) {
-        outputData[i] = static_cast<uint8_t>(std::max<float>(
-                0.0f, std::min<float>(255.0f, outputShape.offset + std::round(inputData[i] /
-                                                                              outputShape.scale))));
-    }
-    return true;
-}
-
-template <typename T>
-bool quantizeToQuant8Signed(const T* inputData, int8_t* outputData, const Shape& outputShape) {
-    NNTRACE_COMP("quantizeToQuant8Signed");
-    uint32_t size = getNumberOfElements(outputShape);
-    for (uint32_t i = 0; i < size; ++i) {
-        outputData[i] = static_cast<int8_t>(std::max<float>(
-                -128.0f,
-                std::min<float>(127.0f, outputShape.offset +
-                                                std::round(inputData[i] / outputShape.scale))));
-    }
+template <typename InputType, typename OutputType>
+bool compute(const InputType* inputData, OutputType* outputData, const Shape& outputShape) {
+    NNTRACE_COMP("quantize::compute");
+    conversions::quantize(inputData, getNumberOfElements(outputShape), outputShape.scale,
+                          outputShape.offset, outputData);
     return true;
 }
 
@@ -96,25 +77,24 @@ bool execute(IOperationExecutionContext* context) {
 
     const OperandType inputType = context->getInputType(kInputTensor);
     const OperandType outputType = context->getOutputType(kOutputTensor);
+    const Shape& outputShape = context->getOutputShape(kOutputTensor);
     if (inputType == OperandType::TENSOR_FLOAT32) {
+        const float* inputBuffer = context->getInputBuffer<float>(kInputTensor);
         if (outputType == OperandType::TENSOR_QUANT8_ASYMM) {
-            return quantizeToQuant8<float>(context->getInputBuffer<float>(kInputTensor),
-                                           context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                           context->getOutputShape(kOutputTensor));
+            return compute(inputBuffer, context->getOutputBuffer<uint8_t>(kOutputTensor),
+                           outputShape);
         } else if (outputType == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
-            return quantizeToQuant8Signed<float>(context->getInputBuffer<float>(kInputTensor),
-                                                 context->getOutputBuffer<int8_t>(kOutputTensor),
-                                                 context->getOutputShape(kOutputTensor));
+            return compute(inputBuffer, context->getOutputBuffer<int8_t>(kOutputTensor),
+                           outputShape);
         }
     } else if (inputType == OperandType::TENSOR_FLOAT16) {
+        const _Float16* inputBuffer = context->getInputBuffer<_Float16>(kInputTensor);
         if (outputType == OperandType::TENSOR_QUANT8_ASYMM) {
-            return quantizeToQuant8<_Float16>(context->getInputBuffer<_Float16>(kInputTensor),
-                                              context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                              context->getOutputShape(kOutputTensor));
+            return compute(inputBuffer, context->getOutputBuffer<uint8_t>(kOutputTensor),
+                           outputShape);
         } else if (outputType == OperandType::TENSOR_QUANT8_ASYMM_SIGNED) {
-            return quantizeToQuant8Signed<_Float16>(context->getInputBuffer<_Float16>(kInputTensor),
-                                                    context->getOutputBuffer<int8_t>(kOutputTensor),
-                                                    context->getOutputShape(kOutputTensor));
+            return compute(inputBuffer, context->getOutputBuffer<int8_t>(kOutputTensor),
+                           outputShape);
         }
     }
     NN_RET_CHECK_FAIL() << "Unsupported tensor types combination for QUANTIZE op. (input type: "
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZED_LOOKUP_TABLE_H
+#define ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZED_LOOKUP_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "OperationsUtils.h"
+#include "Tracing.h"
+
+namespace android {
+namespace nn {
+
+// An 8-bit quantized tensor can only hold 256 distinct values, so any element-wise operation on
+// it is fully described by a 256-entry table of its results, indexed by the bit pattern of the
+// input value. The tables are built by running the operation's own kernel over all 256 inputs,
+// which keeps the results bit-exact, and are cached per operation through
+// IOperationExecutionContext so that they are built once per prepared model.
+template <typename T>
+struct QuantizedLookupTable {
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>);
+    static constexpr uint32_t kSize = 256;
+
+    static uint8_t index(T value) { return static_cast<uint8_t>(value); }
+
+    std::array<T, kSize> values;
+};
+
+// The tag under which an operation caches its QuantizedLookupTable.
+constexpr uint32_t kQuantizedLookupTableCacheTag = 0;
+
+// Builds the table for the element-wise "kernel" with the signature
+//   bool kernel(const T* input, const Shape& inputShape, T* output, const Shape& outputShape).
+// Returns nullptr if the kernel fails, e.g. because of unsupported quantization parameters.
+template <typename T, typename Kernel>
+std::shared_ptr<const QuantizedLookupTable<T>> makeQuantizedLookupTable(const Shape& inputShape,
+                                                                        const Shape& outputShape,
+                                                                        const Kernel& kernel) {
+    NNTRACE_COMP("makeQuantizedLookupTable");
+    constexpr uint32_t kSize = QuantizedLookupTable<T>::kSize;
+    std::array<T, kSize> inputs;
+    for (uint32_t i = 0; i < kSize; ++i) {
+        inputs[i] = static_cast<T>(i);
+    }
+    Shape tableInputShape = inputShape;
+    tableInputShape.dimensions = {kSize};
+    Shape tableOutputShape = outputShape;
+    tableOutputShape.dimensions = {kSize};
+
+    auto table = std::make_shared<QuantizedLookupTable<T>>();
+    if (!kernel(inputs.data(), tableInputShape, table->values.data(), tableOutputShape)) {
+        return nullptr;
+    }
+    return table;
+}
+
+template <typename T>
+void applyQuantizedLookupTable(const QuantizedLookupTable<T>& table, const T* inputData,
+                               uint32_t numElements, T* outputData) {
+    NNTRACE_COMP("applyQuantizedLookupTable");
+    const T* values = table.values.data();
+    for (uint32_t i = 0; i < numElements; ++i) {
+        outputData[i] = values[QuantizedLookupTable<T>::index(inputData[i])];
+    }
+}
+
+// Evaluates the element-wise "kernel" through the operation's cached lookup table. Without an
+// operation cache, tensors smaller than the table are evaluated directly since building the
+// table would cost more than it saves.
+template <typename T, typename Kernel>
+bool evalWithQuantizedLookupTable(IOperationExecutionContext* context, const T* inputData,
+                                  const Shape& inputShape, T* outputData, const Shape& outputShape,
+                                  const Kernel& kernel) {
+    const uint32_t numElements = getNumberOfElements(inputShape);
+    if (!context->hasOperationCache() && numElements < QuantizedLookupTable<T>::kSize) {
+        return kernel(inputData, inputShape, outputData, outputShape);
+    }
+    const auto table = context->getOrCreateCachedData<QuantizedLookupTable<T>>(
+            kQuantizedLookupTableCacheTag,
+            [&] { return makeQuantizedLookupTable<T>(inputShape, outputShape, kernel); });
+    NN_RET_CHECK(table != nullptr);
+    applyQuantizedLookupTable(*table, inputData, numElements, outputData);
+    return true;
+}
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_COMMON_OPERATIONS_QUANTIZED_LOOKUP_TABLE_H
@@ -21,8 +21,11 @@
 #include <tensorflow/lite/kernels/internal/optimized/legacy_optimized_ops.h>
 #include <tensorflow/lite/kernels/internal/reference/reference_ops.h>
 
+#include <algorithm>
+#include <iterator>
 #include <vector>
 
+#include "BlockCopy.h"
 #include "CpuOperationUtils.h"
 #include "LegacyUtils.h"
 #include "Operations.h"
@@ -42,9 +45,25 @@ bool copyData(const void* inputData, const Shape& inputShape, void* outputData,
 template <typename T>
 bool depthToSpaceGeneric(const T* inputData, const Shape& inputShape, int32_t blockSize,
                          T* outputData, const Shape& outputShape) {
-    NNTRACE_COMP("optimized_ops::DepthToSpace");
-    tflite::optimized_ops::DepthToSpace(inputData, convertShapeToDims(inputShape), blockSize,
-                                        outputData, convertShapeToDims(outputShape));
+    NNTRACE_COMP("depthToSpaceGeneric");
+    const uint32_t batches = getSizeOfDimension(inputShape, 0);
+    const uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
+    const uint32_t outputDepth = getSizeOfDimension(outputShape, 3);
+    const uint32_t block = static_cast<uint32_t>(blockSize);
+    // The output is viewed as [batches, inputHeight, block, inputWidth, block, outputDepth].
+    const BlockCopyDimension dimensions[] = {
+            {batches, inputHeight * inputWidth * inputDepth},
+            {inputHeight, inputWidth * inputDepth},
+            {block, block * outputDepth},
+            {inputWidth, inputDepth},
+            {block, outputDepth},
+            {outputDepth, 1},
+    };
+    BlockCopyPlan plan;
+    NN_RET_CHECK(plan.initialize(sizeof(T), dimensions, std::size(dimensions)));
+    plan.execute(inputData, outputData);
     return true;
 }
 template bool depthToSpaceGeneric<float>(const float* inputData, const Shape& inputShape,
@@ -63,9 +82,26 @@ template bool depthToSpaceGeneric<int8_t>(const int8_t* inputData, const Shape&
 template <typename T>
 bool spaceToDepthGeneric(const T* inputData, const Shape& inputShape, int32_t blockSize,
                          T* outputData, const Shape& outputShape) {
-    NNTRACE_COMP("optimized_ops::SpaceToDepth");
-    tflite::optimized_ops::SpaceToDepth(inputData, convertShapeToDims(inputShape), blockSize,
-                                        outputData, convertShapeToDims(outputShape));
+    NNTRACE_COMP("spaceToDepthGeneric");
+    const uint32_t batches = getSizeOfDimension(inputShape, 0);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t inputDepth = getSizeOfDimension(inputShape, 3);
+    const uint32_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const uint32_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const uint32_t block = static_cast<uint32_t>(blockSize);
+    const uint32_t inputRowSize = inputWidth * inputDepth;
+    // The output is viewed as [batches, outputHeight, outputWidth, block, block, inputDepth].
+    const BlockCopyDimension dimensions[] = {
+            {batches, getSizeOfDimension(inputShape, 1) * inputRowSize},
+            {outputHeight, block * inputRowSize},
+            {outputWidth, block * inputDepth},
+            {block, inputRowSize},
+            {block, inputDepth},
+            {inputDepth, 1},
+    };
+    BlockCopyPlan plan;
+    NN_RET_CHECK(plan.initialize(sizeof(T), dimensions, std::size(dimensions)));
+    plan.execute(inputData, outputData);
     return true;
 }
 template bool spaceToDepthGeneric<float>(const float* inputData, const Shape& inputShape,
@@ -197,13 +233,28 @@ template bool padGeneric<int8_t>(const int8_t* inputData, const Shape& inputShap
 template <typename T>
 bool batchToSpaceGeneric(const T* inputData, const Shape& inputShape, const int32_t* blockSize,
                          T* outputData, const Shape& outputShape) {
-    // Needed by low level implementation, but not really used.
-    tflite::Dims<4> blockSizeDim, cropsDim;
-    const int32 crops[4] = {0, 0, 0, 0};
-    NNTRACE_COMP("optimized_ops::BatchToSpaceND");
-    tflite::optimized_ops::BatchToSpaceND(inputData, convertShapeToDims(inputShape), blockSize,
-                                          blockSizeDim, crops, cropsDim, outputData,
-                                          convertShapeToDims(outputShape));
+    NNTRACE_COMP("batchToSpaceGeneric");
+    const uint32_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const uint32_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t depth = getSizeOfDimension(inputShape, 3);
+    const uint32_t outputBatches = getSizeOfDimension(outputShape, 0);
+    const uint32_t blockHeight = static_cast<uint32_t>(blockSize[0]);
+    const uint32_t blockWidth = static_cast<uint32_t>(blockSize[1]);
+    // Input batch (y * blockWidth + x) * outputBatches + b holds the pixels of output batch b at
+    // offset (y, x) within each block. The output is viewed as
+    // [outputBatches, inputHeight, blockHeight, inputWidth, blockWidth, depth].
+    const uint32_t inputBatchSize = inputHeight * inputWidth * depth;
+    const BlockCopyDimension dimensions[] = {
+            {outputBatches, inputBatchSize},
+            {inputHeight, inputWidth * depth},
+            {blockHeight, blockWidth * outputBatches * inputBatchSize},
+            {inputWidth, depth},
+            {blockWidth, outputBatches * inputBatchSize},
+            {depth, 1},
+    };
+    BlockCopyPlan plan;
+    NN_RET_CHECK(plan.initialize(sizeof(T), dimensions, std::size(dimensions)));
+    plan.execute(inputData, outputData);
     return true;
 }
 template bool batchToSpaceGeneric<float>(const float* inputData, const Shape& inputShape,
@@ -223,13 +274,63 @@ template <typename T>
 bool spaceToBatchGeneric(const T* inputData, const Shape& inputShape, const int32_t* blockSize,
                          const int32_t* padding, const Shape& paddingShape, T* outputData,
                          const Shape& outputShape) {
-    // Needed by low level implementation, but not really used.
-    tflite::RuntimeShape blockSizeDim;
-    NNTRACE_COMP("optimized_ops::SpaceToBatchND");
-    tflite::optimized_ops::SpaceToBatchND(
-            {.output_offset = outputShape.offset}, convertShapeToTflshape(inputShape), inputData,
-            blockSizeDim, blockSize, convertShapeToTflshape(paddingShape), padding,
-            convertShapeToTflshape(outputShape), outputData);
+    NNTRACE_COMP("spaceToBatchGeneric");
+    const uint32_t inputBatches = getSizeOfDimension(inputShape, 0);
+    const int64_t inputHeight = getSizeOfDimension(inputShape, 1);
+    const int64_t inputWidth = getSizeOfDimension(inputShape, 2);
+    const uint32_t depth = getSizeOfDimension(inputShape, 3);
+    const int64_t outputHeight = getSizeOfDimension(outputShape, 1);
+    const int64_t outputWidth = getSizeOfDimension(outputShape, 2);
+    const int64_t blockHeight = blockSize[0];
+    const int64_t blockWidth = blockSize[1];
+    const int64_t paddingTop = padding[0];
+    const int64_t paddingLeft = padding[2];
+
+    // Padded pixels hold the output zero point.
+    if (padding[0] != 0 || padding[1] != 0 || padding[2] != 0 || padding[3] != 0) {
+        std::fill_n(outputData, getNumberOfElements(outputShape),
+                    static_cast<T>(outputShape.offset));
+    }
+
+    // Output batch (y * blockWidth + x) * inputBatches + b holds the pixels of input batch b at
+    // offset (y, x) within each block of the padded input. Within each such group of output
+    // batches the valid pixels form a box, each row of which is one strided copy.
+    const uint32_t inputRowSize = inputWidth * depth;
+    const uint32_t inputBatchSize = inputHeight * inputRowSize;
+    const uint32_t outputRowSize = outputWidth * depth;
+    const uint32_t outputBatchSize = outputHeight * outputRowSize;
+    auto ceilDiv = [](int64_t a, int64_t b) { return a > 0 ? (a + b - 1) / b : 0; };
+    for (int64_t y = 0; y < blockHeight; ++y) {
+        const int64_t beginH = ceilDiv(paddingTop - y, blockHeight);
+        const int64_t endH =
+                std::min(outputHeight, ceilDiv(inputHeight + paddingTop - y, blockHeight));
+        for (int64_t x = 0; x < blockWidth; ++x) {
+            const int64_t beginW = ceilDiv(paddingLeft - x, blockWidth);
+            const int64_t endW =
+                    std::min(outputWidth, ceilDiv(inputWidth + paddingLeft - x, blockWidth));
+            if (beginH >= endH || beginW >= endW) {
+                continue;
+            }
+            const BlockCopyDimension dimensions[] = {
+                    {static_cast<uint32_t>(endW - beginW),
+                     static_cast<uint32_t>(blockWidth) * depth},
+                    {depth, 1},
+            };
+            BlockCopyPlan plan;
+            NN_RET_CHECK(plan.initialize(sizeof(T), dimensions, std::size(dimensions)));
+            const uint32_t firstOutputBatch = (y * blockWidth + x) * inputBatches;
+            for (uint32_t b = 0; b < inputBatches; ++b) {
+                for (int64_t h = beginH; h < endH; ++h) {
+                    const int64_t inputH = h * blockHeight + y - paddingTop;
+                    const int64_t inputW = beginW * blockWidth + x - paddingLeft;
+                    plan.execute(inputData + b * inputBatchSize + inputH * inputRowSize +
+                                         inputW * depth,
+                                 outputData + (firstOutputBatch + b) * outputBatchSize +
+                                         h * outputRowSize + beginW * depth);
+                }
+            }
+        }
+    }
     return true;
 }
 template bool spaceToBatchGeneric<float>(const float* inputData, const Shape& inputShape,
@@ -23,12 +23,14 @@
 
 #include "CpuExecutor.h"
 #include "CpuOperationUtils.h"
+#include "HybridWeights.h"
 #include "Tracing.h"
 
 namespace android {
 namespace nn {
 
-SVDF::SVDF(const Operation& operation, RunTimeOperandInfo* operands) {
+SVDF::SVDF(const Operation& operation, RunTimeOperandInfo* operands, OperationCache* cache)
+    : operation_(&operation), cache_(cache) {
     NNTRACE_TRANS("SVDF::SVDF");
     input_ = GetInput(operation, operands, kInputTensor);
     weights_feature_ = GetInput(operation, operands, kWeightsFeatureTensor);
@@ -133,8 +135,8 @@ bool SVDF::Eval() {
 
             EvalFloat32(inputDataFloat32.data(), inputStateDataFloat32.data(),
                         biasDataFloat32.data(), weightsFeatureDataFloat32.data(),
-                        weightsTimeDataFloat32.data(), outputDataFloat32.data(),
-                        outputStateDataFloat32.data());
+                        /*hybridWeightsFeature=*/nullptr, weightsTimeDataFloat32.data(),
+                        outputDataFloat32.data(), outputStateDataFloat32.data());
             convertFloat32ToFloat16(outputDataFloat32,
                                     reinterpret_cast<_Float16*>(output_->buffer));
             convertFloat32ToFloat16(outputStateDataFloat32,
@@ -142,10 +144,12 @@ bool SVDF::Eval() {
             break;
         }
         case OperandType::TENSOR_FLOAT32: {
+            const auto hybridWeightsFeature = GetHybridWeightsFeature();
             EvalFloat32(reinterpret_cast<float*>(input_->buffer),
                         reinterpret_cast<float*>(state_in_->buffer),
                         reinterpret_cast<float*>(bias_->buffer),
                         reinterpret_cast<float*>(weights_feature_->buffer),
+                        hybridWeightsFeature ? hybridWeightsFeature->weights.get() : nullptr,
                         reinterpret_cast<float*>(weights_time_->buffer),
                         reinterpret_cast<float*>(output_->buffer),
                         reinterpret_cast<float*>(state_out_->buffer));
@@ -159,9 +163,21 @@ bool SVDF::Eval() {
     return true;
 }
 
+std::shared_ptr<const CachedHybridWeights> SVDF::GetHybridWeightsFeature() const {
+    const float tolerance = cache_ != nullptr ? cache_->getHybridWeightsTolerance() : 0.0f;
+    if (tolerance <= 0.0f || !weights_feature_->isConstant()) {
+        return nullptr;
+    }
+    auto cached = cache_->getOrCreate<CachedHybridWeights>(operation_, kHybridWeightsCacheTag, [&] {
+        return makeCachedHybridWeights(reinterpret_cast<const float*>(weights_feature_->buffer),
+                                       weights_feature_->shape(), tolerance);
+    });
+    return cached->weights != nullptr ? cached : nullptr;
+}
+
 void SVDF::EvalFloat32(const float* inputData, const float* inputStateData, const float* biasData,
-                       const float* weightsFeatureData, const float* weightsTimeData,
-                       float* outputData, float* outputStateData) {
+                       const float* weightsFeatureData, const HybridWeights* hybridWeightsFeature,
+                       const float* weightsTimeData, float* outputData, float* outputStateData) {
     NNTRACE_COMP("SVDF::EvalFloat32");
 
     const int rank = params_.rank_;
@@ -184,8 +200,12 @@ void SVDF::EvalFloat32(const float* inputData, const float* inputStateData, cons
     // Clear scratch (the matmul is accumulative).
     float scratch[batch_size * num_filters];
     std::fill_n(scratch, batch_size * num_filters, 0.0f);
-    tflite::tensor_utils::MatrixBatchVectorMultiplyAccumulate(
-            weightsFeatureData, num_filters, input_size, inputData, batch_size, scratch);
+    if (hybridWeightsFeature != nullptr) {
+        hybridWeightsFeature->multiplyAccumulate(inputData, batch_size, scratch);
+    } else {
+        tflite::tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+                weightsFeatureData, num_filters, input_size, inputData, batch_size, scratch);
+    }
 
     // Copy the latest activation from scratch into activation_state:
     // The last, i.e. (memory_size-1)th entry for each batch, and filter.
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
 #include <vector>
 
 #include "nnapi/Types.h"
@@ -33,12 +34,16 @@ struct SVDFParams {
     TfLiteFusedActivation activation_;
 };
 
+struct CachedHybridWeights;
+class HybridWeights;
+class OperationCache;
 struct RunTimeOperandInfo;
 struct Shape;
 
 class SVDF {
    public:
-    SVDF(const Operation& operation, RunTimeOperandInfo* operands);
+    // "cache", if not null, lets the operation keep its hybrid weights across executions.
+    SVDF(const Operation& operation, RunTimeOperandInfo* operands, OperationCache* cache = nullptr);
 
     static bool Prepare(const Operation& operation, RunTimeOperandInfo* operands, Shape* stateShape,
                         Shape* outputShape);
@@ -56,9 +61,16 @@ class SVDF {
     static constexpr int kOutputTensor = 1;
 
    private:
+    // Returns the hybrid form of the constant float weights_feature, or nullptr if the weights are
+    // used as they are.
+    std::shared_ptr<const CachedHybridWeights> GetHybridWeightsFeature() const;
+
     void EvalFloat32(const float* inputData, const float* inputStateData, const float* biasData,
-                     const float* weightsFeatureData, const float* weightsTimeData,
-                     float* outputData, float* outputStateData);
+                     const float* weightsFeatureData, const HybridWeights* hybridWeightsFeature,
+                     const float* weightsTimeData, float* outputData, float* outputStateData);
+
+    const Operation* operation_;
+    OperationCache* cache_;
 
     SVDFParams params_;
 
@@ -17,8 +17,10 @@
 #define LOG_TAG "Operations"
 
 #include <algorithm>
+#include <array>
 #include <cfloat>
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include "OperationResolver.h"
@@ -112,22 +114,69 @@ bool softmaxFloat16(const _Float16* inputData, const Shape& inputShape, const fl
     return true;
 }
 
-template <typename T>
-bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float beta, int32_t axis,
-                       int32_t inputMultiplier, int32_t inputLeftShift, float diffMin,
-                       T* outputData, const Shape& outputShape) {
-    NNTRACE_TRANS("softmaxQuant8");
-    // The representation chosen for the input to the exp() function is Q5.26.
-    // We need to leave extra space since values that we skip might be as large as
-    // -32 before multiplying by input_beta_multiplier, and therefore as large as
-    // -16 afterwards.  Note that exp(-8) is definitely not insignificant to
-    // accumulation, but exp(-16) definitely is.
-    static const int32_t kScaledDiffIntegerBits = 5;
-    static const int kAccumulationIntegerBits = 12;
-    using FixedPointScaledDiff = gemmlowp::FixedPoint<int32_t, kScaledDiffIntegerBits>;
-    using FixedPointAccum = gemmlowp::FixedPoint<int32_t, kAccumulationIntegerBits>;
-    using FixedPoint0 = gemmlowp::FixedPoint<int32_t, 0>;
+// The representation chosen for the input to the exp() function is Q5.26.
+// We need to leave extra space since values that we skip might be as large as
+// -32 before multiplying by input_beta_multiplier, and therefore as large as
+// -16 afterwards.  Note that exp(-8) is definitely not insignificant to
+// accumulation, but exp(-16) definitely is.
+constexpr int32_t kScaledDiffIntegerBits = 5;
+constexpr int kAccumulationIntegerBits = 12;
+using FixedPointScaledDiff = gemmlowp::FixedPoint<int32_t, kScaledDiffIntegerBits>;
+using FixedPointAccum = gemmlowp::FixedPoint<int32_t, kAccumulationIntegerBits>;
+using FixedPoint0 = gemmlowp::FixedPoint<int32_t, 0>;
+
+// The tag under which the operation caches its SoftmaxExpTable.
+constexpr uint32_t kExpTableCacheTag = 0;
+
+// Computes exp((input - max) * beta) for the difference input - max, or zero if the difference
+// is small enough for the exponent to be insignificant.
+class SoftmaxExp {
+   public:
+    SoftmaxExp(int32_t inputMultiplier, int32_t inputLeftShift, int32_t diffMin)
+        : kInputMultiplier(inputMultiplier),
+          kInputLeftShift(inputLeftShift),
+          kDiffMin(diffMin) {}
+
+    FixedPoint0 operator()(int32_t inputDiff) const {
+        if (inputDiff < kDiffMin) {
+            return FixedPoint0::Zero();
+        }
+        const int32_t inputDiffRescaled = tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
+                inputDiff, kInputMultiplier, kInputLeftShift);
+        return exp_on_negative_values(FixedPointScaledDiff::FromRaw(inputDiffRescaled));
+    }
+
+   private:
+    const int32_t kInputMultiplier;
+    const int32_t kInputLeftShift;
+    const int32_t kDiffMin;
+};
+
+// SoftmaxExp for all 256 possible differences of two 8-bit quantized values. The table only
+// depends on beta and the input scale, so it is built once per operation and cached.
+struct SoftmaxExpTable {
+    static constexpr int32_t kSize = 256;
+
+    SoftmaxExpTable(float beta, float inputScale, const SoftmaxExp& softmaxExp)
+        : beta(beta), inputScale(inputScale) {
+        for (int32_t i = 0; i < kSize; ++i) {
+            exps[i] = softmaxExp(-i).raw();
+        }
+    }
+
+    FixedPoint0 operator()(int32_t inputDiff) const {
+        return FixedPoint0::FromRaw(exps[-inputDiff]);
+    }
 
+    const float beta;
+    const float inputScale;
+    std::array<int32_t, kSize> exps;
+};
+
+template <typename T, typename ExpFn>
+bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, int32_t axis,
+                       const ExpFn& expOnNegativeDiff, T* outputData, const Shape& outputShape) {
+    NNTRACE_TRANS("softmaxQuant8");
     const uint32_t outerSize = getNumberOfElements(inputShape, 0, axis);
     const uint32_t axisSize = getSizeOfDimension(inputShape, axis);
     const uint32_t innerSize =
@@ -143,18 +192,12 @@ bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float
                 maxValue = std::max(maxValue, *p);
             }
 
-            // Compute sum
+            // Compute sum. Insignificant differences contribute zero.
             FixedPointAccum sum_of_exps = FixedPointAccum::Zero();
             for (const T* p = inputBeg; p < inputEnd; p += innerSize) {
                 int32_t input_diff = static_cast<int32_t>(*p) - maxValue;
-                if (input_diff >= diffMin) {
-                    const int32_t input_diff_rescaled =
-                            tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
-                                    input_diff, inputMultiplier, inputLeftShift);
-                    const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
-                    sum_of_exps = sum_of_exps + gemmlowp::Rescale<kAccumulationIntegerBits>(
-                                                        exp_on_negative_values(scaled_diff_f8));
-                }
+                sum_of_exps = sum_of_exps + gemmlowp::Rescale<kAccumulationIntegerBits>(
+                                                    expOnNegativeDiff(input_diff));
             }
 
             uint32_t fixed_sum_of_exps = static_cast<uint32_t>(sum_of_exps.raw());
@@ -169,30 +212,21 @@ bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float
             FixedPoint0 shifted_scale = gemmlowp::one_over_one_plus_x_for_x_in_0_1(
                     FixedPoint0::FromRaw(shifted_sum_minus_one));
 
-            // Compute result
+            // Compute result. An insignificant difference has a zero exponent, which yields the
+            // lowest representable output.
             constexpr int32_t q_min = std::numeric_limits<T>::min();
             constexpr int32_t q_max = std::numeric_limits<T>::max();
             T* pOut = outputBeg;
             for (const T* p = inputBeg; p < inputEnd; p += innerSize, pOut += innerSize) {
                 int32_t input_diff = static_cast<int32_t>(*p) - maxValue;
-                if (input_diff >= diffMin) {
-                    const int32_t input_diff_rescaled =
-                            tflite::MultiplyByQuantizedMultiplierGreaterThanOne(
-                                    input_diff, inputMultiplier, inputLeftShift);
-                    const auto scaled_diff_f8 = FixedPointScaledDiff::FromRaw(input_diff_rescaled);
-
-                    FixedPoint0 exp_in_0 = exp_on_negative_values(scaled_diff_f8);
-                    int32_t unsat_output = gemmlowp::RoundingDivideByPOT(
-                            (shifted_scale * exp_in_0).raw(), num_bits_over_unit + 31 - 8);
-                    if (std::is_same_v<T, int8_t>) {
-                        unsat_output -= 128;
-                    }
-
-                    *pOut = static_cast<T>(std::max(std::min(unsat_output, q_max), q_min));
-
-                } else {
-                    *pOut = std::is_same_v<T, int8_t> ? -128 : 0;
+                FixedPoint0 exp_in_0 = expOnNegativeDiff(input_diff);
+                int32_t unsat_output = gemmlowp::RoundingDivideByPOT(
+                        (shifted_scale * exp_in_0).raw(), num_bits_over_unit + 31 - 8);
+                if (std::is_same_v<T, int8_t>) {
+                    unsat_output -= 128;
                 }
+
+                *pOut = static_cast<T>(std::max(std::min(unsat_output, q_max), q_min));
             }
         }
     }
@@ -201,7 +235,7 @@ bool softmaxQuant8Impl(const T* inputData, const Shape& inputShape, const float
 
 template <typename T>
 bool softmaxQuant8(const T* inputData, const Shape& inputShape, const float beta, int32_t axis,
-                   T* outputData, const Shape& outputShape) {
+                   T* outputData, const Shape& outputShape, IOperationExecutionContext* context) {
     int32_t ndim = getNumberOfDimensions(inputShape);
     NN_CHECK(handleNegativeAxis(inputShape, &axis));
 
@@ -213,7 +247,6 @@ bool softmaxQuant8(const T* inputData, const Shape& inputShape, const float beta
         return false;
     }
 
-    static const int32_t kScaledDiffIntegerBits = 5;
     const double input_beta_real_multiplier =
             std::min(1.0 * beta * inputShape.scale * (1 << (31 - kScaledDiffIntegerBits)),
                      (1LL << 31) - 1.0);
@@ -224,9 +257,26 @@ bool softmaxQuant8(const T* inputData, const Shape& inputShape, const float beta
         return false;
     }
     int32_t diffMin = -CalculateInputRadius(kScaledDiffIntegerBits, inputLeftShift);
+    const SoftmaxExp softmaxExp(inputMultiplier, inputLeftShift, diffMin);
+
+    // Each element needs two exponents, so without a cache the table only pays off for tensors
+    // at least half its size.
+    if (!context->hasOperationCache() &&
+        getNumberOfElements(inputShape) < SoftmaxExpTable::kSize / 2) {
+        return softmaxQuant8Impl(inputData, inputShape, axis, softmaxExp, outputData,
+                                 outputShape);
+    }
 
-    return softmaxQuant8Impl(inputData, inputShape, beta, axis, inputMultiplier, inputLeftShift,
-                             diffMin, outputData, outputShape);
+    // Beta is a scalar operand and may be a model input, so the cached table is checked against
+    // the current parameters.
+    auto table = std::static_pointer_cast<const SoftmaxExpTable>(
+            context->getCachedData(kExpTableCacheTag));
+    if (table == nullptr || table->beta != beta || table->inputScale != inputShape.scale) {
+        NNTRACE_COMP("softmaxQuant8::makeExpTable");
+        table = std::make_shared<SoftmaxExpTable>(beta, inputShape.scale, softmaxExp);
+        context->setCachedData(kExpTableCacheTag, table);
+    }
+    return softmaxQuant8Impl(inputData, inputShape, axis, *table, outputData, outputShape);
 }
 
 }  // namespace
@@ -305,13 +355,13 @@ bool execute(IOperationExecutionContext* context) {
                                  context->getInputShape(kInputTensor),
                                  context->getInputValue<float>(kBetaScalar), axis,
                                  context->getOutputBuffer<uint8_t>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor), context);
         case OperandType::TENSOR_QUANT8_ASYMM_SIGNED:
             return softmaxQuant8(context->getInputBuffer<int8_t>(kInputTensor),
                                  context->getInputShape(kInputTensor),
                                  context->getInputValue<float>(kBetaScalar), axis,
                                  context->getOutputBuffer<int8_t>(kOutputTensor),
-                                 context->getOutputShape(kOutputTensor));
+                                 context->getOutputShape(kOutputTensor), context);
         default:
             NN_RET_CHECK_FAIL() << "Unsupported tensor type for operation " << kOperationName;
     }
@@ -20,7 +20,9 @@
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 
+#include "BlockCopy.h"
 #include "Tracing.h"
 
 namespace android {
@@ -66,9 +68,31 @@ std::pair<int, int> TileOneDimension(const Shape& input_shape, const T* in_data,
 }
 
 template <typename T>
-void tileImpl(const T* inputData, const Shape& inputShape, const int32_t* multiples, T* outputData,
+bool tileImpl(const T* inputData, const Shape& inputShape, const int32_t* multiples, T* outputData,
               const Shape& outputShape) {
-    TileOneDimension(inputShape, inputData, multiples, outputData, 0);
+    // Each output dimension is viewed as [multiple, size], where the outer dimension does not
+    // advance the input, i.e. it repeats the input slice.
+    const uint32_t numDimensions = getNumberOfDimensions(inputShape);
+    std::vector<BlockCopyDimension> dimensions(2 * numDimensions);
+    uint32_t inputStride = 1;
+    uint32_t numViewDimensions = 0;
+    for (uint32_t i = numDimensions; i-- > 0;) {
+        const uint32_t size = getSizeOfDimension(inputShape, i);
+        dimensions[2 * i] = {static_cast<uint32_t>(multiples[i]), 0};
+        dimensions[2 * i + 1] = {size, inputStride};
+        inputStride *= size;
+        numViewDimensions += (multiples[i] != 1) + (size != 1);
+    }
+    if (numViewDimensions > kMaxBlockCopyDimensions) {
+        // The view of a high rank input may not fit into a BlockCopyPlan even after unit
+        // dimensions are dropped. Tile one dimension at a time instead.
+        TileOneDimension(inputShape, inputData, multiples, outputData, 0);
+        return true;
+    }
+    BlockCopyPlan plan;
+    NN_RET_CHECK(plan.initialize(sizeof(T), dimensions.data(), dimensions.size()));
+    plan.execute(inputData, outputData);
+    return true;
 }
 
 }  // namespace
@@ -90,12 +114,11 @@ bool prepare(const Shape& input, const int32_t* multiples, const Shape& multiple
 bool eval(const uint8_t* inputData, const Shape& inputShape, const int32_t* multiples,
           uint8_t* outputData, const Shape& outputShape) {
     NNTRACE_TRANS("tile::eval");
-#define ANDROID_NN_IMPL_TILE(operandType, dataType)                                   \
-    case operandType: {                                                               \
-        NNTRACE_COMP_SWITCH("tileImpl::" #dataType);                                  \
-        tileImpl(reinterpret_cast<const dataType*>(inputData), inputShape, multiples, \
-                 reinterpret_cast<dataType*>(outputData), outputShape);               \
-        return true;                                                                  \
+#define ANDROID_NN_IMPL_TILE(operandType, dataType)                                          \
+    case operandType: {                                                                      \
+        NNTRACE_COMP_SWITCH("tileImpl::" #dataType);                                         \
+        return tileImpl(reinterpret_cast<const dataType*>(inputData), inputShape, multiples, \
+                        reinterpret_cast<dataType*>(outputData), outputShape);               \
     }
 
     switch (inputShape.type) {
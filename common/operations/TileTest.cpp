@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Tile.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+namespace android {
+namespace nn {
+namespace {
+
+// Evaluates TILE element by element.
+template <typename T>
+std::vector<T> referenceTile(const std::vector<T>& input, const Shape& inputShape,
+                             const Shape& outputShape) {
+    const uint32_t rank = inputShape.dimensions.size();
+    std::vector<T> output(getNumberOfElements(outputShape));
+    for (uint32_t i = 0; i < output.size(); ++i) {
+        uint32_t remainder = i;
+        uint32_t inputIndex = 0;
+        uint32_t inputStride = 1;
+        for (uint32_t d = rank; d-- > 0;) {
+            const uint32_t outputCoordinate = remainder % outputShape.dimensions[d];
+            remainder /= outputShape.dimensions[d];
+            inputIndex += (outputCoordinate % inputShape.dimensions[d]) * inputStride;
+            inputStride *= inputShape.dimensions[d];
+        }
+        output[i] = input[inputIndex];
+    }
+    return output;
+}
+
+template <typename T>
+void testTile(OperandType type, const std::vector<uint32_t>& dimensions,
+              const std::vector<int32_t>& multiples) {
+    Shape inputShape;
+    inputShape.type = type;
+    inputShape.dimensions = dimensions;
+    const Shape multiplesShape = {.type = OperandType::TENSOR_INT32,
+                                  .dimensions = {static_cast<uint32_t>(multiples.size())}};
+    Shape outputShape;
+    ASSERT_TRUE(tile::prepare(inputShape, multiples.data(), multiplesShape, &outputShape));
+
+    std::vector<T> input(getNumberOfElements(inputShape));
+    std::iota(input.begin(), input.end(), static_cast<T>(1));
+    const std::vector<T> expected = referenceTile(input, inputShape, outputShape);
+
+    std::vector<T> output(expected.size());
+    ASSERT_TRUE(tile::eval(reinterpret_cast<const uint8_t*>(input.data()), inputShape,
+                           multiples.data(), reinterpret_cast<uint8_t*>(output.data()),
+                           outputShape));
+    EXPECT_EQ(output, expected);
+}
+
+TEST(TileTest, LowRank) {
+    testTile<float>(OperandType::TENSOR_FLOAT32, {2, 3}, {3, 2});
+    testTile<int32_t>(OperandType::TENSOR_INT32, {4, 1, 3}, {1, 7, 2});
+}
+
+TEST(TileTest, HighRank) {
+    // Rank 8 with every multiple and size above 1 has the largest view that a block copy plan
+    // holds.
+    testTile<float>(OperandType::TENSOR_FLOAT32, {2, 2, 2, 2, 2, 2, 2, 2},
+                    {2, 2, 2, 2, 2, 2, 2, 2});
+    // Unit multiples and sizes do not count towards the limit.
+    testTile<uint8_t>(OperandType::TENSOR_QUANT8_ASYMM, {2, 1, 3, 2, 1, 2, 3, 2, 2},
+                      {1, 3, 2, 1, 2, 2, 1, 2, 2});
+    // Views beyond the limit are tiled one dimension at a time.
+    testTile<uint8_t>(OperandType::TENSOR_QUANT8_ASYMM, {2, 2, 2, 2, 2, 2, 2, 2, 2},
+                      {2, 2, 2, 2, 2, 2, 2, 2, 2});
+    testTile<int32_t>(OperandType::TENSOR_INT32, {2, 1, 2, 2, 1, 2, 2, 2, 2, 1},
+                      {2, 3, 2, 2, 2, 2, 2, 2, 2, 2});
+}
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
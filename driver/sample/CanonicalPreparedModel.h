@@ -63,6 +63,7 @@ class PreparedModel final : public IPreparedModel,
     const IOperationResolver& kOperationResolver;
     const std::shared_ptr<BufferTracker> kBufferTracker;
     const std::vector<RunTimePoolInfo> kPoolInfos;
+    const std::unique_ptr<OperationCache> kOperationCache = std::make_unique<OperationCache>();
 };
 
 }  // namespace android::nn::sample
@@ -25,26 +25,47 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "BurstBuilder.h"
 #include "ExecutionBuilder.h"
 #include "ExecutionPlan.h"
 #include "Manager.h"
+#include "Memory.h"
 #include "ModelBuilder.h"
+#include "PartitioningPlanCache.h"
+#include "PartitioningProfile.h"
 
 namespace android {
 namespace nn {
 
+namespace {
+
+// Returns the largest operation count of "model" and the models it references.
+uint32_t getMaxOperationCount(const ModelBuilder* model) {
+    uint32_t count = model->operationCount();
+    for (uint32_t i = 0; i < model->referencedModelCount(); ++i) {
+        count = std::max(count, getMaxOperationCount(model->getReferencedModel(i)));
+    }
+    return count;
+}
+
+}  // namespace
+
 CompilationBuilder::CompilationBuilder(const ModelBuilder* model,
                                        const std::vector<std::shared_ptr<Device>>& devices,
                                        bool explicitDeviceList)
     : mModel(model),
-      mPartitioning(explicitDeviceList ? DeviceManager::kPartitioningWithoutFallback
-                                       : DeviceManager::get()->getPartitioning()),
+      mPartitioning(explicitDeviceList
+                            ? DeviceManager::kPartitioningWithoutFallback |
+                                      (DeviceManager::get()->getPartitioning() &
+                                       ~DeviceManager::kPartitioningModeMask)
+                            : DeviceManager::get()->getPartitioning()),
       mDevices(devices),
       mExplicitDeviceList(explicitDeviceList) {
     VLOG(COMPILATION) << "CompilationBuilder::CompilationBuilder";
@@ -60,14 +81,58 @@ int CompilationBuilder::finish() {
     const auto deadline = makeDeadline(mTimeoutDuration);
 
     mFinished = true;
+    mCpuFallback = std::make_unique<CpuFallbackPreparedModel>(mModel, mPreference, mPriority);
     if (mIsCacheInfoProvided) {
         mPlan.setCaching(&mCacheInfo, mToken);
+        const auto* cacheDir = std::get_if<CacheDir>(&mCacheInfo.variant);
+        if (cacheDir != nullptr && DeviceManager::partitioningUsesProfile(mPartitioning)) {
+            mPlan.setProfile(
+                    PartitioningProfile::load(*cacheDir, mToken, mModel->operationCount()));
+        } else if (cacheDir != nullptr && DeviceManager::partitioningIsEnabled(mPartitioning) &&
+                   DeviceManager::get()->cachePartitioningPlans()) {
+            // Profile guided partitioning revises the assignment as measurements
+            // come in, so it is not cached.
+            mPlan.setPlanCache(PartitioningPlanCache::load(
+                    *cacheDir, mToken,
+                    PartitioningPlanCache::makeKey(mDevices, mPreference, mPriority,
+                                                   mPartitioning),
+                    getMaxOperationCount(mModel)));
+        }
     }
-    if (mPartitioning) {
+    if (DeviceManager::partitioningIsEnabled(mPartitioning)) {
         int n = mModel->partitionTheWork(mDevices, mPreference, mPriority, deadline, &mPlan,
-                                         mFailPartitioning);
+                                         mFailPartitioning,
+                                         DeviceManager::partitioningUsesCostModel(mPartitioning));
+        if (PartitioningPlanCache* planCache = mPlan.getPlanCache()) {
+            // Don't reuse an assignment that led to a failure. The model might
+            // still compile with a fresh assignment, for example if a driver
+            // changed without changing its version.
+            if (n != ANEURALNETWORKS_NO_ERROR && planCache->usedAssignment()) {
+                LOG(WARNING) << "CompilationBuilder::finish: the cached device assignment "
+                                "failed, partitioning again";
+                planCache->remove();
+                mPlan.reset();
+                n = mModel->partitionTheWork(
+                        mDevices, mPreference, mPriority, deadline, &mPlan, mFailPartitioning,
+                        DeviceManager::partitioningUsesCostModel(mPartitioning));
+            }
+            if (n == ANEURALNETWORKS_NO_ERROR) {
+                planCache->save();
+            } else {
+                planCache->remove();
+            }
+            mPlan.setPlanCache(nullptr);
+        }
         switch (n) {
             case ANEURALNETWORKS_NO_ERROR:
+                if (mPipelineDepth > 0 && mPlan.canPipelineSteps()) {
+                    // getNextStepIndex() is the number of steps of the finished plan.
+                    mPipeline = std::make_unique<ExecutionPipeline>(mPipelineDepth,
+                                                                    mPlan.getNextStepIndex());
+                } else if (mPipelineDepth > 0) {
+                    VLOG(COMPILATION) << "CompilationBuilder::finish: executions of this "
+                                         "compilation can't be pipelined";
+                }
                 return n;
             case ANEURALNETWORKS_UNEXPECTED_NULL:
             case ANEURALNETWORKS_BAD_DATA:
@@ -216,6 +281,62 @@ int CompilationBuilder::setTimeoutDuration(uint64_t duration) {
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int CompilationBuilder::setPipelineDepth(uint32_t depth) {
+    if (mFinished) {
+        LOG(ERROR) << "ANeuralNetworksCompilation_setPipelineDepth can't modify after compilation "
+                      "finished";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    mPipelineDepth = depth;
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+// Collects the (offset, length) ranges of the constant values of "model" and
+// of the models it references, by the memory that holds them.
+static void findConstants(
+        const ModelBuilder* model,
+        std::map<const RuntimeMemory*, std::vector<std::pair<uint32_t, uint32_t>>>* ranges) {
+    const MemoryTracker& memories = model->getMemories();
+    for (uint32_t i = 0; i < model->operandCount(); i++) {
+        const Operand& operand = model->getOperand(i);
+        if (operand.lifetime == Operand::LifeTime::CONSTANT_REFERENCE &&
+            operand.location.poolIndex < memories.size()) {
+            (*ranges)[memories[operand.location.poolIndex]].emplace_back(
+                    operand.location.offset, operand.location.length);
+        }
+    }
+    for (uint32_t i = 0; i < model->referencedModelCount(); i++) {
+        findConstants(model->getReferencedModel(i), ranges);
+    }
+}
+
+// Advises the kernel that the constant values of "model" and of the models it
+// references will be needed. For a file-backed memory, this starts reading the
+// values into the page cache in the background.
+static void warmConstants(const ModelBuilder* model) {
+    std::map<const RuntimeMemory*, std::vector<std::pair<uint32_t, uint32_t>>> ranges;
+    findConstants(model, &ranges);
+    for (auto& [memory, memoryRanges] : ranges) {
+        if (const auto poolInfo = memory->getRunTimePoolInfo()) {
+            poolInfo->adviseRanges(RunTimePoolInfo::AccessHint::WILL_NEED,
+                                   std::move(memoryRanges));
+        }
+    }
+}
+
+int CompilationBuilder::warm() const {
+    if (!mFinished) {
+        LOG(ERROR) << "ANeuralNetworksCompilation_warm passed an unfinished compilation";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    if (!mPlan.isValid()) {
+        LOG(ERROR) << "ANeuralNetworksCompilation_warm passed an invalid compilation";
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    warmConstants(mModel);
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int CompilationBuilder::forTest_setPartitioning(uint32_t partitioning) {
     if (mFinished) {
         LOG(ERROR) << "CompilationBuilder::forTest_setPartitioning can't modify after compilation "
@@ -364,6 +485,17 @@ int CompilationBuilder::createBurst(BurstBuilder** burst) {
     return (*burst ? ANEURALNETWORKS_NO_ERROR : ANEURALNETWORKS_OUT_OF_MEMORY);
 }
 
+BurstBuilder* CompilationBuilder::getBatchBurst() const {
+    if (!mFinished || !mPlan.isValid()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mBatchBurstMutex);
+    if (mBatchBurst == nullptr) {
+        mBatchBurst = std::make_unique<BurstBuilder>(this, mPlan.makeBursts());
+    }
+    return mBatchBurst.get();
+}
+
 int CompilationBuilder::forEachStepRoleOfInput(uint32_t index,
                                                const StepRoleCallback& callback) const {
     if (!mFinished) {
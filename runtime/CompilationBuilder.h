@@ -17,12 +17,17 @@
 #ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_COMPILATION_BUILDER_H
 #define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_COMPILATION_BUILDER_H
 
+#include <android-base/thread_annotations.h>
+
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "BurstBuilder.h"
+#include "ExecutionPipeline.h"
 #include "ExecutionPlan.h"
 #include "Manager.h"
 #include "NeuralNetworks.h"
@@ -30,7 +35,6 @@
 namespace android {
 namespace nn {
 
-class BurstBuilder;
 class Device;
 class ExecutionBuilder;
 class ModelBuilder;
@@ -58,8 +62,14 @@ class CompilationBuilder {
 
     int setTimeoutDuration(uint64_t duration);
 
+    int setPipelineDepth(uint32_t depth);
+
     int finish();
 
+    // Starts reading the constant values of the model into memory, so that
+    // the first execution does not wait for them. Only valid after finish().
+    int warm() const;
+
     int getPreferredMemoryAlignmentForInput(uint32_t index, uint32_t* alignment) const;
     int getPreferredMemoryPaddingForInput(uint32_t index, uint32_t* padding) const;
     int getPreferredMemoryAlignmentForOutput(uint32_t index, uint32_t* alignment) const;
@@ -69,6 +79,11 @@ class CompilationBuilder {
 
     int createBurst(BurstBuilder** burst);
 
+    // The burst that the batches of executions of this compilation run on (see
+    // ExecutionBuilder::computeBatch), created on first use. Returns nullptr if
+    // the compilation is not finished or not valid.
+    BurstBuilder* getBatchBurst() const;
+
     const ModelBuilder* getModel() const { return mModel; }
 
     int forEachStepRoleOfInput(uint32_t index, const StepRoleCallback& callback) const;
@@ -78,6 +93,14 @@ class CompilationBuilder {
 
     bool hasDynamicTemporaries() const { return mPlan.hasDynamicTemporaries(); }
 
+    // The pipeline that schedules the executions of this compilation, or
+    // nullptr if they are not pipelined.
+    ExecutionPipeline* getPipeline() const { return mPipeline.get(); }
+
+    // The model of this compilation prepared on the CPU, for executions that
+    // fall back to the CPU. Only valid after finish().
+    CpuFallbackPreparedModel* getCpuFallback() const { return mCpuFallback.get(); }
+
     // These functions are solely intended for use by unit tests of the
     // partitioning algorithm.
     const ExecutionPlan& forTest_getExecutionPlan() const { return mPlan; }
@@ -124,6 +147,17 @@ class CompilationBuilder {
 
     // Amount of time to complete or abort the execution.
     std::optional<uint64_t> mTimeoutDuration;
+
+    // The maximum number of pipelined executions, or 0 if executions are not
+    // pipelined. See ANeuralNetworksCompilation_setPipelineDepth.
+    uint32_t mPipelineDepth = 0;
+    std::unique_ptr<ExecutionPipeline> mPipeline;
+
+    std::unique_ptr<CpuFallbackPreparedModel> mCpuFallback;
+
+    // See getBatchBurst().
+    mutable std::mutex mBatchBurstMutex;
+    mutable std::unique_ptr<BurstBuilder> mBatchBurst GUARDED_BY(mBatchBurstMutex);
 };
 
 }  // namespace nn
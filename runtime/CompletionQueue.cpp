@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CompletionQueue"
+
+#include "CompletionQueue.h"
+
+#include <LegacyUtils.h>
+#include <android-base/logging.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace android {
+namespace nn {
+
+std::unique_ptr<CompletionQueue> CompletionQueue::create() {
+    base::unique_fd eventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (!eventFd.ok()) {
+        PLOG(ERROR) << "CompletionQueue::create failed to create an eventfd";
+        return nullptr;
+    }
+    // Can't use std::make_unique because the constructor is private.
+    return std::unique_ptr<CompletionQueue>(new CompletionQueue(std::move(eventFd)));
+}
+
+void CompletionQueue::onStart() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunningCount++;
+}
+
+void CompletionQueue::post(ExecutionBuilder* execution, int resultCode) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    CHECK_GT(mRunningCount, 0u);
+    mRunningCount--;
+    // The eventfd is written and drained with mMutex held, so that it is
+    // readable exactly when mCompletions is not empty.
+    if (mCompletions.empty()) {
+        const uint64_t one = 1;
+        if (TEMP_FAILURE_RETRY(write(mEventFd.get(), &one, sizeof(one))) != sizeof(one)) {
+            PLOG(ERROR) << "CompletionQueue::post failed to signal the eventfd";
+        }
+    }
+    mCompletions.push_back({.execution = execution, .resultCode = resultCode});
+}
+
+uint32_t CompletionQueue::dequeue(ExecutionBuilder** executions, int* resultCodes,
+                                  uint32_t capacity) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const uint32_t count = std::min<size_t>(capacity, mCompletions.size());
+    for (uint32_t i = 0; i < count; i++) {
+        executions[i] = mCompletions.front().execution;
+        resultCodes[i] = mCompletions.front().resultCode;
+        mCompletions.pop_front();
+    }
+    if (count > 0 && mCompletions.empty()) {
+        uint64_t value = 0;
+        if (TEMP_FAILURE_RETRY(read(mEventFd.get(), &value, sizeof(value))) != sizeof(value)) {
+            PLOG(ERROR) << "CompletionQueue::dequeue failed to reset the eventfd";
+        }
+    }
+    VLOG(EXECUTION) << "CompletionQueue::dequeue: " << count << " completions";
+    return count;
+}
+
+bool CompletionQueue::hasRunningComputations() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRunningCount > 0;
+}
+
+}  // namespace nn
+}  // namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_COMPLETION_QUEUE_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_COMPLETION_QUEUE_H
+
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace android {
+namespace nn {
+
+class ExecutionBuilder;
+
+// Collects the asynchronous computations that have completed, so that a
+// single thread can wait for many computations at once (see
+// ANeuralNetworksCompletionQueue). The queue has an eventfd that is readable
+// exactly when the queue is not empty, for use with poll() and similar.
+class CompletionQueue {
+    DISALLOW_COPY_AND_ASSIGN(CompletionQueue);
+
+   public:
+    // Returns nullptr if the eventfd cannot be created.
+    static std::unique_ptr<CompletionQueue> create();
+
+    int getFd() const { return mEventFd.get(); }
+
+    // Called when a computation that reports to this queue is started, before
+    // its completion can be posted.
+    void onStart();
+
+    // Records that the computation of "execution" has completed.
+    void post(ExecutionBuilder* execution, int resultCode);
+
+    // Removes up to "capacity" completions, oldest first, stores them in
+    // "executions" and "resultCodes", and returns their number. Doesn't block.
+    uint32_t dequeue(ExecutionBuilder** executions, int* resultCodes, uint32_t capacity);
+
+    // Whether some computations have been started but have not completed yet.
+    bool hasRunningComputations() const;
+
+   private:
+    struct Completion {
+        ExecutionBuilder* execution;
+        int resultCode;
+    };
+
+    explicit CompletionQueue(base::unique_fd eventFd) : mEventFd(std::move(eventFd)) {}
+
+    const base::unique_fd mEventFd;
+    mutable std::mutex mMutex;
+    std::deque<Completion> mCompletions GUARDED_BY(mMutex);
+    uint32_t mRunningCount GUARDED_BY(mMutex) = 0;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_COMPLETION_QUEUE_H
@@ -23,11 +23,13 @@
 #include <LegacyUtils.h>
 #include <Tracing.h>
 #include <android-base/logging.h>
+#include <android-base/scopeguard.h>
 #include <nnapi/IBurst.h>
 #include <nnapi/IPreparedModel.h>
 #include <nnapi/Types.h>
 
 #include <algorithm>
+#include <condition_variable>
 #include <limits>
 #include <map>
 #include <memory>
@@ -41,7 +43,9 @@
 
 #include "BurstBuilder.h"
 #include "CompilationBuilder.h"
+#include "CompletionQueue.h"
 #include "Manager.h"
+#include "MemoryRecycler.h"
 #include "ModelArgumentInfo.h"
 #include "ModelBuilder.h"
 #include "TypeManager.h"
@@ -49,6 +53,10 @@
 namespace android {
 namespace nn {
 
+// The maximum number of steps that CompoundExecutionBuilder::computeConcurrently
+// runs at the same time.
+constexpr size_t kMaxConcurrentSteps = 4;
+
 // Partial validation of output shapes returned from driver, to ensure they
 // conform to a very specific set of rules.
 static bool validateOutputShapesFromDriver(ErrorStatus executionStatus, const ModelBuilder* model,
@@ -194,6 +202,15 @@ int ExecutionBuilder::setInput(uint32_t index, const ANeuralNetworksOperandType*
         LOG(ERROR) << "ANeuralNetworksExecution_setInput input exceeds max length " << length;
         return ANEURALNETWORKS_BAD_DATA;
     }
+    if (buffer != nullptr && length > 0) {
+        // A buffer allocated with ANeuralNetworks_allocateSharedBuffer is passed to the drivers
+        // as a memory pool, which saves copying it into and out of shared memory.
+        uint32_t offset = 0;
+        if (const RuntimeMemory* memory =
+                    SharedBufferRegistry::get().find(buffer, length, &offset)) {
+            return setInputFromMemory(index, type, memory, offset, length);
+        }
+    }
     uint32_t l = static_cast<uint32_t>(length);
     if (!mInputs[index].unspecified()) {
         LOG(ERROR) << "ANeuralNetworksExecution_setInput called when an input has already been "
@@ -276,6 +293,14 @@ int ExecutionBuilder::setOutput(uint32_t index, const ANeuralNetworksOperandType
         LOG(ERROR) << "ANeuralNetworksExecution_setOutput input exceeds max length " << length;
         return ANEURALNETWORKS_BAD_DATA;
     }
+    if (buffer != nullptr && length > 0) {
+        // See setInput().
+        uint32_t offset = 0;
+        if (const RuntimeMemory* memory =
+                    SharedBufferRegistry::get().find(buffer, length, &offset)) {
+            return setOutputFromMemory(index, type, memory, offset, length);
+        }
+    }
     uint32_t l = static_cast<uint32_t>(length);
     if (!mOutputs[index].unspecified()) {
         LOG(ERROR) << "ANeuralNetworksExecution_setOutput called when an output has already been "
@@ -539,10 +564,20 @@ bool ExecutionBuilder::checkAndSetComputationState(const char* name) {
                    << " called on an execution that has already started";
         return false;
     }
+    mCancelled = false;
     mState = State::COMPUTATION;
     return true;
 }
 
+int ExecutionBuilder::cancel() {
+    std::lock_guard<std::mutex> lock(mStateMutex);
+    if (mState == State::COMPUTATION) {
+        VLOG(EXECUTION) << "ExecutionBuilder::cancel";
+        mCancelled = true;
+    }
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 // TODO(b/132321855): validate that we have full types for all inputs and outputs,
 // that the graph is not cyclic,
 static int validateRequest(const std::vector<ModelArgumentInfo>& inputs,
@@ -650,9 +685,11 @@ std::tuple<int, std::vector<OutputShape>, Timing> SimpleExecutionBuilder::comput
     }
 
     auto burstController = burstBuilder ? burstBuilder->getControllerAt(0) : nullptr;
+    const TimePoint start = Clock::now();
     auto [n, outputShapes, timing] = mExecutor->compute(deadline, burstController);
 
     if (n == ANEURALNETWORKS_NO_ERROR) {
+        mPlan->recordStepDuration(nullptr, Clock::now() - start);
         return {n, std::move(outputShapes), timing};
     }
 
@@ -681,7 +718,13 @@ std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::comp
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "CompoundExecutionBuilder::computeInternal");
     VLOG(EXECUTION) << "CompoundExecutionBuilder::computeInternal (from plan, iteratively)";
 
-    auto controller = mPlan->makeController(this, burstBuilder);
+    if (DeviceManager::get()->concurrentSteps() && mPlan->canRunStepsConcurrently()) {
+        return computeConcurrently(deadline, burstBuilder);
+    }
+
+    auto controller = mReusable && areOutputsFullySpecified()
+                              ? mPlan->makeReusableController(this, burstBuilder, &mController)
+                              : mPlan->makeController(this, burstBuilder);
     std::vector<OutputShape> outputShapes = getInitialOutputShapes();
 
     // On this iteration, do I need to repeat the previous step because it
@@ -689,6 +732,12 @@ std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::comp
     bool doInsufficientSizeFallback = false;
 
     while (true) {
+        // Don't start the next step of a cancelled computation.
+        if (isCancelled()) {
+            VLOG(EXECUTION) << "CompoundExecutionBuilder::computeInternal cancelled";
+            return {ANEURALNETWORKS_OP_FAILED, {}, {}};
+        }
+
         VLOG(EXECUTION) << "looking for next StepExecutor";
 
         // Get the current step of the execution.
@@ -715,7 +764,19 @@ std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::comp
         const bool executorIsCpu = executor->isCpu();
 
         // Attempt to execute a single step of the execution.
+        if (mPipelineTicket) {
+            mCompilation->getPipeline()->waitForStage(*mPipelineTicket,
+                                                      executor->getExecutionStep()->getIndex());
+        }
+        const TimePoint start = Clock::now();
         auto [stepN, stepOutputShapes, _] = executor->compute(deadline, burstController);
+        if (stepN == ANEURALNETWORKS_NO_ERROR) {
+            mPlan->recordStepDuration(executor->getExecutionStep(), Clock::now() - start);
+        }
+        if (mPipelineTicket) {
+            mCompilation->getPipeline()->finishStage(*mPipelineTicket,
+                                                     executor->getExecutionStep()->getIndex());
+        }
 
         // Update global outputs and dynamic temporaries.
         StepExecutor::UpdateOutputShapes updateOutputShapes = {};
@@ -830,6 +891,169 @@ std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::comp
     return cpuFallbackFull(this);
 }
 
+std::tuple<int, std::vector<OutputShape>, Timing> CompoundExecutionBuilder::computeConcurrently(
+        const OptionalTimePoint& deadline, BurstBuilder* burstBuilder) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "CompoundExecutionBuilder::computeConcurrently");
+    VLOG(EXECUTION) << "CompoundExecutionBuilder::computeConcurrently";
+    CHECK(mPlan->canRunStepsConcurrently());
+
+    auto controller = mPlan->makeController(this, burstBuilder);
+    std::vector<OutputShape> outputShapes = getInitialOutputShapes();
+
+    // Set up all the steps before running any of them. Without control flow
+    // and dynamic temporaries, the setup of a step does not depend on the
+    // results of earlier steps.
+    std::vector<std::shared_ptr<StepExecutor>> executors;
+    std::vector<SharedBurst> burstControllers;
+    while (true) {
+        std::shared_ptr<StepExecutor> executor;
+        SharedBurst burstController;
+        const int n = mPlan->next(controller, &executor, &burstController, &outputShapes);
+        if (n != ANEURALNETWORKS_NO_ERROR) {
+            // See computeInternal().
+            bool missedDeadline = n == ANEURALNETWORKS_MISSED_DEADLINE_TRANSIENT ||
+                                  n == ANEURALNETWORKS_MISSED_DEADLINE_PERSISTENT;
+            if (mAllowCpuFallback && !missedDeadline) {
+                return cpuFallbackFull(this);
+            }
+            return {n, {}, {}};
+        }
+        if (executor == nullptr) {
+            break;
+        }
+        CHECK_EQ(executor->getExecutionStep()->getIndex(), executors.size());
+        executors.push_back(std::move(executor));
+        burstControllers.push_back(std::move(burstController));
+    }
+
+    // A step is ready once all the steps it depends on are done. Dependencies
+    // always precede a step in the plan.
+    const size_t stepCount = executors.size();
+    std::vector<uint32_t> pendingDependencies(stepCount);
+    std::vector<std::vector<uint32_t>> dependents(stepCount);
+    std::vector<uint32_t> readySteps;
+    for (uint32_t stepIndex = 0; stepIndex < stepCount; ++stepIndex) {
+        const auto& dependencies = mPlan->getStepDependencies(stepIndex);
+        for (uint32_t dependency : dependencies) {
+            CHECK_LT(dependency, stepIndex);
+            dependents[dependency].push_back(stepIndex);
+        }
+        pendingDependencies[stepIndex] = dependencies.size();
+        if (dependencies.empty()) {
+            readySteps.push_back(stepIndex);
+        }
+    }
+
+    // A bounded number of threads, including this one, take ready steps in
+    // plan order and run them. No step is started after a step has failed or
+    // the computation has been cancelled. The steps that depend on a failed
+    // step never become ready, so the first failed step in plan order is the
+    // root cause of the failure.
+    std::mutex mutex;
+    std::condition_variable readyOrDone;
+    size_t remainingSteps = stepCount;
+    size_t runningSteps = 0;
+    uint32_t firstFailedStep = stepCount;
+    int firstFailure = ANEURALNETWORKS_NO_ERROR;
+    const auto runSteps = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            readyOrDone.wait(lock, [&] {
+                return !readySteps.empty() || runningSteps == 0 || remainingSteps == 0;
+            });
+            if (readySteps.empty() || firstFailedStep < stepCount || isCancelled()) {
+                // Nothing can be started anymore. Wake up the other threads so
+                // that they see it too.
+                readyOrDone.notify_all();
+                return;
+            }
+            const auto next = std::min_element(readySteps.begin(), readySteps.end());
+            const uint32_t stepIndex = *next;
+            readySteps.erase(next);
+            ++runningSteps;
+            lock.unlock();
+
+            const auto& executor = executors[stepIndex];
+            const ExecutionStep* step = executor->getExecutionStep();
+            VLOG(EXECUTION) << "computeConcurrently: Step#" << stepIndex << ": execute on "
+                            << step->getDevice()->getName();
+            if (mPipelineTicket) {
+                mCompilation->getPipeline()->waitForStage(*mPipelineTicket, stepIndex);
+            }
+            const TimePoint start = Clock::now();
+            auto [n, stepOutputShapes, _] =
+                    executor->compute(deadline, burstControllers[stepIndex]);
+            if (n == ANEURALNETWORKS_NO_ERROR) {
+                mPlan->recordStepDuration(step, Clock::now() - start);
+            }
+            if (mPipelineTicket) {
+                mCompilation->getPipeline()->finishStage(*mPipelineTicket, stepIndex);
+            }
+
+            lock.lock();
+            StepExecutor::UpdateOutputShapes updateOutputShapes = {};
+            if (!executor->updateOutputShapes(n, stepOutputShapes, &outputShapes,
+                                              &updateOutputShapes)) {
+                n = ANEURALNETWORKS_OP_FAILED;
+            } else if (n == ANEURALNETWORKS_NO_ERROR && updateOutputShapes.zeroSizedInput) {
+                // We'll need to do full model CPU fallback
+                VLOG(EXECUTION) << "updateOutputShapes.zeroSizedInput";
+                n = ANEURALNETWORKS_OP_FAILED;
+            }
+            --runningSteps;
+            --remainingSteps;
+            if (n != ANEURALNETWORKS_NO_ERROR) {
+                if (stepIndex < firstFailedStep) {
+                    firstFailedStep = stepIndex;
+                    firstFailure = n;
+                }
+            } else {
+                for (uint32_t dependent : dependents[stepIndex]) {
+                    if (--pendingDependencies[dependent] == 0) {
+                        readySteps.push_back(dependent);
+                    }
+                }
+            }
+            readyOrDone.notify_all();
+        }
+    };
+    const size_t threadCount = std::min(kMaxConcurrentSteps, stepCount);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(runSteps);
+    }
+    runSteps();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (isCancelled()) {
+        VLOG(EXECUTION) << "CompoundExecutionBuilder::computeConcurrently cancelled";
+        return {ANEURALNETWORKS_OP_FAILED, {}, {}};
+    }
+    const int n = firstFailure;
+    if (n == ANEURALNETWORKS_NO_ERROR) {
+        CHECK_EQ(remainingSteps, 0u);
+        return {n, std::move(outputShapes), {}};
+    }
+
+    // Without dynamic temporaries, ANEURALNETWORKS_OUTPUT_INSUFFICIENT_SIZE
+    // means that a main model output is not of sufficient size, which is not
+    // recoverable.
+    if (n == ANEURALNETWORKS_OUTPUT_INSUFFICIENT_SIZE) {
+        return {n, std::move(outputShapes), {}};
+    }
+
+    // If CPU fallback is not allowed and there was an error, end execution.
+    if (!mAllowCpuFallback) {
+        return {n, {}, {}};
+    }
+
+    // The other steps may have run already, so there is no partial fallback
+    // of the failed step. Do a full execution fallback on the CPU instead.
+    return cpuFallbackFull(this);
+}
+
 static bool waitForSyncFences(const std::vector<int>& waitFor) {
     for (int syncFd : waitFor) {
         if (syncFd > 0) {
@@ -910,7 +1134,15 @@ std::tuple<int, int, ExecuteFencedInfoCallback> CompoundExecutionBuilder::comput
     ExecuteFencedInfoCallback executeFencedInfoCallback;
 
     std::shared_ptr<ExecutionPlan::Controller> controller = mPlan->makeController(this, nullptr);
+    // The last steps may still be running when this function returns.
+    controller->keepTemporaries();
     while (true) {
+        // Don't start the next step of a cancelled computation.
+        if (isCancelled()) {
+            VLOG(EXECUTION) << "CompoundExecutionBuilder::computeFencedInternal cancelled";
+            return {ANEURALNETWORKS_OP_FAILED, -1, nullptr};
+        }
+
         VLOG(EXECUTION) << "looking for next StepExecutor";
 
         // Get the current step of the execution.
@@ -1010,16 +1242,21 @@ int ExecutionBuilder::computeFenced(const std::vector<int>& waitFor,
 }
 
 int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizationCallback,
-                              BurstBuilder* burstBuilder) {
+                              BurstBuilder* burstBuilder, CompletionQueue* completionQueue) {
     CHECK(synchronizationCallback == nullptr || burstBuilder == nullptr)
             << "synchronizationCallback and burstBuilder cannot simultaneously be used";
+    CHECK(synchronizationCallback != nullptr || completionQueue == nullptr)
+            << "completionQueue requires an asynchronous computation";
 
     const bool synchronous = (synchronizationCallback == nullptr);
     if (!synchronous) {
         *synchronizationCallback = nullptr;
     }
 
-    const char* name = burstBuilder ? "burstCompute" : synchronous ? "compute" : "startCompute";
+    const char* name = burstBuilder      ? "burstCompute"
+                       : synchronous     ? "compute"
+                       : completionQueue ? "startComputeWithCompletionQueue"
+                                         : "startCompute";
     NN_RETURN_IF_ERROR(prepareForCompute(name));
 
     // Validate input memory dimensions. We need to do the validation in every computation because
@@ -1041,6 +1278,22 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
     }
 
     const auto deadline = makeDeadline(mTimeoutDuration);
+
+    // Admit the computation to the pipeline of the compilation, if any. This
+    // happens before an asynchronous computation is launched, so that
+    // computations are admitted in the order in which they are started, and
+    // starting a computation blocks while the pipeline is full.
+    ExecutionPipeline* pipeline = mCompilation->getPipeline();
+    if (pipeline != nullptr) {
+        mPipelineTicket = pipeline->enter();
+    }
+    const auto leavePipeline = [this, pipeline] {
+        if (pipeline != nullptr) {
+            pipeline->leave(*mPipelineTicket);
+            mPipelineTicket.reset();
+        }
+    };
+
     if (synchronous) {
         if (burstBuilder) {
             VLOG(EXECUTION) << "ExecutionBuilder::compute (synchronous API, burst)";
@@ -1048,6 +1301,7 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
             VLOG(EXECUTION) << "ExecutionBuilder::compute (synchronous API)";
         }
         const auto [n, outputShapes, timing] = computeInternal(deadline, burstBuilder);
+        leavePipeline();
         if (mMeasureTiming) {
             mTimingWithoutFencedExecutionCallback = timing;
         }
@@ -1067,12 +1321,21 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
         // nullptr is returned.  The executionCallback is
         // abstracted in the NN API as an "event".
         auto executionCallback = std::make_shared<ExecutionCallback>();
-        executionCallback->setOnFinish(
-                [this](ErrorStatus error, const std::vector<OutputShape>& outputShapes) {
-                    return finishComputation(error, outputShapes);
-                });
-        const auto asyncStartCompute = [this, deadline, executionCallback] {
+        executionCallback->setOnFinish([this, completionQueue](
+                                               ErrorStatus error,
+                                               const std::vector<OutputShape>& outputShapes) {
+            const ErrorStatus status = finishComputation(error, outputShapes);
+            if (completionQueue != nullptr) {
+                completionQueue->post(this, convertErrorStatusToResultCode(status));
+            }
+            return status;
+        });
+        if (completionQueue != nullptr) {
+            completionQueue->onStart();
+        }
+        const auto asyncStartCompute = [this, deadline, executionCallback, leavePipeline] {
             const auto [n, outputShapes, timing] = computeInternal(deadline, nullptr);
+            leavePipeline();
             const auto status = convertResultCodeToErrorStatus(n);
             executionCallback->notify(status, outputShapes, timing);
         };
@@ -1082,13 +1345,77 @@ int ExecutionBuilder::compute(std::shared_ptr<ExecutionCallback>* synchronizatio
         } else {
             VLOG(EXECUTION) << "ExecutionBuilder::compute (asynchronous API)";
             std::thread asyncExecution(asyncStartCompute);
-            executionCallback->bindThread(std::move(asyncExecution));
+            if (completionQueue != nullptr) {
+                // Nobody waits on the callback to join the thread, and the
+                // thread doesn't use the execution once it has been posted.
+                asyncExecution.detach();
+            } else {
+                executionCallback->bindThread(std::move(asyncExecution));
+            }
         }
         *synchronizationCallback = executionCallback;
         return ANEURALNETWORKS_NO_ERROR;
     }
 }
 
+int ExecutionBuilder::computeBatch(const std::vector<ExecutionBuilder*>& executions) {
+    if (executions.empty()) {
+        return ANEURALNETWORKS_NO_ERROR;
+    }
+    const CompilationBuilder* compilation = executions.front()->mCompilation;
+
+    // Check the whole batch first, so that a bad batch leaves every execution
+    // untouched instead of failing part way through.
+    std::vector<ExecutionBuilder*> sorted = executions;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        LOG(ERROR) << "ANeuralNetworksExecution_computeBatch passed the same execution twice";
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    for (ExecutionBuilder* execution : executions) {
+        if (execution->mCompilation != compilation) {
+            LOG(ERROR) << "ANeuralNetworksExecution_computeBatch passed executions of different "
+                          "compilations";
+            return ANEURALNETWORKS_BAD_DATA;
+        }
+        if (execution->inFlight() || (!execution->mReusable && execution->completed())) {
+            LOG(ERROR) << "ANeuralNetworksExecution_computeBatch passed an execution that has "
+                          "already started or completed";
+            return ANEURALNETWORKS_BAD_STATE;
+        }
+        if (int n = execution->getValidationResultCode(); n != ANEURALNETWORKS_NO_ERROR) {
+            return n;
+        }
+    }
+
+    // Another batch of the compilation may be running on its burst, in which
+    // case this batch runs without one.
+    BurstBuilder* burst = compilation->getBatchBurst();
+    if (burst != nullptr && !burst->tryLock()) {
+        burst = nullptr;
+    }
+    VLOG(EXECUTION) << "ExecutionBuilder::computeBatch: " << executions.size()
+                    << " executions, " << (burst ? "burst" : "no burst");
+    int result = ANEURALNETWORKS_NO_ERROR;
+    for (ExecutionBuilder* execution : executions) {
+        const int n = execution->compute(nullptr, burst);
+        if (result == ANEURALNETWORKS_NO_ERROR) {
+            result = n;
+        }
+    }
+    if (burst != nullptr) {
+        burst->unlock();
+    }
+    return result;
+}
+
+int ExecutionBuilder::computeWithCompletionQueue(CompletionQueue* completionQueue) {
+    CHECK(completionQueue != nullptr);
+    // Nobody waits on the callback: the execution is posted to the queue instead.
+    std::shared_ptr<ExecutionCallback> callback;
+    return compute(&callback, nullptr, completionQueue);
+}
+
 std::vector<OutputShape> ExecutionBuilder::getInitialOutputShapes() const {
     std::vector<OutputShape> outputShapes(mOutputs.size());
     std::transform(mOutputs.begin(), mOutputs.end(), outputShapes.begin(),
@@ -1327,7 +1654,7 @@ StepExecutor::StepExecutor(ExecutionBuilder* executionBuilder, const ModelBuilde
       mReusable(reusable) {
     CHECK(mDevice != nullptr);
     CHECK_EQ(step == nullptr, dynamicTemporaries == nullptr);
-    CHECK(!(reusable && dynamicTemporaries != nullptr));
+    CHECK(!(reusable && dynamicTemporaries != nullptr && !dynamicTemporaries->empty()));
     VLOG(EXECUTION) << "StepExecutor::StepExecutor with " << mInputs.size() << " inputs and "
                     << mOutputs.size() << " outputs";
 }
@@ -1461,6 +1788,10 @@ std::pair<int, std::shared_ptr<RuntimeExecution>> StepExecutor::getReusableExecu
 
 std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::compute(
         const OptionalTimePoint& deadline, const SharedBurst& burstController) {
+    if (mExecutionBuilder->isCancelled()) {
+        VLOG(EXECUTION) << "StepExecutor::compute cancelled";
+        return {ANEURALNETWORKS_OP_FAILED, {}, {}};
+    }
     if (VLOG_IS_ON(EXECUTION)) {
         logArguments("input", mInputs);
         logArguments("output", mOutputs);
@@ -1474,15 +1805,16 @@ std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::compute(
         if (nCreate != ANEURALNETWORKS_NO_ERROR) {
             return {nCreate, {}, {}};
         }
-        std::tie(n, outputShapes, timing) = execution->compute(burstController, deadline);
+        std::tie(n, outputShapes, timing) = execution->compute(
+                burstController, deadline, mExecutionBuilder->getCancellationFlag());
     } else {
         CHECK(mPreparedModel != nullptr);
         const MeasureTiming measure = measureTiming(mExecutionBuilder);
         const OptionalDuration loopTimeoutDuration =
                 makeTimeoutDuration(mExecutionBuilder->getLoopTimeoutDuration());
-        std::tie(n, outputShapes, timing) =
-                mPreparedModel->execute(mInputs, mOutputs, mMemories.getObjects(), burstController,
-                                        measure, deadline, loopTimeoutDuration);
+        std::tie(n, outputShapes, timing) = mPreparedModel->execute(
+                mInputs, mOutputs, mMemories.getObjects(), burstController, measure, deadline,
+                loopTimeoutDuration, mExecutionBuilder->getCancellationFlag());
     }
     mExecutionBuilder->reportTimingWithoutFencedExecutionCallback(timing);
     return {n, std::move(outputShapes), std::move(timing)};
@@ -1530,16 +1862,19 @@ std::tuple<int, int, ExecuteFencedInfoCallback> StepExecutor::computeFenced(
 // For cpuFallback{Partial,Full}, recompile the model on CPU and then start compute.
 std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::computeOnCpuFallback() {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "StepExecutor::computeOnCpuFallback");
-    VLOG(EXECUTION) << "Re-compile the model on CPU";
-    const ModelFactory makeModel = [this] { return mModel->makeModel(); };
-    // TODO: Propagate user preference and compilation priority to this point instead of using
-    // default values of ANEURALNETWORKS_PREFER_FAST_SINGLE_ANSWER and
-    // ANEURALNETWORKS_PRIORITY_MEDIUM
-    const ExecutionPreference preference =
-            static_cast<ExecutionPreference>(ANEURALNETWORKS_PREFER_FAST_SINGLE_ANSWER);
-    const Priority priority = convertToCanonicalPriority(ANEURALNETWORKS_PRIORITY_DEFAULT);
-    auto [n, preparedModel] = DeviceManager::getCpuDevice()->prepareModel(makeModel, preference,
-                                                                          priority, {}, {}, {});
+    // A cancelled computation doesn't need its results.
+    if (mExecutionBuilder->isCancelled()) {
+        VLOG(EXECUTION) << "StepExecutor::computeOnCpuFallback cancelled";
+        return {ANEURALNETWORKS_OP_FAILED, {}, {}};
+    }
+    // The model is prepared on the CPU by the first execution that falls back,
+    // and reused by later ones.
+    CpuFallbackPreparedModel* cpuFallback =
+            mExecutionStep != nullptr ? mExecutionStep->getCpuFallback()
+                                      : mExecutionBuilder->getCompilation()->getCpuFallback();
+    CHECK(cpuFallback != nullptr);
+    CHECK_EQ(cpuFallback->getModel(), mModel);
+    auto [n, preparedModel] = cpuFallback->get();
     if (n != ANEURALNETWORKS_NO_ERROR) {
         return {n, {}, {}};
     }
@@ -1548,7 +1883,12 @@ std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::computeOnCpuFall
     std::vector<const RuntimeMemory*> memories = mMemories.getObjects();
     std::vector<bool> isUsedAsInput(memories.size(), false);
     std::vector<bool> isUsedAsOutput(memories.size(), false);
-    std::vector<std::unique_ptr<RuntimeMemory>> blobAhwbs;
+    std::vector<std::unique_ptr<MemoryRuntimeAHWB>> blobAhwbs;
+    const auto recycleBlobAhwbs = android::base::make_scope_guard([&blobAhwbs] {
+        for (auto& blobAhwb : blobAhwbs) {
+            MemoryRecycler::get().recycle(std::move(blobAhwb));
+        }
+    });
 
     // Mark the input and output usages.
     for (auto& input : mInputs) {
@@ -1575,7 +1915,7 @@ std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::computeOnCpuFall
         const RuntimeMemory* memory = mMemories[i];
         if (memory->getIBuffer() != nullptr) {
             const uint32_t size = memory->getValidator().getMetadata().logicalSize;
-            auto [nAhwb, blobAhwb] = MemoryRuntimeAHWB::create(size);
+            auto [nAhwb, blobAhwb] = MemoryRecycler::get().allocateAhwb(size);
             if (nAhwb != ANEURALNETWORKS_NO_ERROR) {
                 return {nAhwb, {}, {}};
             }
@@ -1593,8 +1933,9 @@ std::tuple<int, std::vector<OutputShape>, Timing> StepExecutor::computeOnCpuFall
     const MeasureTiming measure = measureTiming(mExecutionBuilder);
     const OptionalDuration loopTimeoutDuration =
             makeTimeoutDuration(mExecutionBuilder->getLoopTimeoutDuration());
-    auto [nExecute, outputShapes, timing] = preparedModel->execute(
-            mInputs, mOutputs, memories, nullptr, measure, {}, loopTimeoutDuration);
+    auto [nExecute, outputShapes, timing] =
+            preparedModel->execute(mInputs, mOutputs, memories, nullptr, measure, {},
+                                   loopTimeoutDuration, mExecutionBuilder->getCancellationFlag());
     mExecutionBuilder->reportTimingWithoutFencedExecutionCallback(timing);
     if (nExecute != ANEURALNETWORKS_NO_ERROR) {
         return {nExecute, std::move(outputShapes), timing};
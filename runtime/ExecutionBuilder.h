@@ -25,13 +25,18 @@
 #include <nnapi/Types.h>
 #include <nnapi/Validation.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include "ExecutionCallback.h"
+#include "ExecutionPipeline.h"
+#include "ExecutionPlan.h"
 #include "Memory.h"
 #include "ModelArgumentInfo.h"
 #include "ModelBuilder.h"
@@ -42,6 +47,7 @@ namespace nn {
 
 class BurstBuilder;
 class CompilationBuilder;
+class CompletionQueue;
 class Device;
 class DynamicTemporaries;
 class ExecutionPlan;
@@ -92,8 +98,29 @@ class ExecutionBuilder {
         return compute(synchronizationCallback);
     }
     int computeSynchronously() { return compute(nullptr); }
+    // Computes asynchronously and posts the execution to "completionQueue"
+    // when it completes, instead of signaling an event.
+    int computeWithCompletionQueue(CompletionQueue* completionQueue);
     int burstCompute(BurstBuilder* burst) { return compute(nullptr, burst); }
 
+    // Computes the executions one after the other on the caller's thread. The
+    // executions must be distinct and belong to the same compilation, and the
+    // batch is checked as a whole before any of them is computed. They run on
+    // a burst owned by the compilation when it is not used by another batch.
+    // Returns the result code of the first execution that fails, if any.
+    static int computeBatch(const std::vector<ExecutionBuilder*>& executions);
+
+    // Asks the computation in flight, if any, to stop early (see
+    // ANeuralNetworksExecution_cancel). May be called from any thread.
+    int cancel();
+
+    // Whether the computation in flight has been cancelled.
+    bool isCancelled() const { return mCancelled.load(std::memory_order_relaxed); }
+
+    // The flag that is set when the computation in flight is cancelled, for
+    // the devices that can stop a computation early.
+    const std::atomic<bool>* getCancellationFlag() const { return &mCancelled; }
+
     // Initialize output dimensional information from ModelArgumentInfo.
     std::vector<OutputShape> getInitialOutputShapes() const;
 
@@ -103,6 +130,8 @@ class ExecutionBuilder {
     // Handshake with lower-level execution support
     bool measureTiming() const { return mMeasureTiming; }
     void reportTimingWithoutFencedExecutionCallback(Timing timing) {
+        // Steps of a partitioned execution may report concurrently.
+        std::lock_guard<std::mutex> lock(mTimingMutex);
         mTimingWithoutFencedExecutionCallback = timing;
     }
 
@@ -145,8 +174,11 @@ class ExecutionBuilder {
     // provided (i.e., is nullptr), then a synchronous execution will occur.
     //
     // Providing both synchronizationCallback and burstBuilder is an error.
+    //
+    // If completionQueue is provided, then the computation must be asynchronous
+    // and the execution is posted to the queue when it completes.
     int compute(std::shared_ptr<ExecutionCallback>* synchronizationCallback,
-                BurstBuilder* burstBuilder = nullptr);
+                BurstBuilder* burstBuilder = nullptr, CompletionQueue* completionQueue = nullptr);
 
     virtual std::tuple<int, std::vector<OutputShape>, Timing> computeInternal(
             const OptionalTimePoint& deadline, BurstBuilder* burstBuilder) = 0;
@@ -175,6 +207,10 @@ class ExecutionBuilder {
     // from CompilationBuilder when the ExecutionBuilder is constructed.
     bool mAllowCpuFallback;
 
+    // The ticket of the running computation if the executions of the
+    // compilation are pipelined (see CompilationBuilder::getPipeline()).
+    std::optional<ExecutionPipeline::Ticket> mPipelineTicket;
+
     // The information we'll send to the driver about the inputs and outputs.
     // Note that we build this in two steps:
     // 1. As the arguments are specified, set the corresponding mInputs or mOutputs element.
@@ -195,6 +231,8 @@ class ExecutionBuilder {
     // Timing reported from the driver.  This field is only used if
     // mFencedExecutionCallback is nullptr.
     Timing mTimingWithoutFencedExecutionCallback = {};
+    // Guards mTimingWithoutFencedExecutionCallback while steps are computing.
+    std::mutex mTimingMutex;
 
     // Amount of time to complete or abort the execution.
     std::optional<uint64_t> mTimeoutDuration;
@@ -221,6 +259,10 @@ class ExecutionBuilder {
     // no thread-safety guarantee to the ANeuralNetworksExecution object.
     mutable std::mutex mStateMutex;
 
+    // Set by cancel() while the execution is in the state State::COMPUTATION,
+    // and cleared when a computation starts.
+    std::atomic<bool> mCancelled{false};
+
     // Return false if the execution is in a bad state for starting computation.
     // Otherwise, return true and set the state to State::COMPUTATION.
     bool checkAndSetComputationState(const char* name);
@@ -293,6 +335,18 @@ class CompoundExecutionBuilder : public ExecutionBuilder {
     std::tuple<int, int, ExecuteFencedInfoCallback> computeFencedInternal(
             const std::vector<int>& waitFor, uint64_t timeoutDurationAfterFence,
             const OptionalTimePoint& deadline) override;
+
+   private:
+    // Runs every step as soon as the steps it depends on are done, on a
+    // bounded number of threads including the calling one, instead of one
+    // step at a time. Only legal to call if
+    // ExecutionPlan::canRunStepsConcurrently().
+    std::tuple<int, std::vector<OutputShape>, Timing> computeConcurrently(
+            const OptionalTimePoint& deadline, BurstBuilder* burstBuilder);
+
+    // The controller kept across the computations of a reusable execution.
+    // See ExecutionPlan::makeReusableController().
+    std::shared_ptr<ExecutionPlan::Controller> mController;
 };
 
 // class StepExecutor is used to execute a single "step" in a
@@ -393,6 +447,9 @@ class StepExecutor {
 
     bool isCpu() const;
 
+    // nullptr if the executor runs the entire model.
+    const ExecutionStep* getExecutionStep() const { return mExecutionStep; }
+
     // Perform fenced execution and return error_code, sync_fence_fd and a
     // callback.
     std::tuple<int, int, ExecuteFencedInfoCallback> computeFenced(
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ExecutionPipeline"
+
+#include "ExecutionPipeline.h"
+
+#include <LegacyUtils.h>
+#include <android-base/logging.h>
+
+namespace android {
+namespace nn {
+
+ExecutionPipeline::ExecutionPipeline(uint32_t depth, uint32_t stageCount)
+    : mDepth(depth), mStages(stageCount) {
+    CHECK_GT(depth, 0u);
+}
+
+ExecutionPipeline::Ticket ExecutionPipeline::enter() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() REQUIRES(mMutex) { return mAdmitted < mDepth; });
+    mAdmitted++;
+    const Ticket ticket = mNextTicket++;
+    VLOG(EXECUTION) << "ExecutionPipeline::enter: ticket " << ticket;
+    return ticket;
+}
+
+void ExecutionPipeline::waitForStage(Ticket ticket, uint32_t stage) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    CHECK_LT(stage, mStages.size());
+    // The stage is done for "ticket" already if it is before "next", for
+    // example when a step is repeated.
+    mCondition.wait(lock, [this, ticket, stage]() REQUIRES(mMutex) {
+        return ticket <= mStages[stage].next;
+    });
+}
+
+void ExecutionPipeline::finishStage(Ticket ticket, uint32_t stage) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        CHECK_LT(stage, mStages.size());
+        finishStageLocked(ticket, &mStages[stage]);
+    }
+    mCondition.notify_all();
+}
+
+void ExecutionPipeline::leave(Ticket ticket) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (Stage& stage : mStages) {
+            finishStageLocked(ticket, &stage);
+        }
+        CHECK_GT(mAdmitted, 0u);
+        mAdmitted--;
+        VLOG(EXECUTION) << "ExecutionPipeline::leave: ticket " << ticket;
+    }
+    mCondition.notify_all();
+}
+
+void ExecutionPipeline::finishStageLocked(Ticket ticket, Stage* stage) {
+    if (ticket < stage->next) {
+        return;
+    }
+    stage->done.insert(ticket);
+    while (!stage->done.empty() && *stage->done.begin() == stage->next) {
+        stage->done.erase(stage->done.begin());
+        stage->next++;
+    }
+}
+
+}  // namespace nn
+}  // namespace android
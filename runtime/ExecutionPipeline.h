@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_EXECUTION_PIPELINE_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_EXECUTION_PIPELINE_H
+
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+// Schedules the executions of a partitioned compilation as a pipeline (see
+// ANeuralNetworksCompilation_setPipelineDepth).
+//
+// Each step of the plan is a stage of the pipeline. Executions are admitted in
+// the order in which they are started, and each stage runs one execution at a
+// time, in admission order. Thus, while execution N runs step 1, execution N+1
+// may run step 0, but it can't overtake execution N at any step. At most
+// "depth" executions are admitted at the same time.
+//
+// The schedule does not affect the results: every execution has its own
+// temporaries (see ExecutionPlan::Controller).
+class ExecutionPipeline {
+    DISALLOW_COPY_AND_ASSIGN(ExecutionPipeline);
+
+   public:
+    using Ticket = uint64_t;
+
+    ExecutionPipeline(uint32_t depth, uint32_t stageCount);
+
+    // Admits an execution to the pipeline, blocking while "depth" executions
+    // are admitted. Every call must be matched with a call to leave().
+    Ticket enter();
+
+    // Blocks until every execution admitted before "ticket" is done with
+    // "stage".
+    void waitForStage(Ticket ticket, uint32_t stage);
+
+    // The execution admitted with "ticket" is done with "stage", and the next
+    // execution may run it.
+    void finishStage(Ticket ticket, uint32_t stage);
+
+    // The execution admitted with "ticket" is done. The stages it has not
+    // finished, for example because it failed, are skipped.
+    void leave(Ticket ticket);
+
+   private:
+    struct Stage {
+        // The ticket of the next execution to run the stage.
+        Ticket next = 0;
+        // Executions after "next" that are already done with the stage.
+        std::set<Ticket> done;
+    };
+
+    // Marks "stage" done for "ticket" unless it is done already.
+    void finishStageLocked(Ticket ticket, Stage* stage) REQUIRES(mMutex);
+
+    const uint32_t mDepth;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    Ticket mNextTicket GUARDED_BY(mMutex) = 0;
+    uint32_t mAdmitted GUARDED_BY(mMutex) = 0;
+    std::vector<Stage> mStages GUARDED_BY(mMutex);
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_EXECUTION_PIPELINE_H
@@ -32,13 +32,17 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <queue>
 #include <set>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_set>
 #include <utility>
@@ -49,7 +53,10 @@
 #include "ExecutionBuilder.h"
 #include "ExecutionCallback.h"
 #include "Manager.h"
+#include "MemoryRecycler.h"
 #include "ModelBuilder.h"
+#include "PartitioningPlanCache.h"
+#include "PartitioningProfile.h"
 #include "TypeManager.h"
 
 namespace android {
@@ -137,7 +144,6 @@ class OperandTracker {
 
    private:
     const ModelBuilder* mModel;
-    std::multimap<uint32_t, uint32_t> mOperandToOperations;
     std::vector<uint32_t> mUnknownInputCount;  // For each operation
 };
 
@@ -153,7 +159,6 @@ OperandTracker::OperandTracker(const ModelBuilder* model, OperationReadyCallback
             if (lifetime == Operand::LifeTime::TEMPORARY_VARIABLE ||
                 lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT) {
                 count++;
-                mOperandToOperations.emplace(operandIndex, operationIndex);
             }
         }
         if (count == 0) {
@@ -167,11 +172,10 @@ void OperandTracker::markProcessed(uint32_t operationIndex, OperationReadyCallba
     // Mark all its outputs as known.
     const Operation& operation = mModel->getOperations()[operationIndex];
     for (uint32_t operandIndex : operation.outputs) {
-        auto range = mOperandToOperations.equal_range(operandIndex);
-        for (auto i = range.first; i != range.second; i++) {
-            uint32_t& count = mUnknownInputCount[i->second];
+        for (uint32_t consumer : mModel->getOperandConsumers(operandIndex)) {
+            uint32_t& count = mUnknownInputCount[consumer];
             if (--count == 0) {
-                cb(i->second);
+                cb(consumer);
             }
         }
     }
@@ -187,6 +191,53 @@ StaticTemporaryLocation addTemporary(uint32_t* totalSizeOfTemporaries, uint32_t
     return {.offset = offset, .paddedLength = size};
 };
 
+// A static temporary to be placed by packTemporaries().
+struct TemporaryToPack {
+    uint32_t paddedLength;
+    uint32_t alignment;
+};
+
+// Places "temporaries" in one region of memory, where temporaries i and j may
+// share memory unless "mayOverlapInTime(i, j)". Temporaries are placed largest
+// first, each at the lowest suitably aligned offset that does not collide with
+// an already placed temporary it may overlap in time with. Returns the offsets
+// of the temporaries and sets *totalSize to the size of the region.
+std::vector<uint32_t> packTemporaries(
+        const std::vector<TemporaryToPack>& temporaries,
+        const std::function<bool(uint32_t, uint32_t)>& mayOverlapInTime, uint32_t* totalSize) {
+    std::vector<uint32_t> order(temporaries.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&temporaries](uint32_t i, uint32_t j) {
+        return temporaries[i].paddedLength > temporaries[j].paddedLength;
+    });
+
+    std::vector<uint32_t> offsets(temporaries.size());
+    std::vector<uint32_t> placed;
+    *totalSize = 0;
+    for (uint32_t i : order) {
+        // The ranges of memory that temporary i must not use, by start offset.
+        std::vector<std::pair<uint32_t, uint32_t>> taken;
+        for (uint32_t j : placed) {
+            if (mayOverlapInTime(i, j)) {
+                taken.emplace_back(offsets[j], offsets[j] + temporaries[j].paddedLength);
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+        const TemporaryToPack& temporary = temporaries[i];
+        uint32_t offset = 0;
+        for (const auto& [start, end] : taken) {
+            if (offset + temporary.paddedLength <= start) {
+                break;
+            }
+            offset = std::max(offset, roundUp(end, temporary.alignment));
+        }
+        offsets[i] = offset;
+        *totalSize = std::max(*totalSize, offset + temporary.paddedLength);
+        placed.push_back(i);
+    }
+    return offsets;
+}
+
 std::string toString(SourceOperandIndex sourceOperandIndex) {
     return "(" + std::to_string(sourceOperandIndex.first) + ", " +
            std::to_string(sourceOperandIndex.second) + ")";
@@ -265,6 +316,89 @@ class StepRoleAnalyzer {
 
 }  // namespace
 
+std::pair<int, std::shared_ptr<RuntimePreparedModel>> CpuFallbackPreparedModel::get() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mPreparedModel != nullptr) {
+        return {ANEURALNETWORKS_NO_ERROR, mPreparedModel};
+    }
+    VLOG(EXECUTION) << "Compile the model on CPU for fallback";
+    const ModelFactory makeModel = [this] { return mModel->makeModel(); };
+    const ExecutionPreference preference = static_cast<ExecutionPreference>(mExecutionPreference);
+    const Priority priority = convertToCanonicalPriority(mPriority);
+    auto [n, preparedModel] = DeviceManager::getCpuDevice()->prepareModel(makeModel, preference,
+                                                                          priority, {}, {}, {});
+    if (n == ANEURALNETWORKS_NO_ERROR) {
+        mPreparedModel = preparedModel;
+    }
+    return {n, std::move(preparedModel)};
+}
+
+uint32_t DynamicTemporariesPool::getPaddedLength(SourceOperandIndex sourceOperandIndex) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const auto it = mPaddedLengths.find(sourceOperandIndex);
+    return it != mPaddedLengths.end() ? it->second : 0;
+}
+
+void DynamicTemporariesPool::recordPaddedLength(SourceOperandIndex sourceOperandIndex,
+                                                uint32_t paddedLength) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint32_t& recorded = mPaddedLengths[sourceOperandIndex];
+    recorded = std::max(recorded, paddedLength);
+}
+
+std::unique_ptr<MemoryAshmem> DynamicTemporariesPool::take(uint32_t stepIndex, uint32_t size) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& memories = mStepIndexToMemories[stepIndex];
+    auto best = memories.end();
+    for (auto it = memories.begin(); it != memories.end(); ++it) {
+        if ((*it)->getSize() >= size &&
+            (best == memories.end() || (*it)->getSize() < (*best)->getSize())) {
+            best = it;
+        }
+    }
+    if (best == memories.end()) {
+        return nullptr;
+    }
+    std::unique_ptr<MemoryAshmem> memory = std::move(*best);
+    memories.erase(best);
+    mStats.reuses++;
+    return memory;
+}
+
+void DynamicTemporariesPool::give(uint32_t stepIndex, std::unique_ptr<MemoryAshmem> memory) {
+    CHECK(memory != nullptr);
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& memories = mStepIndexToMemories[stepIndex];
+    if (memories.size() < kMaxPooledMemoriesPerStep) {
+        memories.push_back(std::move(memory));
+    } else {
+        MemoryRecycler::get().recycle(std::move(memory));
+    }
+}
+
+void DynamicTemporariesPool::recordAllocation() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.allocations++;
+}
+
+DynamicTemporariesPool::Stats DynamicTemporariesPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+DynamicTemporaries::~DynamicTemporaries() {
+    for (auto& [stepIndex, memory] : mStepIndexToMemory) {
+        if (memory == nullptr) {
+            continue;
+        }
+        if (mPool != nullptr) {
+            mPool->give(stepIndex, std::move(memory));
+        } else {
+            MemoryRecycler::get().recycle(std::move(memory));
+        }
+    }
+}
+
 void DynamicTemporaries::vlogDump(const char* context) const {
     if (empty()) {
         return;
@@ -293,7 +427,11 @@ void DynamicTemporaries::declare(SourceOperandIndex sourceOperandIndex, uint32_t
                     << ", padding = " << padding << ")";
     CHECK(!mDeclared);
     CHECK_GT(initialLength, 0u);
-    const uint32_t paddedLength = roundUp(initialLength, padding);
+    uint32_t paddedLength = roundUp(initialLength, padding);
+    if (mPool != nullptr) {
+        // Earlier executions tell us how large the temporary may get.
+        paddedLength = std::max(paddedLength, mPool->getPaddedLength(sourceOperandIndex));
+    }
     auto [_, isNew] = mSourceOperandToTemporary.emplace(
             sourceOperandIndex, InternalLocationAndShape{stepIndex, 0, initialDimensions,
                                                          paddedLength, alignment, padding});
@@ -316,6 +454,9 @@ bool DynamicTemporaries::redeclare(SourceOperandIndex sourceOperandIndex,
 
     InternalLocationAndShape& temp = mSourceOperandToTemporary.at(sourceOperandIndex);
     const uint32_t paddedLength = roundUp(newLength, temp.padding);
+    if (mPool != nullptr) {
+        mPool->recordPaddedLength(sourceOperandIndex, paddedLength);
+    }
     if (temp.paddedLength == paddedLength && temp.dimensions == newDimensions) {
         return createAndLogResult(false);
     }
@@ -351,23 +492,37 @@ int DynamicTemporaries::allocate(uint32_t stepIndex) {
     }
 
     // perform (re-)allocation
-    // TODO: Today we may shrink the allocation in order to avoid wasting memory.  Is this important
-    //       to conserve memory, or do we waste time reallocating?
-    const double kWaste = 0.2 /* arbitrary */;  // Willing to waste space to avoid
-                                                // deallocation/reallocation overhead
+    //
+    // An allocation is never shrunk: the temporaries of the step have needed
+    // that much memory before, and with a pool the memory outlives this
+    // execution anyway.
     auto& memory = mStepIndexToMemory[stepIndex];
     const uint32_t oldSize = (memory ? memory->getSize() : 0);
-    if ((oldSize >= newSize) && (oldSize <= newSize * (1 + kWaste))) {
+    if (oldSize >= newSize) {
         // Suitable allocation already exists; nothing to do
+    } else if (auto pooled = mPool ? mPool->take(stepIndex, newSize) : nullptr) {
+        VLOG(EXECUTION) << "DynamicTemporaries::allocate reusing memory of size "
+                        << pooled->getSize() << " for step " << stepIndex;
+        // The old memory no longer holds any temporaries of the step.
+        MemoryRecycler::get().recycle(std::move(memory));
+        memory = std::move(pooled);
     } else {
+        // Grow geometrically so that a temporary that keeps growing needs few
+        // reallocations.
+        const uint32_t allocationSize =
+                std::max(newSize, oldSize > UINT32_MAX / 2 ? UINT32_MAX : oldSize * 2);
+        MemoryRecycler::get().recycle(std::move(memory));
         int n;
-        std::tie(n, memory) = MemoryAshmem::create(newSize);
+        std::tie(n, memory) = MemoryRecycler::get().allocateAshmem(allocationSize);
         if (n != ANEURALNETWORKS_NO_ERROR) {
-            LOG(ERROR) << "Failed to allocate dynamic temporaries of size " << newSize
+            LOG(ERROR) << "Failed to allocate dynamic temporaries of size " << allocationSize
                        << " for step " << stepIndex;
             mAllocatedStepIndexes.erase(stepIndex);
             return n;
         }
+        if (mPool != nullptr) {
+            mPool->recordAllocation();
+        }
     }
 
     mAllocatedStepIndexes.insert(stepIndex);
@@ -514,6 +669,7 @@ int ExecutionStep::addOperand(uint32_t sourceOperandIndex, uint32_t* stepOperand
 
 int ExecutionStep::addOperation(int operationIndex) {
     const Operation& operation = getSourceModel()->getOperation(operationIndex);
+    mSourceOperationIndexes.push_back(operationIndex);
     if (mToken.ok()) {
         mToken.update(&mSourceModelIndex, sizeof(mSourceModelIndex));
         mToken.update(&operationIndex, sizeof(operationIndex));
@@ -741,8 +897,7 @@ static bool hasUnknownSize(const Operand& operand) {
     return false;
 }
 
-int ExecutionStep::finishStepModel(const ModelBuilder* mainModel, bool* hasOutputOfUnknownSize,
-                                   int32_t executionPreference, int32_t priority) {
+int ExecutionStep::finishStepModel(const ModelBuilder* mainModel, bool* hasOutputOfUnknownSize) {
     CHECK(mDevice != nullptr);
 
     for (const auto& stepModelOutput : mTempsAsStepModelOutputs) {
@@ -819,10 +974,15 @@ int ExecutionStep::finishStepModel(const ModelBuilder* mainModel, bool* hasOutpu
                    [](auto& e) { return e.second; });
     NN_RETURN_IF_ERROR(mStepModel.identifyInputsAndOutputs(inputs.size(), inputs.data(),
                                                            outputs.size(), outputs.data()));
-    NN_RETURN_IF_ERROR(mStepModel.finish());
+    return mStepModel.finish();
+}
 
-    // TODO: Move compilation elsewhere?
-    VLOG(COMPILATION) << "ExecutionStep::finishStepModel, compilation on " << mDevice->getName();
+int ExecutionStep::compileStepModel(int32_t executionPreference, int32_t priority) {
+    NNTRACE_RT(NNTRACE_PHASE_COMPILATION, "ExecutionStep::compileStepModel");
+    VLOG(COMPILATION) << "ExecutionStep::compileStepModel, step " << mIndex << " on "
+                      << mDevice->getName();
+    mCpuFallback =
+            std::make_unique<CpuFallbackPreparedModel>(&mStepModel, executionPreference, priority);
     return compile(*mDevice, mStepModel, executionPreference, priority, {}, *mPlan->getCacheInfo(),
                    &mToken, &mPreparedStepModel);
 }
@@ -862,6 +1022,187 @@ void LogicalStep::dump() const {
     }
 }
 
+void ExecutionPlan::CompoundBody::findStepDependencies(const SourceModels* sourceModels) {
+    mStepDependencies.assign(mSteps.size(), {});
+    // Without control flow and without step inputs whose shapes are only known
+    // during the execution, every execution runs the same steps, each of which
+    // can be set up in advance.
+    bool hasStaticSchedule = true;
+    bool isChain = true;
+    for (uint32_t stepIndex = 0; stepIndex < mSteps.size(); ++stepIndex) {
+        const ExecutionStep* step = mSteps[stepIndex]->tryExecutionStep();
+        if (step == nullptr) {
+            hasStaticSchedule = false;
+            continue;
+        }
+        std::set<uint32_t> dependencies;
+        for (const auto& input : step->getTempsAsStepModelInputs()) {
+            SourceOperandIndex sourceOperandIndex(step->getSourceModelIndex(), input.first);
+            const auto it = mTemporaryToDefiningExecutionStep.find(sourceOperandIndex);
+            CHECK(it != mTemporaryToDefiningExecutionStep.end());
+            dependencies.insert(it->second);
+        }
+        for (const auto& input : step->getOutputsAsStepModelInputs()) {
+            SourceOperandIndex sourceOperandIndex(step->getSourceModelIndex(), input.first);
+            const auto it = mOutputToDefiningExecutionStep.find(sourceOperandIndex);
+            CHECK(it != mOutputToDefiningExecutionStep.end());
+            dependencies.insert(it->second);
+            // The shape of such an output is only known once its defining step
+            // has run, see ExecutionPlan::next().
+            const Operand& operand = sourceModels->getModel(sourceOperandIndex.first)
+                                             ->getOperand(sourceOperandIndex.second);
+            if (hasUnknownSize(operand)) {
+                hasStaticSchedule = false;
+            }
+        }
+        if (stepIndex > 0 && dependencies.count(stepIndex - 1) == 0) {
+            isChain = false;
+        }
+        mStepDependencies[stepIndex].assign(dependencies.begin(), dependencies.end());
+    }
+    mCanPipelineSteps = hasStaticSchedule && !mHasDynamicTemporaries;
+    mCanRunStepsConcurrently = mCanPipelineSteps && !isChain;
+    VLOG(COMPILATION) << "ExecutionPlan::CompoundBody::findStepDependencies: "
+                      << (mCanRunStepsConcurrently ? "can" : "cannot")
+                      << " run steps concurrently";
+}
+
+void ExecutionPlan::CompoundBody::planStaticTemporaries(const SourceModels* sourceModels) {
+    // With control flow, steps may run repeatedly and out of plan order, so
+    // ExecutionPlan::makeController() gives every temporary its own memory.
+    if (!std::all_of(mSteps.begin(), mSteps.end(),
+                     [](const auto& logicalStep) { return logicalStep->isExecution(); })) {
+        return;
+    }
+
+    // dependsOn[i][j] says whether step i transitively depends on step j. A
+    // step only depends on earlier steps.
+    const size_t stepCount = mSteps.size();
+    std::vector<std::vector<bool>> dependsOn(stepCount, std::vector<bool>(stepCount, false));
+    for (uint32_t stepIndex = 0; stepIndex < stepCount; ++stepIndex) {
+        for (uint32_t dependency : mStepDependencies[stepIndex]) {
+            CHECK_LT(dependency, stepIndex);
+            dependsOn[stepIndex][dependency] = true;
+            for (uint32_t i = 0; i < dependency; ++i) {
+                if (dependsOn[dependency][i]) {
+                    dependsOn[stepIndex][i] = true;
+                }
+            }
+        }
+    }
+
+    std::map<SourceOperandIndex, std::vector<uint32_t>> readingSteps;
+    for (const auto& logicalStep : mSteps) {
+        const ExecutionStep* step = logicalStep->executionStep();
+        for (const auto& input : step->getTempsAsStepModelInputs()) {
+            readingSteps[SourceOperandIndex(step->getSourceModelIndex(), input.first)].push_back(
+                    step->getIndex());
+        }
+    }
+
+    // The temporaries that ExecutionPlan::makeController() would allocate for
+    // the ExecutionSteps; see there.
+    std::vector<SourceOperandIndex> sourceOperandIndexes;
+    std::vector<TemporaryToPack> temporaries;
+    for (const auto& logicalStep : mSteps) {
+        const ExecutionStep* step = logicalStep->executionStep();
+        for (const auto& output : step->getTempsAsStepModelOutputs()) {
+            const SourceOperandIndex sourceOperandIndex(step->getSourceModelIndex(), output.first);
+            const Operand& operand = sourceModels->getModel(sourceOperandIndex.first)
+                                             ->getOperand(sourceOperandIndex.second);
+            const uint32_t size = TypeManager::get()->getSizeOfData(operand);
+            if (operand.lifetime != Operand::LifeTime::TEMPORARY_VARIABLE || size == 0) {
+                continue;
+            }
+            const auto memoryPreference = getMemoryPreferenceOfSourceOperand(sourceOperandIndex);
+            sourceOperandIndexes.push_back(sourceOperandIndex);
+            temporaries.push_back({.paddedLength = roundUp(size, memoryPreference.padding),
+                                   .alignment = memoryPreference.alignment});
+        }
+    }
+
+    // Temporary i is dead before temporary j is written if the step defining
+    // j depends on every step reading i. This holds whether the steps run one
+    // at a time or concurrently (see ExecutionPlan::canRunStepsConcurrently()).
+    auto isDeadBeforeWritingOf = [this, &dependsOn, &readingSteps, &sourceOperandIndexes](
+                                         uint32_t i, uint32_t j) {
+        const auto it = readingSteps.find(sourceOperandIndexes[i]);
+        if (it == readingSteps.end()) {
+            return false;
+        }
+        const uint32_t definingStep = mTemporaryToDefiningExecutionStep.at(sourceOperandIndexes[j]);
+        return std::all_of(it->second.begin(), it->second.end(),
+                           [&dependsOn, definingStep](uint32_t readingStep) {
+                               return dependsOn[definingStep][readingStep];
+                           });
+    };
+    const std::vector<uint32_t> offsets = packTemporaries(
+            temporaries,
+            [&isDeadBeforeWritingOf](uint32_t i, uint32_t j) {
+                return !isDeadBeforeWritingOf(i, j) && !isDeadBeforeWritingOf(j, i);
+            },
+            &mSizeOfPlannedTemporaries);
+    for (size_t i = 0; i < temporaries.size(); ++i) {
+        mPlannedTemporaryLocations[sourceOperandIndexes[i]] = {
+                .offset = offsets[i], .paddedLength = temporaries[i].paddedLength};
+    }
+    mHasPlannedTemporaries = true;
+    VLOG(COMPILATION) << "ExecutionPlan::CompoundBody::planStaticTemporaries: "
+                      << temporaries.size() << " temporaries in " << mSizeOfPlannedTemporaries
+                      << " bytes";
+}
+
+int ExecutionPlan::CompoundBody::compileStepModels(int32_t executionPreference,
+                                                   int32_t priority) {
+    std::vector<ExecutionStep*> steps;
+    for (const auto& logicalStep : mSteps) {
+        if (ExecutionStep* step = logicalStep->tryExecutionStep()) {
+            steps.push_back(step);
+        }
+    }
+    const size_t threadCount = std::min<size_t>(
+            DeviceManager::get()->getMaxConcurrentStepCompilations(), steps.size());
+    VLOG(COMPILATION) << "ExecutionPlan::CompoundBody::compileStepModels: " << steps.size()
+                      << " steps on up to " << threadCount << " threads";
+
+    // The steps are handed out in plan order, and no step is handed out after
+    // a compilation has failed. Thus the steps before a failed step are always
+    // compiled, and the error of the first failed step does not depend on the
+    // timing of the threads.
+    std::vector<int> results(steps.size(), ANEURALNETWORKS_NO_ERROR);
+    std::atomic<size_t> nextStep = 0;
+    std::atomic<bool> failed = false;
+    const auto compileSteps = [&] {
+        while (!failed) {
+            const size_t i = nextStep++;
+            if (i >= steps.size()) {
+                break;
+            }
+            results[i] = steps[i]->compileStepModel(executionPreference, priority);
+            if (results[i] != ANEURALNETWORKS_NO_ERROR) {
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(compileSteps);
+    }
+    compileSteps();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (results[i] != ANEURALNETWORKS_NO_ERROR) {
+            VLOG(COMPILATION) << "ExecutionPlan::CompoundBody::compileStepModels -- step#"
+                              << steps[i]->getIndex() << " failed to compile";
+            return results[i];
+        }
+    }
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int ExecutionPlan::CompoundBody::finish(const SourceModels* sourceModels,
                                         int32_t executionPreference, int32_t priority,
                                         const OptionalTimePoint& deadline,
@@ -885,8 +1226,7 @@ int ExecutionPlan::CompoundBody::finish(const SourceModels* sourceModels,
     for (const auto& logicalStep : mSteps) {
         if (ExecutionStep* step = logicalStep->tryExecutionStep()) {
             bool stepHasDynamicTemporaries = false;
-            int n = step->finishStepModel(mainModel, &stepHasDynamicTemporaries,
-                                          executionPreference, priority);
+            int n = step->finishStepModel(mainModel, &stepHasDynamicTemporaries);
             if (stepHasDynamicTemporaries) {
                 mHasDynamicTemporaries = true;
                 if (step->getDevice()->getFeatureLevel() < kHalVersionV1_2ToApi.featureLevel) {
@@ -931,6 +1271,15 @@ int ExecutionPlan::CompoundBody::finish(const SourceModels* sourceModels,
         }
     }
 
+    if (mHasDynamicTemporaries) {
+        mDynamicTemporariesPool = std::make_shared<DynamicTemporariesPool>();
+    }
+
+    if (int n = compileStepModels(executionPreference, priority); n != ANEURALNETWORKS_NO_ERROR) {
+        VLOG(COMPILATION) << "ExecutionPlan::CompoundBody::finish -- compileStepModels failed";
+        return n;
+    }
+
     if (simulateFailureResultCode != ANEURALNETWORKS_NO_ERROR) {
         VLOG(COMPILATION) << "ExecutionPlan::CompoundeBody::finish: simulating failure, ResultCode "
                           << simulateFailureResultCode;
@@ -948,7 +1297,9 @@ int ExecutionPlan::CompoundBody::finish(const SourceModels* sourceModels,
 
     findControlFlowBoundaryConstants(sourceModels);
     findModelOutputsThatAreDownstreamInputs();
+    findStepDependencies(sourceModels);
     findMemoryStepRoles();
+    planStaticTemporaries(sourceModels);
 
     mSuccessfulFinish = true;
     return ANEURALNETWORKS_NO_ERROR;
@@ -1131,7 +1482,7 @@ ExecutionPlan::Controller::Controller(
         return;
     }
     int n;
-    std::tie(n, mTemporaries) = MemoryAshmem::create(totalSizeOfTemporaries);
+    std::tie(n, mTemporaries) = MemoryRecycler::get().allocateAshmem(totalSizeOfTemporaries);
     if (n != ANEURALNETWORKS_NO_ERROR) {
         LOG(ERROR) << "ExecutionPlan::Controller failed to allocate temporaries";
         mNextStepIndex = kBadStepIndex;
@@ -1143,6 +1494,12 @@ ExecutionPlan::Controller::Controller(
     }
 }
 
+ExecutionPlan::Controller::~Controller() {
+    if (mRecycleTemporaries) {
+        MemoryRecycler::get().recycle(std::move(mTemporaries));
+    }
+}
+
 // Attempt to create a burst object for each PreparedModel/Partition. If the
 // burst controller object cannot be made, return a nullptr in its place to
 // indicate the regular execution path should be used. This can occur either
@@ -1204,12 +1561,15 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     // - every partition boundary TEMPORARY operand that is not a dynamic temporary, and
     // - buffers required by the control flow implementation.
     //
-    // TODO: Rethink this approach for managing temporaries.  Some
-    // alternatives:
+    // Without control flow, the layout of the temporaries is planned during
+    // compilation such that temporaries of non-overlapping lifetime occupy
+    // the same storage (see CompoundBody::planStaticTemporaries()).
     //
-    // 1) Adopt a memory layout scheme analogous to stack allocation,
-    // where objects of non-overlapping lifetime can occupy the same
-    // storage.  We would still have a single Memory object in this
+    // TODO: Rethink this approach for managing temporaries with control
+    // flow.  Some alternatives:
+    //
+    // 1) Extend the planned layout to control flow, where steps may run
+    // repeatedly.  We would still have a single Memory object in this
     // case.
     //
     // 2) Do something like what CpuExecutor does, and do allocations
@@ -1221,7 +1581,7 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     // system limits the number of shared memory objects, which are
     // what our Memory objects represent.
     //
-    uint32_t totalSizeOfTemporaries = 0;
+    uint32_t totalSizeOfTemporaries = body->mSizeOfPlannedTemporaries;
     // This function has two modes of operation:
     // 1. When lifetime is TEMPORARY_VARIABLE, we allocate memory for
     //    TEMPORARY_VARIABLE source operands that are not dynamic temporaries,
@@ -1263,10 +1623,14 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
             CHECK_EQ(sourceOperand.lifetime, Operand::LifeTime::TEMPORARY_VARIABLE);
         }
     };
-    std::map<SourceOperandIndex, StaticTemporaryLocation> sourceOperandToLocationOfTemporary;
+    std::map<SourceOperandIndex, StaticTemporaryLocation> sourceOperandToLocationOfTemporary =
+            body->mPlannedTemporaryLocations;
     std::map<SourceOperandIndex, StaticTemporaryLocation> sourceOperandToLocationOfTemporary2;
     for (const auto& logicalStep : body->mSteps) {
-        if (const ExecutionStep* step = logicalStep->tryExecutionStep()) {
+        if (body->mHasPlannedTemporaries) {
+            // The ExecutionStep temporaries are in body->mPlannedTemporaryLocations.
+            CHECK(logicalStep->isExecution());
+        } else if (const ExecutionStep* step = logicalStep->tryExecutionStep()) {
             // Allocate memory for ExecutionStep temporary outputs that are
             // inputs to other steps, as determined by
             // ExecutionPlan::CompoundBody::findTempsAsStepModelOutputs().
@@ -1353,7 +1717,7 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
     }
     // Collect dynamic temporaries.
     // TODO(b/157236079): Move some or all of this work to compilation time?
-    DynamicTemporaries dynamicTemporaries;
+    DynamicTemporaries dynamicTemporaries(body->mDynamicTemporariesPool);
     const TypeManager* typeManager = TypeManager::get();
     forEachDynamicTemporary([body, typeManager, &dynamicTemporaries](
                                     SourceOperandIndex sourceOperandIndex,
@@ -1377,6 +1741,28 @@ std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeController(
             body->mSourceOperandToBoundaryConstantReference, std::move(dynamicTemporaries)));
 }
 
+std::shared_ptr<ExecutionPlan::Controller> ExecutionPlan::makeReusableController(
+        ExecutionBuilder* executionBuilder, const BurstBuilder* burstBuilder,
+        std::shared_ptr<Controller>* cache) const {
+    CHECK(cache != nullptr);
+    if (*cache != nullptr) {
+        Controller* controller = cache->get();
+        CHECK_EQ(controller->mExecutionBuilder, executionBuilder);
+        controller->mBurstBuilder = burstBuilder;
+        controller->mNextStepIndex = 0;
+        controller->mFallbackNextStepIndex = Controller::kBadStepIndex;
+        return *cache;
+    }
+    auto controller = makeController(executionBuilder, burstBuilder);
+    // Without control flow and dynamic temporaries, the locations of the step
+    // model inputs and outputs are the same in every computation.
+    if (canPipelineSteps() && controller->mNextStepIndex != Controller::kBadStepIndex) {
+        controller->mStepExecutors.resize(compound()->mSteps.size());
+        *cache = controller;
+    }
+    return controller;
+}
+
 // TODO: Find a better way to provide this functionality.
 int ExecutionPlan::fallback(std::shared_ptr<Controller> controller,
                             std::shared_ptr<StepExecutor>* executor, SharedBurst* burstController,
@@ -1555,16 +1941,23 @@ int ExecutionPlan::nextCompound(const ExecutionStep* step, std::shared_ptr<Contr
     NN_RETURN_IF_ERROR(controller->mDynamicTemporaries.allocate(step->getIndex()));
     controller->mDynamicTemporaries.vlogDump("finished allocating for a step");
 
-    *executor = std::make_shared<StepExecutor>(controller->mExecutionBuilder, step->getStepModel(),
-                                               step->getDevice(), step->getPreparedStepModel(),
-                                               /*reusable=*/false, step,
-                                               &controller->mDynamicTemporaries);
-
-    step->mapInputsAndOutputs(
-            *executor, mainModelOutputShapes, controller->mTemporaries.get(),
-            controller->mSourceOperandToLocationOfTemporary, controller->mDynamicTemporaries,
-            controller->mSourceOperandToInputIndex, controller->mSourceOperandToOutputIndex,
-            controller->mSourceOperandToConstantReference);
+    const bool reusable = !controller->mStepExecutors.empty();
+    if (reusable && controller->mStepExecutors[step->getIndex()] != nullptr) {
+        *executor = controller->mStepExecutors[step->getIndex()];
+    } else {
+        *executor = std::make_shared<StepExecutor>(
+                controller->mExecutionBuilder, step->getStepModel(), step->getDevice(),
+                step->getPreparedStepModel(), reusable, step, &controller->mDynamicTemporaries);
+
+        step->mapInputsAndOutputs(
+                *executor, mainModelOutputShapes, controller->mTemporaries.get(),
+                controller->mSourceOperandToLocationOfTemporary, controller->mDynamicTemporaries,
+                controller->mSourceOperandToInputIndex, controller->mSourceOperandToOutputIndex,
+                controller->mSourceOperandToConstantReference);
+        if (reusable) {
+            controller->mStepExecutors[step->getIndex()] = *executor;
+        }
+    }
     if (burstController != nullptr && controller->mBurstBuilder != nullptr) {
         *burstController = controller->mBurstBuilder->getControllerAt(controller->mNextStepIndex);
     }
@@ -1909,6 +2302,23 @@ void ExecutionPlan::reset() {
         mBody = nullptr;
     }
     mState = EMPTY;
+    mSourceModels = SourceModels();
+}
+
+void ExecutionPlan::recordStepDuration(const ExecutionStep* step, Duration duration) const {
+    if (mProfile == nullptr) {
+        return;
+    }
+    if (step == nullptr) {
+        const SimpleBody* body = simple();
+        std::vector<uint32_t> operations(body->mModel->operationCount());
+        std::iota(operations.begin(), operations.end(), 0u);
+        mProfile->record(*body->mDevice, std::move(operations), duration);
+    } else if (step->getSourceModelIndex() == kMainModelInSourceModels) {
+        // Operations of referenced models are not profiled, because the
+        // indexes of the referenced models depend on the partitioning.
+        mProfile->record(*step->getDevice(), step->getSourceOperationIndexes(), duration);
+    }
 }
 
 bool ExecutionPlan::isSimpleCpu() const {
@@ -1948,10 +2358,34 @@ std::set<uint32_t> ExecutionPlan::forTest_flatGetDynamicTemporaries() const {
     return ret;
 }
 
+const std::map<SourceOperandIndex, StaticTemporaryLocation>*
+ExecutionPlan::forTest_compoundGetPlannedTemporaryLocations() const {
+    const CompoundBody* body = compound();
+    return body->mHasPlannedTemporaries ? &body->mPlannedTemporaryLocations : nullptr;
+}
+
+const DynamicTemporariesPool* ExecutionPlan::forTest_compoundGetDynamicTemporariesPool() const {
+    return compound()->mDynamicTemporariesPool.get();
+}
+
 bool ExecutionPlan::hasDynamicTemporaries() const {
     return mBody->hasDynamicTemporaries();
 }
 
+bool ExecutionPlan::canRunStepsConcurrently() const {
+    return mState == COMPOUND && compound()->mCanRunStepsConcurrently;
+}
+
+bool ExecutionPlan::canPipelineSteps() const {
+    return mState == COMPOUND && compound()->mCanPipelineSteps;
+}
+
+const std::vector<uint32_t>& ExecutionPlan::getStepDependencies(uint32_t stepIndex) const {
+    const auto& stepDependencies = compound()->mStepDependencies;
+    CHECK_LT(stepIndex, stepDependencies.size());
+    return stepDependencies[stepIndex];
+}
+
 const uint8_t* ExecutionPlan::forTest_simpleGetCacheToken() const {
     return simple()->mToken.getCacheToken();
 }
@@ -2063,10 +2497,10 @@ void ExecutionPlan::forEachDynamicTemporary(
 int ModelBuilder::partitionTheWork(const std::vector<std::shared_ptr<Device>>& devices,
                                    uint32_t preference, uint32_t priority,
                                    const OptionalTimePoint& deadline, ExecutionPlan* plan,
-                                   int simulateFailureResultCode) const {
+                                   int simulateFailureResultCode, bool useCostModel) const {
     uint32_t sourceModelIndex = plan->getSourceModels().addModel(this);
     NN_RETURN_IF_ERROR(partitionTheWorkInternal(sourceModelIndex, devices, preference, priority,
-                                                deadline, plan));
+                                                deadline, useCostModel, plan));
     int n = plan->finish(preference, priority, deadline, simulateFailureResultCode);
     if (VLOG_IS_ON(COMPILATION)) {
         VLOG(COMPILATION) << "ModelBuilder::partitionTheWork: source model: ";
@@ -2079,7 +2513,7 @@ int ModelBuilder::partitionTheWork(const std::vector<std::shared_ptr<Device>>& d
 int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
                                            const std::vector<std::shared_ptr<Device>>& devices,
                                            uint32_t preference, uint32_t priority,
-                                           const OptionalTimePoint& deadline,
+                                           const OptionalTimePoint& deadline, bool useCostModel,
                                            ExecutionPlan* plan) const {
     // This function uses a heuristic approach to partitioning the graph.
     // It should be good enough for the first release.
@@ -2093,17 +2527,50 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
                       << "deviceCount = " << deviceCount << ", "
                       << "operationCount = " << operationCount;
 
-    // Figure out where each operation will best execute.
-    // The value of the vector is the index in the devices vector.
-    std::vector<int> bestDeviceForOperation(operationCount);
-    NN_RETURN_IF_ERROR(
-            findBestDeviceForEachOperation(preference, devices, &bestDeviceForOperation));
-
     // A special value produced by findBestDeviceForEachOperation meaning that
     // this is a control flow operation scheduled for interpreted execution
     // (see LogicalStep).
     const int kControlFlowInterpreter = deviceCount;
 
+    // A cached assignment is only used if it fits this model, which it does
+    // unless the cache token has been reused for a different model.
+    auto fitsThisModel = [this, kControlFlowInterpreter](const std::vector<int>& assignment) {
+        if (assignment.size() != mOperations.size()) {
+            return false;
+        }
+        for (uint32_t operationIndex = 0; operationIndex < assignment.size(); operationIndex++) {
+            const int deviceIndex = assignment[operationIndex];
+            const OperationType type = getOperation(operationIndex).type;
+            if (deviceIndex < 0 || deviceIndex > kControlFlowInterpreter ||
+                (deviceIndex == kControlFlowInterpreter && type != OperationType::IF &&
+                 type != OperationType::WHILE)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Figure out where each operation will best execute.
+    // The value of the vector is the index in the devices vector.
+    std::vector<int> bestDeviceForOperation(operationCount);
+    PartitioningPlanCache* planCache = plan->getPlanCache();
+    const std::vector<int>* cachedAssignment =
+            planCache != nullptr ? planCache->getAssignment(sourceModelIndex) : nullptr;
+    if (cachedAssignment != nullptr && fitsThisModel(*cachedAssignment)) {
+        VLOG(COMPILATION) << "ModelBuilder::partitionTheWork: using the cached device assignment";
+        bestDeviceForOperation = *cachedAssignment;
+        planCache->noteAssignmentUsed();
+    } else {
+        // The profile only describes the main model (see ExecutionPlan::recordStepDuration()).
+        const PartitioningProfile* profile =
+                sourceModelIndex == kMainModelInSourceModels ? plan->getProfile() : nullptr;
+        NN_RETURN_IF_ERROR(findBestDeviceForEachOperation(preference, devices, useCostModel,
+                                                          profile, &bestDeviceForOperation));
+        if (planCache != nullptr) {
+            planCache->recordAssignment(sourceModelIndex, bestDeviceForOperation);
+        }
+    }
+
     // If one device will run all the operations, we don't need to split the
     // work. This shortcut does not apply when recursively partitioning
     // referenced models because our plan representation is flat.
@@ -2219,11 +2686,13 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
                             sourceModelIndex, operation.inputs[op::kCondBoolOperand]);
                     ifStep->thenStepIndex = plan->getNextStepIndex();
                     NN_RETURN_IF_ERROR(thenModel->partitionTheWorkInternal(
-                            thenModelIndex, devices, preference, priority, deadline, plan));
+                            thenModelIndex, devices, preference, priority, deadline, useCostModel,
+                            plan));
                     GotoStep* afterThenBranch = plan->createNewGotoStep();
                     ifStep->elseStepIndex = plan->getNextStepIndex();
                     NN_RETURN_IF_ERROR(elseModel->partitionTheWorkInternal(
-                            elseModelIndex, devices, preference, priority, deadline, plan));
+                            elseModelIndex, devices, preference, priority, deadline, useCostModel,
+                            plan));
                     afterThenBranch->gotoStepIndex = plan->getNextStepIndex();
 
                     // Outer model operands.
@@ -2277,12 +2746,14 @@ int ModelBuilder::partitionTheWorkInternal(uint32_t sourceModelIndex,
                     WhileStep* whileStep = plan->createNewWhileStep();
                     whileStep->condStepIndex = plan->getNextStepIndex();
                     NN_RETURN_IF_ERROR(condModel->partitionTheWorkInternal(
-                            condModelIndex, devices, preference, priority, deadline, plan));
+                            condModelIndex, devices, preference, priority, deadline, useCostModel,
+                            plan));
                     GotoStep* afterCond = plan->createNewGotoStep();
                     afterCond->gotoStepIndex = whileStep->index;
                     whileStep->bodyStepIndex = plan->getNextStepIndex();
                     NN_RETURN_IF_ERROR(bodyModel->partitionTheWorkInternal(
-                            bodyModelIndex, devices, preference, priority, deadline, plan));
+                            bodyModelIndex, devices, preference, priority, deadline, useCostModel,
+                            plan));
                     GotoStep* afterBody = plan->createNewGotoStep();
                     afterBody->gotoStepIndex = whileStep->index;
                     whileStep->exitStepIndex = plan->getNextStepIndex();
@@ -2391,6 +2862,73 @@ float ModelBuilder::getPerformance(uint32_t preference, const std::shared_ptr<De
     return applyPreference(device->getPerformance(operandType));
 }
 
+std::vector<std::vector<float>> ModelBuilder::getMeasuredPerformance(
+        uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
+        const PartitioningProfile& profile) const {
+    // The profile measures latency, which says little about power usage.
+    if (preference == ANEURALNETWORKS_PREFER_LOW_POWER) {
+        return {};
+    }
+
+    const size_t deviceCount = devices.size();
+    const size_t operationCount = mOperations.size();
+    std::map<std::string, size_t> deviceIndexByKey;
+    for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+        deviceIndexByKey[PartitioningProfile::getDeviceKey(*devices[deviceIndex])] = deviceIndex;
+    }
+
+    // The duration of a step is split among its operations in proportion to
+    // their estimated performance. The measurements are converted to the units
+    // of getPerformance() by the ratio of the total estimated performance of
+    // all the measured steps to their total duration.
+    std::vector<std::vector<double>> durationSum(operationCount,
+                                                 std::vector<double>(deviceCount, 0));
+    std::vector<std::vector<uint32_t>> durationCount(operationCount,
+                                                     std::vector<uint32_t>(deviceCount, 0));
+    double totalEstimate = 0;
+    double totalDuration = 0;
+    profile.forEachStep([&](const std::string& deviceKey, const std::vector<uint32_t>& operations,
+                            Duration meanDuration) {
+        const auto it = deviceIndexByKey.find(deviceKey);
+        if (it == deviceIndexByKey.end() || operations.empty() ||
+            operations.back() >= operationCount) {
+            return;
+        }
+        const size_t deviceIndex = it->second;
+        std::vector<float> estimates(operations.size());
+        for (size_t i = 0; i < operations.size(); i++) {
+            estimates[i] = getPerformance(preference, devices[deviceIndex], operations[i]);
+        }
+        const double stepEstimate = std::accumulate(estimates.begin(), estimates.end(), 0.0);
+        if (!(stepEstimate > 0)) {
+            return;
+        }
+        const double stepDuration = meanDuration.count();
+        totalEstimate += stepEstimate;
+        totalDuration += stepDuration;
+        for (size_t i = 0; i < operations.size(); i++) {
+            durationSum[operations[i]][deviceIndex] += stepDuration * estimates[i] / stepEstimate;
+            durationCount[operations[i]][deviceIndex]++;
+        }
+    });
+    if (!(totalDuration > 0)) {
+        return {};
+    }
+
+    const double scale = totalEstimate / totalDuration;
+    std::vector<std::vector<float>> performance(operationCount,
+                                                std::vector<float>(deviceCount, -1.0f));
+    for (size_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+            if (const uint32_t count = durationCount[operationIndex][deviceIndex]) {
+                performance[operationIndex][deviceIndex] =
+                        scale * durationSum[operationIndex][deviceIndex] / count;
+            }
+        }
+    }
+    return performance;
+}
+
 bool ModelBuilder::isControlFlowOperationWithOperandOfUnknownSize(uint32_t operationIndex) const {
     auto containsUnknownSize = [](const ModelBuilder* model,
                                   const std::vector<uint32_t>& operandIndexes) {
@@ -2460,10 +2998,221 @@ class CanDo {
     std::vector<bool> mSupportsOperationByIndex;
 };
 
+// The costs below are used by the cost model partitioner (see
+// DeviceManager::kPartitioningCostModel). They are in the units of
+// Capabilities::PerformanceInfo, in which 1.0 is roughly the cost of one
+// operation on the reference CPU implementation.
+//
+// The cost of an execution step, i.e. of dispatching it to its device and
+// waiting for the result.
+constexpr float kStepCost = 0.5f;
+// The cost of an operand that is produced by one step and consumed by a step
+// on another device, and the additional cost per byte of moving it.
+constexpr float kBoundaryOperandCost = 0.05f;
+constexpr float kBoundaryOperandCostPerByte = 1.0f / (1 << 20);
+
+constexpr float kInfiniteCost = std::numeric_limits<float>::infinity();
+
+// The number of operations before the current one whose devices the cost model
+// partitioner takes from the assignment being looked at when it charges the
+// operands passed between steps. Following the back pointers further would make
+// long-lived operands, such as skip connections, cost time quadratic in the
+// length of the model.
+constexpr uint32_t kBoundaryLookback = 32;
+
+// Chooses a device for each operation of the model so that the total estimated
+// cost of the operations, of the execution steps, and of the operands passed
+// between steps is minimized.
+//
+// operationCosts[i][d] is the cost of executing operation i on device d, or
+// kInfiniteCost if device d cannot execute operation i.
+//
+// The operations are visited in run order and the devices are chosen by
+// dynamic programming: for each device d, we keep the cheapest assignment of
+// the operations visited so far that executes the last one on d. The
+// assignments are stored as back pointers to the device of the previous
+// operation, and the chosen one is rebuilt at the end. A step boundary is
+// assumed between two consecutive operations on different devices, and an
+// operand is charged the first time a consumer on a device other than the one
+// of its producer is visited. Only the devices of the last kBoundaryLookback
+// operations are taken from the assignment; an earlier producer is assumed to
+// run on its preferred device, and earlier consumers are ignored, so the cost
+// is linear in the number of operations and operands.
+//
+// On input, deviceForOperation holds the device preferred by each operation
+// independently, which breaks ties. On output, it holds the chosen devices.
+void minimizeTotalCost(const ModelBuilder& model,
+                       const std::vector<std::vector<float>>& operationCosts,
+                       std::vector<int>* deviceForOperation) {
+    NNTRACE_RT(NNTRACE_PHASE_COMPILATION, "minimizeTotalCost");
+    const uint32_t operationCount = model.operationCount();
+    if (operationCount == 0) {
+        return;
+    }
+    const size_t deviceCount = operationCosts[0].size();
+
+    // Temporaries only; model inputs and constants cost the same wherever they are consumed.
+    std::vector<int> producerOfOperand(model.operandCount(), -1);
+    std::vector<std::vector<uint32_t>> consumersOfOperand(model.operandCount());
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        const Operation& operation = model.getOperation(operationIndex);
+        for (uint32_t operandIndex : operation.outputs) {
+            if (model.getOperand(operandIndex).lifetime == Operand::LifeTime::TEMPORARY_VARIABLE) {
+                producerOfOperand[operandIndex] = operationIndex;
+            }
+        }
+        for (uint32_t operandIndex : operation.inputs) {
+            consumersOfOperand[operandIndex].push_back(operationIndex);
+        }
+    }
+
+    // An input of an operation that may have to be moved from the device of its producer.
+    struct BoundaryInput {
+        uint32_t operand;
+        uint32_t producer;
+        // The consumers of the operand that are visited before the operation are the first
+        // earlierConsumerCount of consumersOfOperand[operand]. The operand is only moved once to
+        // each device.
+        uint32_t earlierConsumerCount;
+        float cost;
+    };
+    std::vector<std::vector<BoundaryInput>> boundaryInputs(operationCount);
+    // The earliest operation whose device the boundary cost of each operation depends on.
+    std::vector<uint32_t> firstRelevantOperation(operationCount);
+    for (uint32_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+        firstRelevantOperation[operationIndex] = operationIndex;
+        for (uint32_t operandIndex : model.getOperation(operationIndex).inputs) {
+            const int producer = producerOfOperand[operandIndex];
+            if (producer < 0) {
+                continue;
+            }
+            // The consumers are listed in run order.
+            const auto& consumers = consumersOfOperand[operandIndex];
+            BoundaryInput input = {
+                    .operand = operandIndex,
+                    .producer = static_cast<uint32_t>(producer),
+                    .earlierConsumerCount = static_cast<uint32_t>(
+                            std::lower_bound(consumers.begin(), consumers.end(), operationIndex) -
+                            consumers.begin())};
+            const Operand& operand = model.getOperand(operandIndex);
+            input.cost = kBoundaryOperandCost +
+                         kBoundaryOperandCostPerByte * TypeManager::get()->getSizeOfData(operand);
+            firstRelevantOperation[operationIndex] =
+                    std::min(firstRelevantOperation[operationIndex], input.producer);
+            boundaryInputs[operationIndex].push_back(input);
+        }
+    }
+
+    // previousDevice[operationIndex * deviceCount + deviceIndex] is the device of operation
+    // operationIndex - 1 in the cheapest assignment that executes operation operationIndex on
+    // deviceIndex, or -1 if there is none.
+    std::vector<int> previousDevice(operationCount * deviceCount, -1);
+    // The device of each operation in the assignment being looked at, for the operations between
+    // firstOnPath and the previous operation, see below.
+    std::vector<int> deviceOnPath(operationCount, -1);
+    // Whether each device holds the operand being looked at.
+    std::vector<char> holdsOperand(deviceCount);
+    // boundaryCost[previous * deviceCount + deviceIndex] is the cost of the operands that the
+    // current operation receives from other devices if it is executed on deviceIndex after the
+    // cheapest assignment that executes the previous operation on previous.
+    std::vector<float> boundaryCost(deviceCount * deviceCount);
+
+    std::vector<float> pathCost(deviceCount, kInfiniteCost);
+    for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+        if (operationCosts[0][deviceIndex] != kInfiniteCost) {
+            pathCost[deviceIndex] = kStepCost + operationCosts[0][deviceIndex];
+        }
+    }
+    for (uint32_t operationIndex = 1; operationIndex < operationCount; operationIndex++) {
+        const auto& inputs = boundaryInputs[operationIndex];
+        std::fill(boundaryCost.begin(), boundaryCost.end(), 0.0f);
+        // Follow the back pointers only as far as the operands of this operation go, and no
+        // further than kBoundaryLookback operations.
+        const uint32_t firstOnPath = std::max(
+                firstRelevantOperation[operationIndex],
+                operationIndex > kBoundaryLookback ? operationIndex - kBoundaryLookback : 0);
+        for (size_t previous = 0; previous < deviceCount && !inputs.empty(); previous++) {
+            if (pathCost[previous] == kInfiniteCost) {
+                continue;
+            }
+            int device = previous;
+            for (uint32_t i = operationIndex - 1;; i--) {
+                deviceOnPath[i] = device;
+                if (i == firstOnPath) {
+                    break;
+                }
+                device = previousDevice[i * deviceCount + device];
+            }
+            for (const BoundaryInput& input : inputs) {
+                std::fill(holdsOperand.begin(), holdsOperand.end(), false);
+                const int producerDevice = input.producer >= firstOnPath
+                                                   ? deviceOnPath[input.producer]
+                                                   : (*deviceForOperation)[input.producer];
+                holdsOperand[producerDevice] = true;
+                const auto& consumers = consumersOfOperand[input.operand];
+                for (uint32_t i = input.earlierConsumerCount;
+                     i-- > 0 && consumers[i] >= firstOnPath;) {
+                    holdsOperand[deviceOnPath[consumers[i]]] = true;
+                }
+                for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+                    if (!holdsOperand[deviceIndex]) {
+                        boundaryCost[previous * deviceCount + deviceIndex] += input.cost;
+                    }
+                }
+            }
+        }
+
+        std::vector<float> nextPathCost(deviceCount, kInfiniteCost);
+        for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+            const float operationCost = operationCosts[operationIndex][deviceIndex];
+            if (operationCost == kInfiniteCost) {
+                continue;
+            }
+            // Staying on the same device wins ties.
+            int bestPrevious = -1;
+            float bestCost = kInfiniteCost;
+            for (size_t i = 0; i < deviceCount; i++) {
+                const size_t previous = (deviceIndex + i) % deviceCount;
+                if (pathCost[previous] == kInfiniteCost) {
+                    continue;
+                }
+                const float cost = pathCost[previous] + operationCost +
+                                   (previous != deviceIndex ? kStepCost : 0) +
+                                   boundaryCost[previous * deviceCount + deviceIndex];
+                if (cost < bestCost) {
+                    bestPrevious = previous;
+                    bestCost = cost;
+                }
+            }
+            if (bestPrevious >= 0) {
+                nextPathCost[deviceIndex] = bestCost;
+                previousDevice[operationIndex * deviceCount + deviceIndex] = bestPrevious;
+            }
+        }
+        pathCost = std::move(nextPathCost);
+    }
+
+    // The device preferred by the last operation wins ties.
+    size_t best = (*deviceForOperation)[operationCount - 1];
+    for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
+        if (pathCost[deviceIndex] < pathCost[best]) {
+            best = deviceIndex;
+        }
+    }
+    CHECK(pathCost[best] != kInfiniteCost);
+    VLOG(COMPILATION) << "minimizeTotalCost: estimated cost " << pathCost[best];
+    int device = best;
+    for (uint32_t operationIndex = operationCount; operationIndex-- > 0;) {
+        (*deviceForOperation)[operationIndex] = device;
+        device = previousDevice[operationIndex * deviceCount + device];
+    }
+}
+
 }  // anonymous namespace
 
 int ModelBuilder::findBestDeviceForEachOperation(
         uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
+        bool useCostModel, const PartitioningProfile* profile,
         std::vector<int>* bestDeviceForOperation) const {
     const MetaModel metaModel(makeModel(), DeviceManager::get()->strictSlicing());
 
@@ -2475,6 +3224,16 @@ int ModelBuilder::findBestDeviceForEachOperation(
 
     // Figure out the best driver for each operation.
     const size_t operationCount = mOperations.size();
+    const std::vector<std::vector<float>> measuredPerformance =
+            profile != nullptr ? getMeasuredPerformance(preference, devices, *profile)
+                               : std::vector<std::vector<float>>{};
+    // For the cost model: operationCosts[i][d] is the cost of executing
+    // operation i on device d, where d == deviceCount is the control flow
+    // interpreter.
+    std::vector<std::vector<float>> operationCosts;
+    if (useCostModel) {
+        operationCosts.assign(operationCount, std::vector<float>(deviceCount + 1, kInfiniteCost));
+    }
     for (size_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
         const Operation& operation = getOperation(operationIndex);
         // Find which device, including CPU fallback, gives the best performance for this operation.
@@ -2498,7 +3257,14 @@ int ModelBuilder::findBestDeviceForEachOperation(
             for (size_t deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++) {
                 const auto& device = devices[deviceIndex];
                 if (canDo[deviceIndex].check(operationIndex)) {
-                    const float perfVal = getPerformance(preference, device, operationIndex);
+                    float perfVal = getPerformance(preference, device, operationIndex);
+                    if (!measuredPerformance.empty() &&
+                        measuredPerformance[operationIndex][deviceIndex] >= 0) {
+                        perfVal = measuredPerformance[operationIndex][deviceIndex];
+                    }
+                    if (useCostModel) {
+                        operationCosts[operationIndex][deviceIndex] = perfVal;
+                    }
                     const bool isUpdatable = device->isUpdatable();
                     const bool deviceIsPreferred = (device == DeviceManager::getCpuDevice() ||
                                                     (isUpdatable && !bestIsUpdatable));
@@ -2537,6 +3303,31 @@ int ModelBuilder::findBestDeviceForEachOperation(
                               << ":" << operationIndex << ") = " << bestChoice << " ("
                               << devices[bestChoice]->getName() << ")";
         }
+
+        // Control flow operations keep the placement chosen above, which
+        // accounts for the limitations of the HAL and of the interpreter.
+        if (useCostModel && (operation.type == OperationType::IF ||
+                             operation.type == OperationType::WHILE)) {
+            auto& costs = operationCosts[operationIndex];
+            std::fill(costs.begin(), costs.end(), kInfiniteCost);
+            costs[(*bestDeviceForOperation)[operationIndex]] = 0;
+        }
+    }
+
+    if (useCostModel) {
+        minimizeTotalCost(*this, operationCosts, bestDeviceForOperation);
+        if (VLOG_IS_ON(COMPILATION)) {
+            for (size_t operationIndex = 0; operationIndex < operationCount; operationIndex++) {
+                const int deviceIndex = (*bestDeviceForOperation)[operationIndex];
+                VLOG(COMPILATION) << "ModelBuilder::findBestDeviceForEachOperation("
+                                  << getOperation(operationIndex).type << ":" << operationIndex
+                                  << ") with cost model = " << deviceIndex << " ("
+                                  << (size_t(deviceIndex) < deviceCount
+                                              ? devices[deviceIndex]->getName()
+                                              : "NNAPI")
+                                  << ")";
+            }
+        }
     }
     return ANEURALNETWORKS_NO_ERROR;
 }
@@ -22,6 +22,7 @@
 #include <LegacyUtils.h>
 #include <TokenHasher.h>
 #include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
 #include <nnapi/IBurst.h>
 #include <nnapi/Types.h>
 
@@ -30,6 +31,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <string>
@@ -52,6 +54,8 @@ class CompilationBuilder;
 class Device;
 class ExecutionBuilder;
 class ExecutionPlan;
+class PartitioningPlanCache;
+class PartitioningProfile;
 class RuntimeMemory;
 class RuntimePreparedModel;
 class StepExecutor;
@@ -115,6 +119,52 @@ class SourceModels {
     std::vector<const ModelBuilder*> mModels;
 };
 
+// State shared by the DynamicTemporaries of all executions of a compilation:
+// the largest length seen for each dynamic temporary, which is a better
+// initial guess than the length of a single element, and the memories of
+// finished executions, which later executions reuse instead of allocating
+// (and having drivers map) new ones. Thread safe.
+class DynamicTemporariesPool {
+    DISALLOW_COPY_AND_ASSIGN(DynamicTemporariesPool);
+
+   public:
+    struct Stats {
+        // The number of memories allocated for dynamic temporaries.
+        uint64_t allocations = 0;
+        // The number of times a memory of an earlier execution was reused.
+        uint64_t reuses = 0;
+    };
+
+    DynamicTemporariesPool() = default;
+
+    // Returns the largest padded length recorded for the temporary, or 0.
+    uint32_t getPaddedLength(SourceOperandIndex sourceOperandIndex) const;
+    void recordPaddedLength(SourceOperandIndex sourceOperandIndex, uint32_t paddedLength);
+
+    // Removes and returns the smallest pooled memory of at least "size" bytes
+    // that was used for the temporaries of "stepIndex", or nullptr.
+    std::unique_ptr<MemoryAshmem> take(uint32_t stepIndex, uint32_t size);
+
+    // Makes "memory", which is no longer used for the temporaries of
+    // "stepIndex", available to later executions.
+    void give(uint32_t stepIndex, std::unique_ptr<MemoryAshmem> memory);
+
+    void recordAllocation();
+
+    Stats getStats() const;
+
+   private:
+    // Bounds the memory kept for a step when many executions run at the same
+    // time.
+    static constexpr size_t kMaxPooledMemoriesPerStep = 4;
+
+    mutable std::mutex mMutex;
+    std::map<SourceOperandIndex, uint32_t> mPaddedLengths GUARDED_BY(mMutex);
+    std::map<uint32_t, std::vector<std::unique_ptr<MemoryAshmem>>> mStepIndexToMemories
+            GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
+};
+
 // Represents all partition boundary dynamic temporaries for a particular main
 // execution.
 //
@@ -135,8 +185,13 @@ class DynamicTemporaries {
 
    public:
     DynamicTemporaries() = default;
+    // The temporaries start with the lengths recorded in "pool", if not
+    // nullptr, and return their memories to it when destroyed.
+    explicit DynamicTemporaries(std::shared_ptr<DynamicTemporariesPool> pool)
+        : mPool(std::move(pool)) {}
     DynamicTemporaries(DynamicTemporaries&&) = default;
     DynamicTemporaries& operator=(DynamicTemporaries&&) = default;
+    ~DynamicTemporaries();
 
     // Declare a dynamic temporary.  stepIndex is the step that defines the
     // temporary (i.e., in which the temporary appears as an operation output
@@ -212,6 +267,8 @@ class DynamicTemporaries {
 
     std::map<uint32_t, std::unique_ptr<MemoryAshmem>> mStepIndexToMemory;
 
+    std::shared_ptr<DynamicTemporariesPool> mPool;
+
     // For a given defining stepIndex, we consider either all its dynamic
     // temporaries to be allocated (have valid locations) or none of them to be.
     std::set<uint32_t> mAllocatedStepIndexes;
@@ -220,6 +277,31 @@ class DynamicTemporaries {
     bool mDeclared = false;
 };
 
+// A model that is prepared on the CPU device when it is first needed for CPU
+// fallback, and then kept for later fallbacks. Thread safe.
+class CpuFallbackPreparedModel {
+    DISALLOW_COPY_AND_ASSIGN(CpuFallbackPreparedModel);
+
+   public:
+    // "model" must outlive this object.
+    CpuFallbackPreparedModel(const ModelBuilder* model, int32_t executionPreference,
+                             int32_t priority)
+        : mModel(model), mExecutionPreference(executionPreference), mPriority(priority) {}
+
+    const ModelBuilder* getModel() const { return mModel; }
+
+    // Returns the prepared model, preparing it unless an earlier call did.
+    // A failed preparation is retried by the next call.
+    std::pair<int, std::shared_ptr<RuntimePreparedModel>> get();
+
+   private:
+    const ModelBuilder* const mModel;
+    const int32_t mExecutionPreference;
+    const int32_t mPriority;
+    std::mutex mMutex;
+    std::shared_ptr<RuntimePreparedModel> mPreparedModel GUARDED_BY(mMutex);
+};
+
 // The location of a static temporary.
 struct StaticTemporaryLocation {
     // The offset relative to ExecutionPlan::Controller::mTemporaries during execution.
@@ -267,6 +349,10 @@ class ExecutionStep {
 
     uint32_t getIndex() const { return mIndex; }
     uint32_t getSourceModelIndex() const { return mSourceModelIndex; }
+    // The indexes of the operations of this step in its source model.
+    const std::vector<uint32_t>& getSourceOperationIndexes() const {
+        return mSourceOperationIndexes;
+    }
 
     void declareModelOutputIsDownstreamInput(uint32_t mainModelOutputIndex);
     void recordTempAsStepModelOutput(uint32_t stepOperandIndex);
@@ -274,17 +360,27 @@ class ExecutionStep {
     // If this step has a step model output of unknown size, sets
     // *hasOutputOfUnknownSize to true; otherwise, leaves it
     // unchanged.
-    int finishStepModel(const ModelBuilder* mainModel, bool* hasOutputOfUnknownSize,
-                        int32_t executionPreference, int32_t priority);
+    int finishStepModel(const ModelBuilder* mainModel, bool* hasOutputOfUnknownSize);
+
+    // Prepares the step model on the device of this step. Only legal to call
+    // after finishStepModel(). Steps of a plan may be compiled concurrently.
+    int compileStepModel(int32_t executionPreference, int32_t priority);
 
     const ModelBuilder* getStepModel() const { return &mStepModel; }
     std::shared_ptr<Device> getDevice() const { return mDevice; }
 
-    // only available after calling finishStepModel()
+    // only available after calling compileStepModel()
     std::shared_ptr<RuntimePreparedModel> getPreparedStepModel() const {
         return mPreparedStepModel;
     }
 
+    // The step model for CPU fallback, with the preference and priority of
+    // the compilation. Only available after calling compileStepModel().
+    CpuFallbackPreparedModel* getCpuFallback() const {
+        CHECK(mCpuFallback != nullptr);
+        return mCpuFallback.get();
+    }
+
     // Map inputs and outputs from ExecutionBuilder to StepExecutor.
     //
     // This method only reads map entries for which the first element of
@@ -321,8 +417,10 @@ class ExecutionStep {
     uint32_t mIndex;  // index of step within plan
     uint32_t mSourceModelIndex;
     ModelBuilder mStepModel;  // An excerpt of a source model to be run by one device.
+    std::vector<uint32_t> mSourceOperationIndexes;
     std::shared_ptr<Device> mDevice;
     std::shared_ptr<RuntimePreparedModel> mPreparedStepModel;
+    std::unique_ptr<CpuFallbackPreparedModel> mCpuFallback;
 
     // All inputs of this step model:
     //     (source model operand index, step model operand index)
@@ -586,6 +684,16 @@ class ExecutionPlan {
     class Controller {
         friend class ExecutionPlan;
 
+       public:
+        // Recycles the static temporaries (see MemoryRecycler), unless
+        // keepTemporaries() has been called.
+        ~Controller();
+
+        // Keeps the static temporaries from being recycled, because the
+        // drivers may still use them after the controller is destroyed, as
+        // in a fenced execution.
+        void keepTemporaries() { mRecycleTemporaries = false; }
+
        private:
         Controller(const Controller&) = delete;
         Controller& operator=(const Controller&) = delete;
@@ -655,6 +763,7 @@ class ExecutionPlan {
 
         // static temporaries
         std::unique_ptr<MemoryAshmem> mTemporaries;
+        bool mRecycleTemporaries = true;
 
         DynamicTemporaries mDynamicTemporaries;
 
@@ -666,6 +775,10 @@ class ExecutionPlan {
         std::unordered_map<size_t, WhileState> mWhileState;
         // The sync fence fd of the last step.
         int mLastStepSyncFd;
+        // The StepExecutor of each step, indexed by step index, if the
+        // controller is kept for later computations of a reusable execution
+        // (see ExecutionPlan::makeReusableController()). Empty otherwise.
+        std::vector<std::shared_ptr<StepExecutor>> mStepExecutors;
     };
 
     std::vector<SharedBurst> makeBursts() const;
@@ -674,6 +787,19 @@ class ExecutionPlan {
     std::shared_ptr<Controller> makeController(ExecutionBuilder* executionBuilder,
                                                const BurstBuilder* burstBuilder) const;
 
+    // Like makeController(), but for a reusable execution whose main model
+    // outputs are of fully specified shape. If *cache holds the controller of
+    // a previous computation of the execution, it is rewound and returned.
+    // Otherwise a new controller is made and, if the plan allows it (see
+    // canPipelineSteps()), kept in *cache together with the StepExecutors
+    // that next() creates, so that later computations neither allocate the
+    // temporaries nor map the step model inputs and outputs again, and the
+    // StepExecutors reuse their RuntimeExecutions.
+    // Only legal to call when mState == COMPOUND.
+    std::shared_ptr<Controller> makeReusableController(
+            ExecutionBuilder* executionBuilder, const BurstBuilder* burstBuilder,
+            std::shared_ptr<Controller>* cache) const;
+
     // Sets up a new StepExecutor and burstController (if applicable) if there
     // is a step to execute. See ExecutionPlan::Controller.
     // Handles control flow. See LogicalStep.
@@ -716,6 +842,8 @@ class ExecutionPlan {
 
     void dump() const;
 
+    // Discards the plan and its source models, so that the model can be
+    // partitioned again.
     void reset();
 
     bool isValid() const { return mState != EMPTY && mBody != nullptr && mBody->mSuccessfulFinish; }
@@ -730,6 +858,25 @@ class ExecutionPlan {
     const CacheInfo* getCacheInfo() const { return mCacheInfo; }
     const uint8_t* getCacheToken() const { return mToken; }
 
+    // The profile for profile guided partitioning, or nullptr if it is not
+    // enabled.
+    void setProfile(std::shared_ptr<PartitioningProfile> profile) {
+        mProfile = std::move(profile);
+    }
+    const PartitioningProfile* getProfile() const { return mProfile.get(); }
+
+    // The stored device assignment to partition with, or nullptr if it is not
+    // enabled. Partitioning records the assignments it finds in it.
+    void setPlanCache(std::shared_ptr<PartitioningPlanCache> planCache) {
+        mPlanCache = std::move(planCache);
+    }
+    PartitioningPlanCache* getPlanCache() const { return mPlanCache.get(); }
+
+    // Records in the profile, if any, that an execution of "step" took
+    // "duration". If step is nullptr, the execution was the single step of a
+    // SIMPLE plan.
+    void recordStepDuration(const ExecutionStep* step, Duration duration) const;
+
     // The caller is responsible for making sure the index is within range.
     void forEachStepRoleOfInput(uint32_t index, const StepRoleCallback& callback) const {
         CHECK(mBody != nullptr);
@@ -754,6 +901,23 @@ class ExecutionPlan {
 
     bool hasDynamicTemporaries() const;
 
+    // Can the steps of this plan be run concurrently, each one as soon as the
+    // steps it depends on (see getStepDependencies()) are done? This is only
+    // the case for COMPOUND plans made of ExecutionSteps (no control flow)
+    // without dynamic temporaries, whose steps are not simply a chain.
+    bool canRunStepsConcurrently() const;
+
+    // Can the executions of this plan be pipelined, i.e., can the steps of
+    // successive executions overlap (see ExecutionPipeline)? This is the case
+    // for COMPOUND plans made of ExecutionSteps without dynamic temporaries,
+    // whose executions run every step exactly once.
+    bool canPipelineSteps() const;
+
+    // The indexes of the steps that define the partition boundary temporaries
+    // and main model outputs read by the step at "stepIndex", in increasing
+    // order. Only legal to call when mState == COMPOUND.
+    const std::vector<uint32_t>& getStepDependencies(uint32_t stepIndex) const;
+
     // These functions are solely intended for use by unit tests of
     // the partitioning algorithm.
     enum class Kind {
@@ -772,6 +936,11 @@ class ExecutionPlan {
     //     The "flat" in the name signifies that this method requires that the
     //     model not contain any control flow operations.
     std::set<uint32_t> forTest_flatGetDynamicTemporaries() const;
+    //     Returns nullptr if the static temporaries are not planned in advance.
+    const std::map<SourceOperandIndex, StaticTemporaryLocation>*
+    forTest_compoundGetPlannedTemporaryLocations() const;
+    //     Returns nullptr if the plan has no dynamic temporaries.
+    const DynamicTemporariesPool* forTest_compoundGetDynamicTemporariesPool() const;
     const uint8_t* forTest_simpleGetCacheToken() const;
 
    private:
@@ -929,9 +1098,43 @@ class ExecutionPlan {
 
         bool mHasDynamicTemporaries = false;
 
+        // Shared by the executions of the plan if mHasDynamicTemporaries.
+        std::shared_ptr<DynamicTemporariesPool> mDynamicTemporariesPool;
+
+        // Indexed by step index. For each ExecutionStep, the indexes of the
+        // ExecutionSteps whose outputs it reads; empty for other steps.
+        std::vector<std::vector<uint32_t>> mStepDependencies;
+
+        // See ExecutionPlan::canRunStepsConcurrently().
+        bool mCanRunStepsConcurrently = false;
+
+        // See ExecutionPlan::canPipelineSteps().
+        bool mCanPipelineSteps = false;
+
+        // The layout of the static temporaries defined by ExecutionSteps, in
+        // which temporaries that are never live at the same time share memory.
+        // Only used if mHasPlannedTemporaries; see planStaticTemporaries().
+        std::map<SourceOperandIndex, StaticTemporaryLocation> mPlannedTemporaryLocations;
+        uint32_t mSizeOfPlannedTemporaries = 0;
+        bool mHasPlannedTemporaries = false;
+
        private:
         void findTempsAsStepModelOutputs();
 
+        void findStepDependencies(const SourceModels* sourceModels);
+
+        // Lays out the static temporaries of a plan without control flow, in
+        // which every execution runs the steps in an order consistent with
+        // mStepDependencies. Requires findStepDependencies() and
+        // findMemoryStepRoles().
+        void planStaticTemporaries(const SourceModels* sourceModels);
+
+        // Calls ExecutionStep::compileStepModel() for every ExecutionStep,
+        // running up to DeviceManager::getMaxConcurrentStepCompilations()
+        // compilations at the same time. Returns the error of the first step
+        // in plan order that failed to compile, if any.
+        int compileStepModels(int32_t executionPreference, int32_t priority);
+
         void findModelOutputsThatAreDownstreamInputs();
 
         // Constant values that are inputs to IF and WHILE operations and lie on
@@ -988,6 +1191,10 @@ class ExecutionPlan {
     const CacheInfo* mCacheInfo = nullptr;
     const uint8_t* mToken = nullptr;
 
+    std::shared_ptr<PartitioningProfile> mProfile;
+
+    std::shared_ptr<PartitioningPlanCache> mPlanCache;
+
     SourceModels mSourceModels;
 };
 
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LargeValuePoolCache"
+
+#include "LargeValuePoolCache.h"
+
+#include <LegacyUtils.h>
+#include <android-base/logging.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// The smallest huge page size.
+constexpr uint32_t kHugePageSize = 2 * 1024 * 1024;
+
+}  // namespace
+
+LargeValuePoolCache& LargeValuePoolCache::get() {
+    static LargeValuePoolCache cache;
+    return cache;
+}
+
+uint64_t LargeValuePoolCache::hash(const std::vector<Value>& values) {
+    uint64_t result = values.size();
+    const auto combine = [&result](uint64_t value) {
+        result ^= value + 0x9e3779b97f4a7c15 + (result << 6) + (result >> 2);
+    };
+    for (const Value& value : values) {
+        combine(value.offset);
+        combine(std::hash<std::string_view>()(
+                std::string_view(static_cast<const char*>(value.buffer), value.length)));
+    }
+    return result;
+}
+
+bool LargeValuePoolCache::holds(const MemoryAshmem& pool, const std::vector<Value>& values) {
+    const uint8_t* pointer = pool.getPointer();
+    return std::all_of(values.begin(), values.end(), [pointer](const Value& value) {
+        return memcmp(pointer + value.offset, value.buffer, value.length) == 0;
+    });
+}
+
+std::pair<int, std::shared_ptr<MemoryAshmem>> LargeValuePoolCache::getPool(
+        uint32_t size, const std::vector<Value>& values) {
+    const Key key(hash(values), size);
+    std::vector<std::shared_ptr<MemoryAshmem>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto [begin, end] = mPools.equal_range(key);
+        for (auto it = begin; it != end;) {
+            if (std::shared_ptr<MemoryAshmem> pool = it->second.lock()) {
+                candidates.push_back(std::move(pool));
+                ++it;
+            } else {
+                it = mPools.erase(it);
+            }
+        }
+    }
+    // The pools are read-only, so they can be compared without the lock.
+    for (auto& pool : candidates) {
+        if (holds(*pool, values)) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.shares++;
+            mStats.sharedBytes += size;
+            VLOG(MODEL) << "Sharing a large value pool of size " << size << " ("
+                        << mStats.sharedBytes << " bytes shared in total)";
+            return {ANEURALNETWORKS_NO_ERROR, std::move(pool)};
+        }
+    }
+
+    auto [n, pool] = createPool(size, values);
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        return {n, nullptr};
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Forget the pools that have been freed since, so that the cache does not
+    // grow with every model ever finished.
+    for (auto it = mPools.begin(); it != mPools.end();) {
+        it = it->second.expired() ? mPools.erase(it) : std::next(it);
+    }
+    mPools.emplace(key, pool);
+    mStats.allocations++;
+    return {ANEURALNETWORKS_NO_ERROR, std::move(pool)};
+}
+
+std::pair<int, std::shared_ptr<MemoryAshmem>> LargeValuePoolCache::createPool(
+        uint32_t size, const std::vector<Value>& values) {
+    auto [n, memory] = MemoryAshmem::create(size);
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        return {n, nullptr};
+    }
+    // A large pool is read on every execution for as long as its models
+    // live, so back it with huge pages where the kernel allows it. The
+    // advice has to come before the pages are first touched.
+    if (size >= kHugePageSize) {
+        if (const auto poolInfo = memory->getRunTimePoolInfo()) {
+            poolInfo->advise(RunTimePoolInfo::AccessHint::HUGE_PAGES);
+        }
+    }
+    uint8_t* pointer = memory->getPointer();
+    for (const Value& value : values) {
+        memcpy(pointer + value.offset, value.buffer, value.length);
+    }
+    // The pool may be shared with other models from now on.
+    if (mprotect(pointer, size, PROT_READ) != 0) {
+        PLOG(WARNING) << "Failed to make a large value pool read-only";
+    }
+    return {ANEURALNETWORKS_NO_ERROR, std::move(memory)};
+}
+
+LargeValuePoolCache::Stats LargeValuePoolCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats = mStats;
+    stats.pools = mPools.size();
+    return stats;
+}
+
+}  // namespace nn
+}  // namespace android
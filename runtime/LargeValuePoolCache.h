@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_LARGE_VALUE_POOL_CACHE_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_LARGE_VALUE_POOL_CACHE_H
+
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Memory.h"
+
+namespace android {
+namespace nn {
+
+// Shares the pools of large constant values (see
+// ModelBuilder::copyLargeValuesToSharedMemory()) among the models whose
+// values are identical, as when an application builds several variants of
+// one model, so that the values are resident only once. Pools are found by a
+// hash of their contents, and compared byte by byte before being shared. A
+// shared pool is read-only, and is freed with the last model that uses it.
+// Hashing costs a pass over the values on top of the copy, which only pays
+// off in processes that build models with the same values, so models only
+// use the cache if they opt in with ANeuralNetworksModel_shareLargeValues, or
+// if DeviceManager::shareLargeValuePools() is true. Thread safe.
+class LargeValuePoolCache {
+    DISALLOW_COPY_AND_ASSIGN(LargeValuePoolCache);
+
+   public:
+    struct Value {
+        const void* buffer;
+        // The location of the value in the pool.
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct Stats {
+        // The number of pools allocated.
+        uint64_t allocations = 0;
+        // The number of times a pool was shared with another model.
+        uint64_t shares = 0;
+        // The number of bytes that did not have to be allocated because a
+        // pool was shared.
+        uint64_t sharedBytes = 0;
+        // The number of pools the cache keeps track of. Pools that have been
+        // freed are forgotten when the next pool is allocated.
+        uint64_t pools = 0;
+    };
+
+    // The cache shared by all models of the process.
+    static LargeValuePoolCache& get();
+
+    LargeValuePoolCache() = default;
+
+    // Returns a pool of "size" bytes that holds each of "values" at its
+    // offset, and zeros elsewhere: the pool of another model if one with the
+    // same contents is alive, otherwise a new one. On error, returns the
+    // appropriate NNAPI error code and nullptr.
+    std::pair<int, std::shared_ptr<MemoryAshmem>> getPool(uint32_t size,
+                                                          const std::vector<Value>& values);
+
+    // Returns a new read-only pool of "size" bytes that holds each of
+    // "values" at its offset, and zeros elsewhere, without sharing it. On
+    // error, returns the appropriate NNAPI error code and nullptr.
+    static std::pair<int, std::shared_ptr<MemoryAshmem>> createPool(
+            uint32_t size, const std::vector<Value>& values);
+
+    Stats getStats() const;
+
+   private:
+    using Key = std::pair<uint64_t, uint32_t>;
+
+    static uint64_t hash(const std::vector<Value>& values);
+    static bool holds(const MemoryAshmem& pool, const std::vector<Value>& values);
+
+    mutable std::mutex mMutex;
+    // The pools alive, by hash and size of their contents.
+    std::multimap<Key, std::weak_ptr<MemoryAshmem>> mPools GUARDED_BY(mMutex);
+    Stats mStats GUARDED_BY(mMutex);
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_LARGE_VALUE_POOL_CACHE_H
@@ -22,6 +22,7 @@
 #include <LegacyUtils.h>
 #include <MetaModel.h>
 #include <Tracing.h>
+#include <android-base/thread_annotations.h>
 #include <nnapi/IBurst.h>
 #include <nnapi/IDevice.h>
 #include <nnapi/IExecution.h>
@@ -35,6 +36,7 @@
 #include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -152,7 +154,8 @@ class DriverPreparedModel : public RuntimePreparedModel {
             const std::vector<ModelArgumentInfo>& outputs,
             const std::vector<const RuntimeMemory*>& memories, const SharedBurst& burstController,
             MeasureTiming measure, const OptionalTimePoint& deadline,
-            const OptionalDuration& loopTimeoutDuration) const override;
+            const OptionalDuration& loopTimeoutDuration,
+            const std::atomic<bool>* cancelled) const override;
 
     std::tuple<int, int, ExecuteFencedInfoCallback, Timing> executeFenced(
             const std::vector<ModelArgumentInfo>& inputs,
@@ -202,7 +205,8 @@ class DriverExecution : public RuntimeExecution {
     }
 
     std::tuple<int, std::vector<OutputShape>, Timing> compute(
-            const SharedBurst& burstController, const OptionalTimePoint& deadline) const override;
+            const SharedBurst& burstController, const OptionalTimePoint& deadline,
+            const std::atomic<bool>* cancelled) const override;
 
     std::tuple<int, int, ExecuteFencedInfoCallback, Timing> computeFenced(
             const std::vector<int>& waitFor, const OptionalTimePoint& deadline,
@@ -520,7 +524,7 @@ std::tuple<int, std::vector<OutputShape>, Timing> DriverPreparedModel::execute(
         const std::vector<ModelArgumentInfo>& inputs, const std::vector<ModelArgumentInfo>& outputs,
         const std::vector<const RuntimeMemory*>& memories, const SharedBurst& burstController,
         MeasureTiming measure, const OptionalTimePoint& deadline,
-        const OptionalDuration& loopTimeoutDuration) const {
+        const OptionalDuration& loopTimeoutDuration, const std::atomic<bool>* /*cancelled*/) const {
     NNTRACE_RT(NNTRACE_PHASE_INPUTS_AND_OUTPUTS, "DriverPreparedModel::execute");
 
     auto request = createDriverRequest(inputs, outputs, memories);
@@ -661,7 +665,8 @@ std::pair<int, std::shared_ptr<RuntimeExecution>> DriverPreparedModel::createReu
 }
 
 std::tuple<int, std::vector<OutputShape>, Timing> DriverExecution::compute(
-        const SharedBurst& burstController, const OptionalTimePoint& deadline) const {
+        const SharedBurst& burstController, const OptionalTimePoint& deadline,
+        const std::atomic<bool>* /*cancelled*/) const {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "DriverExecution::compute");
 
     // compute using burst if present, otherwise compute from IPreparedModel
@@ -879,6 +884,8 @@ class CpuDevice : public Device {
     const std::vector<Extension> kSupportedExtensions{/* No extensions. */};
 };
 
+class CpuBurst;
+
 // A special abstracted RuntimePreparedModel for the CPU, constructed by CpuDevice.
 class CpuPreparedModel : public RuntimePreparedModel {
    public:
@@ -895,9 +902,10 @@ class CpuPreparedModel : public RuntimePreparedModel {
             const std::vector<ModelArgumentInfo>& outputs,
             const std::vector<const RuntimeMemory*>& memories, const SharedBurst& burstController,
             MeasureTiming measure, const OptionalTimePoint& deadline,
-            const OptionalDuration& loopTimeoutDuration) const override;
+            const OptionalDuration& loopTimeoutDuration,
+            const std::atomic<bool>* cancelled) const override;
 
-    GeneralResult<SharedBurst> configureExecutionBurst() const override { return nullptr; }
+    GeneralResult<SharedBurst> configureExecutionBurst() const override;
 
     std::tuple<int, int, ExecuteFencedInfoCallback, Timing> executeFenced(
             const std::vector<ModelArgumentInfo>& inputs,
@@ -919,10 +927,18 @@ class CpuPreparedModel : public RuntimePreparedModel {
 
     // Prefer to use CpuPreparedModel::create.
     CpuPreparedModel(Model model, std::vector<RunTimePoolInfo> poolInfos)
-        : mModel(std::move(model)), mModelPoolInfos(std::move(poolInfos)) {}
+        : mModel(std::move(model)),
+          mModelPoolInfos(std::move(poolInfos)),
+          mOperationCache(std::make_unique<OperationCache>(
+                  DeviceManager::get()->getCpuHybridWeightsTolerance())) {}
 
     const Model& getModel() const { return mModel; }
     const std::vector<RunTimePoolInfo>& getModelPoolInfos() const { return mModelPoolInfos; }
+    OperationCache* getOperationCache() const { return mOperationCache.get(); }
+
+    // Returns "burst" as a CpuBurst if configureExecutionBurst() of this
+    // prepared model created it, and nullptr otherwise.
+    std::shared_ptr<const CpuBurst> findBurst(const SharedBurst& burst) const;
 
    private:
     // TFLite kernels prefers 64 bytes for padding and alignment.
@@ -931,6 +947,12 @@ class CpuPreparedModel : public RuntimePreparedModel {
 
     const Model mModel;
     const std::vector<RunTimePoolInfo> mModelPoolInfos;
+    const std::unique_ptr<OperationCache> mOperationCache;
+
+    mutable std::mutex mBurstsMutex;
+    // The bursts created by configureExecutionBurst(). The ones that have
+    // been freed are removed when the next one is created.
+    mutable std::vector<std::weak_ptr<const CpuBurst>> mBursts GUARDED_BY(mBurstsMutex);
 };
 
 class CpuExecution : public RuntimeExecution {
@@ -944,7 +966,8 @@ class CpuExecution : public RuntimeExecution {
           kLoopTimeoutDuration(std::move(loopTimeoutDuration)) {}
 
     std::tuple<int, std::vector<OutputShape>, Timing> compute(
-            const SharedBurst& burstController, const OptionalTimePoint& deadline) const override;
+            const SharedBurst& burstController, const OptionalTimePoint& deadline,
+            const std::atomic<bool>* cancelled) const override;
 
     std::tuple<int, int, ExecuteFencedInfoCallback, Timing> computeFenced(
             const std::vector<int>& waitFor, const OptionalTimePoint& deadline,
@@ -957,6 +980,49 @@ class CpuExecution : public RuntimeExecution {
     const OptionalDuration kLoopTimeoutDuration;
 };
 
+// A burst object for the CPU, constructed by CpuPreparedModel.
+//
+// The memories cached in the burst stay mapped until they are freed, so a
+// computation of the burst does not map its memories or look up their mappings
+// in the RuntimeMemory objects again. The computations of a burst run on the
+// calling thread regardless of DeviceManager::syncExecCpu(), as the
+// computations of a driver burst do.
+class CpuBurst : public IBurst, public std::enable_shared_from_this<CpuBurst> {
+   public:
+    // "preparedModel" must outlive the burst.
+    explicit CpuBurst(const CpuPreparedModel& preparedModel) : kPreparedModel(preparedModel) {}
+
+    OptionalCacheHold cacheMemory(const SharedMemory& memory) const override;
+
+    ExecutionResult<std::pair<std::vector<OutputShape>, Timing>> execute(
+            const Request& request, MeasureTiming measure, const OptionalTimePoint& deadline,
+            const OptionalDuration& loopTimeoutDuration) const override;
+
+    GeneralResult<SharedExecution> createReusableExecution(
+            const Request& request, MeasureTiming measure,
+            const OptionalDuration& loopTimeoutDuration) const override;
+
+    // Like execute above, but stops early once "*cancelled" is true (see
+    // CpuExecutor::setCancellationFlag).
+    ExecutionResult<std::pair<std::vector<OutputShape>, Timing>> execute(
+            const Request& request, const OptionalTimePoint& deadline,
+            const OptionalDuration& loopTimeoutDuration, const std::atomic<bool>* cancelled) const;
+
+   private:
+    struct CachedMemory {
+        RunTimePoolInfo poolInfo;
+        // Released by the last user of the memory (see RuntimeMemory::hold).
+        std::weak_ptr<const OptionalCacheHold::element_type> hold;
+    };
+
+    // Returns the mapping of "memory", mapping it if it is not cached.
+    std::optional<RunTimePoolInfo> getRunTimePoolInfo(const SharedMemory& memory) const;
+
+    const CpuPreparedModel& kPreparedModel;
+    mutable std::mutex mMutex;
+    mutable std::map<const Memory*, CachedMemory> mCachedMemories GUARDED_BY(mMutex);
+};
+
 std::vector<bool> CpuDevice::getSupportedOperations(const MetaModel& metaModel) const {
     const Model& model = metaModel.getModel();
     const size_t count = model.main.operations.size();
@@ -1008,11 +1074,40 @@ std::pair<int, std::unique_ptr<RuntimeMemory>> CpuDevice::allocate(const MemoryD
     return MemoryAshmem::create(size);
 }
 
+// Starts reading the constant values of "model" that are in file-backed
+// pools, such as the weights of a model created from a weight file with
+// ANeuralNetworksMemory_createFromFd, so that the first execution does not
+// fault them in one page at a time. Only the values the model uses are read,
+// with one madvise(2) call for each run of adjacent values.
+static void adviseConstants(const Model& model, const std::vector<RunTimePoolInfo>& poolInfos) {
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> ranges(poolInfos.size());
+    const auto addRanges = [&ranges](const Model::Subgraph& subgraph) {
+        for (const Operand& operand : subgraph.operands) {
+            if (operand.lifetime == Operand::LifeTime::CONSTANT_REFERENCE &&
+                operand.location.poolIndex < ranges.size()) {
+                ranges[operand.location.poolIndex].emplace_back(operand.location.offset,
+                                                                operand.location.length);
+            }
+        }
+    };
+    addRanges(model.main);
+    for (const Model::Subgraph& subgraph : model.referenced) {
+        addRanges(subgraph);
+    }
+    for (size_t i = 0; i < poolInfos.size(); i++) {
+        if (!ranges[i].empty()) {
+            poolInfos[i].adviseRanges(RunTimePoolInfo::AccessHint::WILL_NEED,
+                                      std::move(ranges[i]));
+        }
+    }
+}
+
 std::pair<int, std::shared_ptr<RuntimePreparedModel>> CpuPreparedModel::create(Model model) {
     std::vector<RunTimePoolInfo> poolInfos;
     if (!setRunTimePoolInfosFromCanonicalMemories(&poolInfos, model.pools)) {
         return {ANEURALNETWORKS_UNMAPPABLE, nullptr};
     }
+    adviseConstants(model, poolInfos);
 
     std::shared_ptr<RuntimePreparedModel> preparedModel =
             std::make_shared<CpuPreparedModel>(std::move(model), std::move(poolInfos));
@@ -1023,9 +1118,12 @@ static std::tuple<int, std::vector<OutputShape>, Timing> computeOnCpu(
         const Model& model, const Request& request,
         const std::vector<RunTimePoolInfo>& modelPoolInfos,
         const std::vector<RunTimePoolInfo>& requestPoolInfos, const OptionalTimePoint& deadline,
-        const OptionalDuration& loopTimeoutDuration) {
+        const OptionalDuration& loopTimeoutDuration, OperationCache* operationCache,
+        const std::atomic<bool>* cancelled) {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "computeOnCpu");
     CpuExecutor executor;
+    executor.setOperationCache(operationCache);
+    executor.setCancellationFlag(cancelled);
     if (loopTimeoutDuration.has_value()) {
         executor.setLoopTimeout(loopTimeoutDuration->count());
     }
@@ -1037,6 +1135,112 @@ static std::tuple<int, std::vector<OutputShape>, Timing> computeOnCpu(
     return {err, outputShapes, {}};
 }
 
+GeneralResult<SharedBurst> CpuPreparedModel::configureExecutionBurst() const {
+    auto burst = std::make_shared<CpuBurst>(*this);
+    std::lock_guard<std::mutex> guard(mBurstsMutex);
+    mBursts.erase(std::remove_if(mBursts.begin(), mBursts.end(),
+                                 [](const auto& weakBurst) { return weakBurst.expired(); }),
+                  mBursts.end());
+    mBursts.push_back(burst);
+    return burst;
+}
+
+std::shared_ptr<const CpuBurst> CpuPreparedModel::findBurst(const SharedBurst& burst) const {
+    std::lock_guard<std::mutex> guard(mBurstsMutex);
+    for (const auto& weakBurst : mBursts) {
+        // A burst that is alive can't share its address with another one.
+        std::shared_ptr<const CpuBurst> cpuBurst = weakBurst.lock();
+        if (cpuBurst != nullptr && static_cast<const IBurst*>(cpuBurst.get()) == burst.get()) {
+            return cpuBurst;
+        }
+    }
+    return nullptr;
+}
+
+IBurst::OptionalCacheHold CpuBurst::cacheMemory(const SharedMemory& memory) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mCachedMemories.find(memory.get());
+    if (it != mCachedMemories.end()) {
+        if (auto hold = it->second.hold.lock()) {
+            return hold;
+        }
+        mCachedMemories.erase(it);
+    }
+    auto poolInfo = RunTimePoolInfo::createFromMemory(memory);
+    if (!poolInfo.has_value()) {
+        return nullptr;
+    }
+    // The hold may outlive the burst.
+    std::weak_ptr<const CpuBurst> weakBurst = weak_from_this();
+    const Memory* key = memory.get();
+    auto hold = std::make_shared<const OptionalCacheHold::element_type>(
+            std::function<void()>([weakBurst, key] {
+                if (const auto burst = weakBurst.lock()) {
+                    std::lock_guard<std::mutex> guard(burst->mMutex);
+                    burst->mCachedMemories.erase(key);
+                }
+            }));
+    mCachedMemories.emplace(key, CachedMemory{.poolInfo = std::move(*poolInfo), .hold = hold});
+    return hold;
+}
+
+std::optional<RunTimePoolInfo> CpuBurst::getRunTimePoolInfo(const SharedMemory& memory) const {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (const auto it = mCachedMemories.find(memory.get()); it != mCachedMemories.end()) {
+            return it->second.poolInfo;
+        }
+    }
+    return RunTimePoolInfo::createFromMemory(memory);
+}
+
+ExecutionResult<std::pair<std::vector<OutputShape>, Timing>> CpuBurst::execute(
+        const Request& request, MeasureTiming /*measure*/, const OptionalTimePoint& deadline,
+        const OptionalDuration& loopTimeoutDuration) const {
+    return execute(request, deadline, loopTimeoutDuration, /*cancelled=*/nullptr);
+}
+
+ExecutionResult<std::pair<std::vector<OutputShape>, Timing>> CpuBurst::execute(
+        const Request& request, const OptionalTimePoint& deadline,
+        const OptionalDuration& loopTimeoutDuration, const std::atomic<bool>* cancelled) const {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "CpuBurst::execute");
+    if (hasDeadlinePassed(deadline)) {
+        return NN_ERROR(ErrorStatus::MISSED_DEADLINE_PERSISTENT);
+    }
+
+    std::vector<RunTimePoolInfo> requestPoolInfos;
+    requestPoolInfos.reserve(request.pools.size());
+    for (const auto& pool : request.pools) {
+        const auto* memory = std::get_if<SharedMemory>(&pool);
+        if (memory == nullptr) {
+            return NN_ERROR(ErrorStatus::INVALID_ARGUMENT)
+                   << "CpuBurst::execute only supports memory pools";
+        }
+        auto poolInfo = getRunTimePoolInfo(*memory);
+        if (!poolInfo.has_value()) {
+            return NN_ERROR(ErrorStatus::GENERAL_FAILURE) << "CpuBurst::execute -- unable to map";
+        }
+        requestPoolInfos.push_back(std::move(*poolInfo));
+    }
+
+    auto [n, outputShapes, timing] =
+            computeOnCpu(kPreparedModel.getModel(), request, kPreparedModel.getModelPoolInfos(),
+                         requestPoolInfos, deadline, loopTimeoutDuration,
+                         kPreparedModel.getOperationCache(), cancelled);
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        return NN_ERROR(convertResultCodeToErrorStatus(n), std::move(outputShapes));
+    }
+    return std::make_pair(std::move(outputShapes), timing);
+}
+
+GeneralResult<SharedExecution> CpuBurst::createReusableExecution(
+        const Request& /*request*/, MeasureTiming /*measure*/,
+        const OptionalDuration& /*loopTimeoutDuration*/) const {
+    // Reusable executions on the CPU are created by CpuPreparedModel, and don't use the burst.
+    return NN_ERROR(ErrorStatus::GENERAL_FAILURE)
+           << "CpuBurst::createReusableExecution is not supported";
+}
+
 std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuPreparedModel::executeFenced(
         const std::vector<ModelArgumentInfo>& inputs, const std::vector<ModelArgumentInfo>& outputs,
         const std::vector<const RuntimeMemory*>& memories, const std::vector<int>& waitFor,
@@ -1063,8 +1267,9 @@ std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuPreparedModel::execut
         }
     }
 
-    const auto [result, outputShapes, timing] = execute(inputs, outputs, memories, nullptr, measure,
-                                                        closestDeadline, loopTimeoutDuration);
+    const auto [result, outputShapes, timing] =
+            execute(inputs, outputs, memories, nullptr, measure, closestDeadline,
+                    loopTimeoutDuration, /*cancelled=*/nullptr);
     return {result, -1, nullptr, timing};
 }
 
@@ -1115,13 +1320,47 @@ static std::tuple<int, Request, std::vector<RunTimePoolInfo>> createCpuRequest(
 // Will choose between sync/async execution according to DeviceManager::mSyncExecCpu.
 std::tuple<int, std::vector<OutputShape>, Timing> CpuPreparedModel::execute(
         const std::vector<ModelArgumentInfo>& inputs, const std::vector<ModelArgumentInfo>& outputs,
-        const std::vector<const RuntimeMemory*>& memories, const SharedBurst& /*burstController*/,
-        MeasureTiming /*measure*/, const OptionalTimePoint& deadline,
-        const OptionalDuration& loopTimeoutDuration) const {
+        const std::vector<const RuntimeMemory*>& memories, const SharedBurst& burstController,
+        MeasureTiming measure, const OptionalTimePoint& deadline,
+        const OptionalDuration& loopTimeoutDuration, const std::atomic<bool>* cancelled) const {
     if (hasDeadlinePassed(deadline)) {
         return {ANEURALNETWORKS_MISSED_DEADLINE_PERSISTENT, {}, {}};
     }
 
+    // A burst can only map shared memories. Memories allocated by a driver
+    // take the path below, which reports them as unmappable.
+    const bool burstCompute =
+            burstController != nullptr &&
+            std::all_of(memories.begin(), memories.end(), [](const RuntimeMemory* memory) {
+                return std::holds_alternative<SharedMemory>(memory->getMemoryPool());
+            });
+    if (burstCompute) {
+        for (const RuntimeMemory* memory : memories) {
+            auto cacheHold = burstController->cacheMemory(
+                    std::get<SharedMemory>(memory->getMemoryPool()));
+            memory->hold(cacheHold);
+        }
+        // Pointer arguments are passed as pointers, as with createCpuRequest.
+        const Request request = createDriverRequest(inputs, outputs, memories);
+        // Only a burst of this prepared model can stop early when the
+        // computation is cancelled.
+        const std::shared_ptr<const CpuBurst> cpuBurst = findBurst(burstController);
+        auto result = cpuBurst != nullptr
+                              ? cpuBurst->execute(request, deadline, loopTimeoutDuration, cancelled)
+                              : burstController->execute(request, measure, deadline,
+                                                         loopTimeoutDuration);
+        if (!result.ok()) {
+            auto [message, code, outputShapes] = std::move(result).error();
+            VLOG(EXECUTION) << "CpuBurst::execute(...) error: " << message;
+            if (code != ErrorStatus::OUTPUT_INSUFFICIENT_SIZE) {
+                outputShapes.clear();
+            }
+            return {convertErrorStatusToResultCode(code), std::move(outputShapes), {}};
+        }
+        auto [outputShapes, timing] = std::move(result).value();
+        return {ANEURALNETWORKS_NO_ERROR, std::move(outputShapes), timing};
+    }
+
     int nCreateRequest;
     Request request;
     std::vector<RunTimePoolInfo> requestPoolInfos;
@@ -1136,15 +1375,16 @@ std::tuple<int, std::vector<OutputShape>, Timing> CpuPreparedModel::execute(
         // TODO(mikie): this could have NNTRACE so we could measure the overhead
         //              of spinning up a new thread.
         std::tuple<int, std::vector<OutputShape>, Timing> result = {};
-        std::thread([this, &request, &requestPoolInfos, &deadline, &loopTimeoutDuration, &result] {
+        std::thread([this, &request, &requestPoolInfos, &deadline, &loopTimeoutDuration, cancelled,
+                     &result] {
             result = computeOnCpu(mModel, request, mModelPoolInfos, requestPoolInfos, deadline,
-                                  loopTimeoutDuration);
+                                  loopTimeoutDuration, getOperationCache(), cancelled);
         }).join();
         return result;
     }
 
     return computeOnCpu(mModel, request, mModelPoolInfos, requestPoolInfos, deadline,
-                        loopTimeoutDuration);
+                        loopTimeoutDuration, getOperationCache(), cancelled);
 }
 
 std::pair<int, std::shared_ptr<RuntimeExecution>> CpuPreparedModel::createReusableExecution(
@@ -1161,7 +1401,8 @@ std::pair<int, std::shared_ptr<RuntimeExecution>> CpuPreparedModel::createReusab
 }
 
 std::tuple<int, std::vector<OutputShape>, Timing> CpuExecution::compute(
-        const SharedBurst& /*burstController*/, const OptionalTimePoint& deadline) const {
+        const SharedBurst& /*burstController*/, const OptionalTimePoint& deadline,
+        const std::atomic<bool>* cancelled) const {
     if (hasDeadlinePassed(deadline)) {
         return {ANEURALNETWORKS_MISSED_DEADLINE_PERSISTENT, {}, {}};
     }
@@ -1171,16 +1412,18 @@ std::tuple<int, std::vector<OutputShape>, Timing> CpuExecution::compute(
         // TODO(mikie): this could have NNTRACE so we could measure the overhead
         //              of spinning up a new thread.
         std::tuple<int, std::vector<OutputShape>, Timing> result = {};
-        std::thread([this, &deadline, &result] {
+        std::thread([this, &deadline, cancelled, &result] {
             result = computeOnCpu(kPreparedModel.getModel(), kRequest,
                                   kPreparedModel.getModelPoolInfos(), kRequestPoolInfos, deadline,
-                                  kLoopTimeoutDuration);
+                                  kLoopTimeoutDuration, kPreparedModel.getOperationCache(),
+                                  cancelled);
         }).join();
         return result;
     }
 
     return computeOnCpu(kPreparedModel.getModel(), kRequest, kPreparedModel.getModelPoolInfos(),
-                        kRequestPoolInfos, deadline, kLoopTimeoutDuration);
+                        kRequestPoolInfos, deadline, kLoopTimeoutDuration,
+                        kPreparedModel.getOperationCache(), cancelled);
 }
 
 std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuExecution::computeFenced(
@@ -1207,7 +1450,8 @@ std::tuple<int, int, ExecuteFencedInfoCallback, Timing> CpuExecution::computeFen
         }
     }
 
-    const auto [result, outputShapes, timing] = compute(nullptr, closestDeadline);
+    const auto [result, outputShapes, timing] =
+            compute(nullptr, closestDeadline, /*cancelled=*/nullptr);
     return {result, -1, nullptr, timing};
 }
 
@@ -1288,6 +1532,13 @@ DeviceManager::DeviceManager() {
     mDebugNNCpuOnly = (getProp("debug.nn.cpuonly") != 0);
     mSyncExecCpu = (getProp("debug.nn.syncexec-cpu", 1) != 0);
     mSyncExecRuntime = (getProp("debug.nn.syncexec-runtime") != 0);
+    mConcurrentSteps = (getProp("debug.nn.concurrent-steps", 1) != 0);
+    mMaxConcurrentStepCompilations = std::max(
+            getProp("debug.nn.concurrent-step-compilations", kDefaultMaxConcurrentStepCompilations),
+            1u);
+    mCachePartitioningPlans = (getProp("debug.nn.cache-partitioning-plans", 1) != 0);
+    mShareLargeValuePools = (getProp("debug.nn.share-large-value-pools") != 0);
+    mCpuHybridWeightsTolerance = getProp("debug.nn.cpu-hybrid-weights") / 10000.0f;
 #endif  // NN_DEBUGGABLE
 }
 
@@ -23,6 +23,8 @@
 #include <nnapi/IDevice.h>
 #include <nnapi/Types.h>
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -53,8 +55,12 @@ class RuntimeExecution {
     RuntimeExecution() = default;
     virtual ~RuntimeExecution() = default;
 
+    // "cancelled", if not nullptr, is set when the computation is cancelled
+    // (see ExecutionBuilder::cancel). Implementations that can't stop a
+    // computation once it has started may ignore it.
     virtual std::tuple<int, std::vector<OutputShape>, Timing> compute(
-            const SharedBurst& burstController, const OptionalTimePoint& deadline) const = 0;
+            const SharedBurst& burstController, const OptionalTimePoint& deadline,
+            const std::atomic<bool>* cancelled) const = 0;
 
     // The returned timing information is only valid if the callback is nullptr.
     // Returns error_code, sync_fence, callback and timing.
@@ -75,12 +81,14 @@ class RuntimePreparedModel {
     virtual SharedPreparedModel getInterface() const = 0;
 
     // Perform computation with given input/output argument info and memory pools.
+    // See RuntimeExecution::compute for "cancelled".
     virtual std::tuple<int, std::vector<OutputShape>, Timing> execute(
             const std::vector<ModelArgumentInfo>& inputs,
             const std::vector<ModelArgumentInfo>& outputs,
             const std::vector<const RuntimeMemory*>& memories, const SharedBurst& burstController,
             MeasureTiming measure, const OptionalTimePoint& deadline,
-            const OptionalDuration& loopTimeoutDuration) const = 0;
+            const OptionalDuration& loopTimeoutDuration,
+            const std::atomic<bool>* cancelled) const = 0;
 
     // Perform fenced computation with given input/output argument info and memory pools.
     // The returned timing information is only valid if the callback is nullptr.
@@ -176,19 +184,91 @@ class DeviceManager {
     bool syncExecCpu() const { return mSyncExecCpu; }
     bool syncExecRuntime() const { return mSyncExecRuntime; }
 
+    // Run the independent steps of a partitioned execution concurrently? See
+    // ExecutionPlan::canRunStepsConcurrently(). This is the default; setting
+    // debug.nn.concurrent-steps to 0 runs the steps one at a time in plan
+    // order instead, which is easier to debug.
+    bool concurrentSteps() const { return mConcurrentSteps; }
+
+    // For testing only:
+    void setConcurrentSteps(bool concurrentSteps) { mConcurrentSteps = concurrentSteps; }
+
+    // The maximum number of step models of a partitioned compilation that are
+    // prepared at the same time. 1 prepares them one at a time.
+    uint32_t getMaxConcurrentStepCompilations() const { return mMaxConcurrentStepCompilations; }
+
+    // For testing only:
+    void setMaxConcurrentStepCompilations(uint32_t maxConcurrentStepCompilations) {
+        mMaxConcurrentStepCompilations = std::max(maxConcurrentStepCompilations, 1u);
+    }
+
+    // Store the device assignment of a partitioned compilation in its cache
+    // directory, and reuse it for later compilations with the same cache
+    // token? See PartitioningPlanCache.
+    bool cachePartitioningPlans() const { return mCachePartitioningPlans; }
+
+    // For testing only:
+    void setCachePartitioningPlans(bool cachePartitioningPlans) {
+        mCachePartitioningPlans = cachePartitioningPlans;
+    }
+
+    // Share the pool of the large constant values of every model with the
+    // other live models whose values are identical, whether or not the models
+    // opt in with ANeuralNetworksModel_shareLargeValues? See
+    // LargeValuePoolCache.
+    bool shareLargeValuePools() const { return mShareLargeValuePools; }
+
+    // For testing only:
+    void setShareLargeValuePools(bool shareLargeValuePools) {
+        mShareLargeValuePools = shareLargeValuePools;
+    }
+
     // How to handle graph partitioning?
     // 0 - Don't do graph partitioning.
     // 1 - Do graph partitioning; but fall back to non-partitioned
     //     execution if there is a partitioning failure.
     // 2 - Do graph partitioning, and rely on it; there is no fallback.
-    enum { kPartitioningNo = 0, kPartitioningWithFallback = 1, kPartitioningWithoutFallback = 2 };
+    // Any of the above may be combined with
+    // 4 - Assign operations to devices by minimizing the estimated cost of
+    //     the whole graph, including the cost of the execution steps and of
+    //     the operands passed between them, instead of choosing the best
+    //     device for each operation independently.
+    // 8 - For compilations with a cache, record the execution times of their
+    //     steps next to the cache (see PartitioningProfile), and estimate the
+    //     cost of operations from these measurements in later compilations.
+    enum {
+        kPartitioningNo = 0,
+        kPartitioningWithFallback = 1,
+        kPartitioningWithoutFallback = 2,
+        kPartitioningModeMask = 3,
+        kPartitioningCostModel = 4,
+        kPartitioningProfileGuided = 8
+    };
     uint32_t getPartitioning() const { return mPartitioning; }
+    static bool partitioningIsEnabled(uint32_t partitioning) {
+        return (partitioning & kPartitioningModeMask) != kPartitioningNo;
+    }
     static bool partitioningAllowsFallback(uint32_t partitioning) {
-        return partitioning == kPartitioningWithFallback;
+        return (partitioning & kPartitioningModeMask) == kPartitioningWithFallback;
+    }
+    static bool partitioningUsesCostModel(uint32_t partitioning) {
+        return (partitioning & kPartitioningCostModel) != 0;
+    }
+    static bool partitioningUsesProfile(uint32_t partitioning) {
+        return (partitioning & kPartitioningProfileGuided) != 0;
     }
 
     bool strictSlicing() const { return mStrictSlicing; }
 
+    // The relative error the CPU may introduce by quantizing large constant float weights to
+    // int8 for hybrid execution, see OperationCache. 0 disables hybrid execution. It can only be
+    // set through debug.nn.cpu-hybrid-weights in debuggable builds, so hybrid execution is a
+    // debugging and evaluation aid and is always off in user builds.
+    float getCpuHybridWeightsTolerance() const { return mCpuHybridWeightsTolerance; }
+
+    // For testing only:
+    void setCpuHybridWeightsTolerance(float tolerance) { mCpuHybridWeightsTolerance = tolerance; }
+
     // Returns the singleton manager.
     static DeviceManager* get();
 
@@ -246,10 +326,27 @@ class DeviceManager {
     bool mSyncExecCpu = true;
     bool mSyncExecRuntime = false;
 
+    // Derived from system property debug.nn.concurrent-steps.
+    bool mConcurrentSteps = true;
+
+    // Derived from system property debug.nn.concurrent-step-compilations.
+    uint32_t mMaxConcurrentStepCompilations = kDefaultMaxConcurrentStepCompilations;
+
+    static const uint32_t kDefaultMaxConcurrentStepCompilations = 4;
+
+    // Derived from system property debug.nn.cache-partitioning-plans.
+    bool mCachePartitioningPlans = true;
+
+    // Derived from system property debug.nn.share-large-value-pools.
+    bool mShareLargeValuePools = false;
+
     static const uint32_t kPartitioningDefault = kPartitioningWithFallback;
     uint32_t mPartitioning = kPartitioningDefault;
 
     bool mStrictSlicing = false;
+
+    // Derived from system property debug.nn.cpu-hybrid-weights, in units of 1/10000.
+    float mCpuHybridWeightsTolerance = 0.0f;
 };
 
 std::vector<SharedDevice> getDevices();
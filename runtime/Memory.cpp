@@ -28,7 +28,9 @@
 #include <nnapi/Types.h>
 
 #include <algorithm>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <tuple>
 #include <utility>
@@ -607,5 +609,63 @@ std::pair<int, std::unique_ptr<MemoryFromDevice>> MemoryFromDevice::create(Share
 
 MemoryFromDevice::MemoryFromDevice(SharedBuffer buffer) : RuntimeMemory(std::move(buffer)) {}
 
+SharedBufferRegistry& SharedBufferRegistry::get() {
+    static SharedBufferRegistry registry;
+    return registry;
+}
+
+int SharedBufferRegistry::allocate(size_t size, void** buffer) {
+    *buffer = nullptr;
+    if (size == 0 || size > std::numeric_limits<uint32_t>::max()) {
+        LOG(ERROR) << "ANeuralNetworks_allocateSharedBuffer passed an invalid size " << size;
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    auto [n, memory] = MemoryAshmem::create(static_cast<uint32_t>(size));
+    if (n != ANEURALNETWORKS_NO_ERROR) {
+        return n;
+    }
+    uint8_t* pointer = memory->getPointer();
+    std::lock_guard<std::mutex> guard(mMutex);
+    mBuffers.emplace(pointer, std::move(memory));
+    *buffer = pointer;
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+void SharedBufferRegistry::free(void* buffer) {
+    std::unique_ptr<MemoryAshmem> memory;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        const auto it = mBuffers.find(static_cast<const uint8_t*>(buffer));
+        if (it == mBuffers.end()) {
+            if (buffer != nullptr) {
+                LOG(ERROR) << "ANeuralNetworks_freeSharedBuffer passed an unknown buffer";
+            }
+            return;
+        }
+        memory = std::move(it->second);
+        mBuffers.erase(it);
+    }
+    // The memory is unmapped here, outside of the lock.
+}
+
+const RuntimeMemory* SharedBufferRegistry::find(const void* buffer, size_t length,
+                                                uint32_t* offset) const {
+    const auto* begin = static_cast<const uint8_t*>(buffer);
+    std::lock_guard<std::mutex> guard(mMutex);
+    // Find the last buffer that starts at or before "begin".
+    auto it = mBuffers.upper_bound(begin);
+    if (it == mBuffers.begin()) {
+        return nullptr;
+    }
+    --it;
+    const MemoryAshmem* memory = it->second.get();
+    const size_t distance = begin - it->first;
+    if (distance >= memory->getSize() || length > memory->getSize() - distance) {
+        return nullptr;
+    }
+    *offset = static_cast<uint32_t>(distance);
+    return memory;
+}
+
 }  // namespace nn
 }  // namespace android
@@ -21,6 +21,7 @@
 #include <LegacyUtils.h>
 #include <android-base/macros.h>
 #include <android-base/scopeguard.h>
+#include <android-base/thread_annotations.h>
 #include <nnapi/IBuffer.h>
 #include <nnapi/IBurst.h>
 #include <nnapi/SharedMemory.h>
@@ -357,6 +358,34 @@ class MemoryFromDevice : public RuntimeMemory {
 
 using MemoryTracker = ObjectTracker<RuntimeMemory>;
 
+// Keeps track of the buffers allocated with ANeuralNetworks_allocateSharedBuffer. Each buffer is
+// the mapping of a MemoryAshmem, so an execution input or output specified as a pointer into
+// one of them can be passed to the drivers as a memory pool instead of being copied.
+class SharedBufferRegistry {
+    DISALLOW_COPY_AND_ASSIGN(SharedBufferRegistry);
+
+   public:
+    static SharedBufferRegistry& get();
+
+    // On success, returns ANEURALNETWORKS_NO_ERROR and sets *buffer to a page-aligned buffer of
+    // "size" bytes. On error, returns the appropriate NNAPI error code.
+    int allocate(size_t size, void** buffer);
+
+    // Does nothing if "buffer" is nullptr or wasn't returned by allocate().
+    void free(void* buffer);
+
+    // Returns the memory containing the "length" bytes at "buffer" and sets *offset to the
+    // offset of "buffer" in it, or returns nullptr if they aren't in a single shared buffer.
+    const RuntimeMemory* find(const void* buffer, size_t length, uint32_t* offset) const;
+
+   private:
+    SharedBufferRegistry() = default;
+
+    mutable std::mutex mMutex;
+    // Maps the start of each buffer to the memory it belongs to.
+    std::map<const uint8_t*, std::unique_ptr<MemoryAshmem>> mBuffers GUARDED_BY(mMutex);
+};
+
 }  // namespace nn
 }  // namespace android
 
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MemoryRecycler"
+
+#include "MemoryRecycler.h"
+
+#include <LegacyUtils.h>
+#include <android-base/logging.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// Enough for the temporaries of a few large models.
+constexpr size_t kDefaultMaxPooledBytes = 64 * 1024 * 1024;
+constexpr auto kDefaultIdleTimeout = std::chrono::seconds(10);
+
+}  // namespace
+
+MemoryRecycler& MemoryRecycler::get() {
+    static MemoryRecycler recycler(kDefaultMaxPooledBytes, kDefaultIdleTimeout);
+    return recycler;
+}
+
+MemoryRecycler::MemoryRecycler(size_t maxPooledBytes, Clock::duration idleTimeout)
+    : kMaxPooledBytes(maxPooledBytes), kIdleTimeout(idleTimeout) {}
+
+uint32_t MemoryRecycler::getSizeClass(uint32_t size) {
+    static const uint32_t kPageSize = getpagesize();
+    if (size <= kPageSize) {
+        return kPageSize;
+    }
+    if (size > (1u << 31)) {
+        return size;
+    }
+    uint32_t sizeClass = kPageSize;
+    while (sizeClass < size) {
+        sizeClass *= 2;
+    }
+    return sizeClass;
+}
+
+std::pair<int, std::unique_ptr<MemoryAshmem>> MemoryRecycler::allocateAshmem(uint32_t size) {
+    const uint32_t sizeClass = getSizeClass(size);
+    if (auto memory = take(Kind::ASHMEM, sizeClass)) {
+        return {ANEURALNETWORKS_NO_ERROR,
+                std::unique_ptr<MemoryAshmem>(static_cast<MemoryAshmem*>(memory.release()))};
+    }
+    return MemoryAshmem::create(sizeClass);
+}
+
+std::pair<int, std::unique_ptr<MemoryRuntimeAHWB>> MemoryRecycler::allocateAhwb(uint32_t size) {
+    if (auto memory = take(Kind::AHWB, size)) {
+        return {ANEURALNETWORKS_NO_ERROR, std::unique_ptr<MemoryRuntimeAHWB>(
+                                                  static_cast<MemoryRuntimeAHWB*>(memory.release()))};
+    }
+    return MemoryRuntimeAHWB::create(size);
+}
+
+void MemoryRecycler::recycle(std::unique_ptr<MemoryAshmem> memory) {
+    if (memory != nullptr) {
+        give(Kind::ASHMEM, std::move(memory));
+    }
+}
+
+void MemoryRecycler::recycle(std::unique_ptr<MemoryRuntimeAHWB> memory) {
+    if (memory != nullptr) {
+        give(Kind::AHWB, std::move(memory));
+    }
+}
+
+std::unique_ptr<RuntimeMemory> MemoryRecycler::take(Kind kind, uint32_t size) {
+    std::vector<Entry> dropped;
+    std::lock_guard<std::mutex> lock(mMutex);
+    trimLocked(Clock::now(), &dropped);
+    const auto it = mMemories.find({kind, size});
+    if (it == mMemories.end() || it->second.empty()) {
+        mStats.allocations++;
+        return nullptr;
+    }
+    std::unique_ptr<RuntimeMemory> memory = std::move(it->second.back().memory);
+    it->second.pop_back();
+    mPooledBytes -= size;
+    mStats.reuses++;
+    return memory;
+}
+
+void MemoryRecycler::give(Kind kind, std::unique_ptr<RuntimeMemory> memory) {
+    const uint32_t size = memory->getSize();
+    const Clock::time_point now = Clock::now();
+    std::vector<Entry> dropped;
+    std::lock_guard<std::mutex> lock(mMutex);
+    trimLocked(now, &dropped);
+    if (mPooledBytes + size > kMaxPooledBytes) {
+        VLOG(EXECUTION) << "MemoryRecycler::give dropping memory of size " << size;
+        dropped.push_back({std::move(memory), now});
+        return;
+    }
+    mMemories[{kind, size}].push_back({std::move(memory), now});
+    mPooledBytes += size;
+}
+
+void MemoryRecycler::trimLocked(Clock::time_point now, std::vector<Entry>* dropped) {
+    for (auto it = mMemories.begin(); it != mMemories.end();) {
+        std::vector<Entry>& entries = it->second;
+        const auto firstKept =
+                std::find_if(entries.begin(), entries.end(), [this, now](const Entry& entry) {
+                    return now - entry.recycledAt <= kIdleTimeout;
+                });
+        for (auto entry = entries.begin(); entry != firstKept; ++entry) {
+            mPooledBytes -= it->first.second;
+            dropped->push_back(std::move(*entry));
+        }
+        entries.erase(entries.begin(), firstKept);
+        it = entries.empty() ? mMemories.erase(it) : std::next(it);
+    }
+}
+
+void MemoryRecycler::clear() {
+    decltype(mMemories) dropped;
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::swap(dropped, mMemories);
+    mPooledBytes = 0;
+}
+
+MemoryRecycler::Stats MemoryRecycler::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+size_t MemoryRecycler::getPooledBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPooledBytes;
+}
+
+}  // namespace nn
+}  // namespace android
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_MEMORY_RECYCLER_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_MEMORY_RECYCLER_H
+
+#include <android-base/macros.h>
+#include <android-base/thread_annotations.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Memory.h"
+
+namespace android {
+namespace nn {
+
+// Keeps the shared memories that the runtime allocates for the duration of an
+// execution, such as the temporaries of a partitioned execution and the BLOB
+// mode AHardwareBuffers of a CPU fallback, so that later executions reuse them
+// instead of mapping (and having drivers map) new ones. Thread safe.
+//
+// Ashmem is handed out in size classes, so that a memory can be reused for
+// any request of the same class. AHardwareBuffers are only reused for requests
+// of exactly their size, because copies between them and device memories
+// require matching sizes.
+//
+// The recycler keeps at most "maxPooledBytes" bytes, and drops memories that
+// haven't been reused for "idleTimeout" the next time it is called.
+class MemoryRecycler {
+    DISALLOW_COPY_AND_ASSIGN(MemoryRecycler);
+
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        // The number of memories allocated.
+        uint64_t allocations = 0;
+        // The number of times a recycled memory was reused.
+        uint64_t reuses = 0;
+    };
+
+    // The recycler shared by all executions of the process.
+    static MemoryRecycler& get();
+
+    MemoryRecycler(size_t maxPooledBytes, Clock::duration idleTimeout);
+
+    // Returns an ashmem of getSizeClass(size) bytes. On error, returns the
+    // appropriate NNAPI error code and nullptr.
+    std::pair<int, std::unique_ptr<MemoryAshmem>> allocateAshmem(uint32_t size);
+
+    // Returns a BLOB mode AHardwareBuffer of "size" bytes. On error, returns
+    // the appropriate NNAPI error code and nullptr.
+    std::pair<int, std::unique_ptr<MemoryRuntimeAHWB>> allocateAhwb(uint32_t size);
+
+    // Makes "memory", which must have been returned by allocateAshmem() or
+    // allocateAhwb() and is no longer used, available to later allocations.
+    // Does nothing if "memory" is nullptr.
+    void recycle(std::unique_ptr<MemoryAshmem> memory);
+    void recycle(std::unique_ptr<MemoryRuntimeAHWB> memory);
+
+    // The size of the ashmem allocated for a request of "size" bytes: the
+    // next power of two, and at least a page.
+    static uint32_t getSizeClass(uint32_t size);
+
+    // Frees all the memories available for reuse.
+    void clear();
+
+    Stats getStats() const;
+
+    // The number of bytes of the memories available for reuse.
+    size_t getPooledBytes() const;
+
+   private:
+    enum class Kind { ASHMEM, AHWB };
+
+    struct Entry {
+        std::unique_ptr<RuntimeMemory> memory;
+        Clock::time_point recycledAt;
+    };
+
+    // Removes and returns the most recently recycled memory of "kind" and
+    // "size", or nullptr.
+    std::unique_ptr<RuntimeMemory> take(Kind kind, uint32_t size);
+    void give(Kind kind, std::unique_ptr<RuntimeMemory> memory);
+
+    // Moves the memories that have been idle for longer than kIdleTimeout to
+    // "dropped", so that they can be freed after the lock is released.
+    void trimLocked(Clock::time_point now, std::vector<Entry>* dropped) REQUIRES(mMutex);
+
+    const size_t kMaxPooledBytes;
+    const Clock::duration kIdleTimeout;
+
+    mutable std::mutex mMutex;
+    // The memories of each kind and size, oldest first.
+    std::map<std::pair<Kind, uint32_t>, std::vector<Entry>> mMemories GUARDED_BY(mMutex);
+    size_t mPooledBytes GUARDED_BY(mMutex) = 0;
+    Stats mStats GUARDED_BY(mMutex);
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_MEMORY_RECYCLER_H
@@ -22,13 +22,13 @@
 #include <LegacyUtils.h>
 
 #include <algorithm>
-#include <map>
 #include <memory>
 #include <set>
 #include <utility>
 #include <vector>
 
 #include "CompilationBuilder.h"
+#include "LargeValuePoolCache.h"
 #include "Manager.h"
 #include "TypeManager.h"
 
@@ -52,6 +52,12 @@ static std::vector<Type> makeVector(const Type* data, uint32_t length) {
     return length > 0 ? std::vector<Type>(data, data + length) : std::vector<Type>();
 }
 
+// Whether the value of "operand" is written by an operation of its model.
+static bool isWrittenByOperation(const Operand& operand) {
+    return operand.lifetime == Operand::LifeTime::TEMPORARY_VARIABLE ||
+           operand.lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT;
+}
+
 bool ModelBuilder::badState(const char* name) {
     if (mCompletedModel) {
         LOG(ERROR) << "ANeuralNetworksModel_" << name << " can't modify after model finished";
@@ -120,6 +126,42 @@ int ModelBuilder::addOperand(const ANeuralNetworksOperandType& type) {
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int ModelBuilder::addOperands(uint32_t count, const ANeuralNetworksOperandType* types) {
+    if (badState("addOperands")) {
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    const size_t oldOperandCount = mOperands.size();
+    if (count > MAX_NUMBER_OF_OPERANDS - oldOperandCount) {
+        LOG(ERROR) << "ANeuralNetworksModel_addOperands exceed max operands";
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    const bool oldHasOEMOperand = mHasOEMOperand;
+    mOperands.reserve(oldOperandCount + count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (int n = addOperand(types[i]); n != ANEURALNETWORKS_NO_ERROR) {
+            LOG(ERROR) << "ANeuralNetworksModel_addOperands failed to add operand " << i << " of "
+                       << count;
+            mOperands.resize(oldOperandCount);
+            mHasOEMOperand = oldHasOEMOperand;
+            return n;
+        }
+    }
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+int ModelBuilder::reserve(uint32_t operandCount, uint32_t operationCount) {
+    if (badState("reserve")) {
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+    if (operandCount > MAX_NUMBER_OF_OPERANDS || operationCount > MAX_NUMBER_OF_OPERATIONS) {
+        LOG(ERROR) << "ANeuralNetworksModel_reserve exceed max operands or operations";
+        return ANEURALNETWORKS_BAD_DATA;
+    }
+    mOperands.reserve(operandCount);
+    mOperations.reserve(operationCount);
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int ModelBuilder::setOperandValue(uint32_t index, const void* buffer, size_t length) {
     VLOG(MODEL) << __func__ << " for operand " << index << " size " << length;
     if (badState("setOperandValue")) {
@@ -284,32 +326,55 @@ int ModelBuilder::setOperandExtensionData(uint32_t index, const void* data, size
 
 int ModelBuilder::copyLargeValuesToSharedMemory() {
     VLOG(MODEL) << __func__ << " has " << mLargeOperandValues.size() << " values.";
+    if (mReferenceSharedBufferValues) {
+        // Reference the values that are in shared buffers where they are, and
+        // only copy the others.
+        std::vector<LargeValue> valuesToCopy;
+        for (const LargeValue& l : mLargeOperandValues) {
+            Operand& operand = mOperands[l.operandIndex];
+            uint32_t offset = 0;
+            const RuntimeMemory* memory =
+                    SharedBufferRegistry::get().find(l.buffer, operand.location.length, &offset);
+            if (memory == nullptr) {
+                valuesToCopy.push_back(l);
+                continue;
+            }
+            operand.location.poolIndex = mMemories.add(memory);
+            operand.location.offset = offset;
+        }
+        VLOG(MODEL) << "Referencing " << mLargeOperandValues.size() - valuesToCopy.size()
+                    << " large values in shared buffers";
+        mLargeOperandValues = std::move(valuesToCopy);
+    }
     if (!mLargeOperandValues.empty()) {
         // Calculate the size of the shared memory needed for all the large values.
         // Also sets the offset for each value within the memory.
         size_t poolSize = 0;
+        std::vector<LargeValuePoolCache::Value> values;
+        values.reserve(mLargeOperandValues.size());
         for (LargeValue& l : mLargeOperandValues) {
             Operand& operand = mOperands[l.operandIndex];
             CHECK_EQ(operand.lifetime, Operand::LifeTime::CONSTANT_REFERENCE);
             poolSize += alignBytesNeeded(poolSize, operand.location.length);
             operand.location.offset = poolSize;
             poolSize += operand.location.length;
+            values.push_back({.buffer = l.buffer,
+                              .offset = operand.location.offset,
+                              .length = operand.location.length});
         }
 
-        // Allocate the shared memory.
+        // Get shared memory holding the values, which another model with the
+        // same values may already have if pools are shared.
         int n;
-        std::tie(n, mLargeValueMemory) = MemoryAshmem::create(poolSize);
+        std::tie(n, mLargeValueMemory) =
+                mShareLargeValues || DeviceManager::get()->shareLargeValuePools()
+                        ? LargeValuePoolCache::get().getPool(poolSize, values)
+                        : LargeValuePoolCache::createPool(poolSize, values);
         NN_RETURN_IF_ERROR(n);
-        uint8_t* memoryPointer = mLargeValueMemory->getPointer();
         uint32_t poolIndex = mMemories.add(mLargeValueMemory.get());
-        VLOG(MODEL) << "Allocated large value pool of size " << poolSize << " at index "
-                    << poolIndex;
-
-        // Copy the values to this memory.
+        VLOG(MODEL) << "Using large value pool of size " << poolSize << " at index " << poolIndex;
         for (LargeValue& l : mLargeOperandValues) {
-            Operand& operand = mOperands[l.operandIndex];
-            operand.location.poolIndex = poolIndex;
-            memcpy(memoryPointer + operand.location.offset, l.buffer, operand.location.length);
+            mOperands[l.operandIndex].location.poolIndex = poolIndex;
         }
     }
     return ANEURALNETWORKS_NO_ERROR;
@@ -478,6 +543,26 @@ int ModelBuilder::relaxComputationFloat32toFloat16(bool allow) {
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int ModelBuilder::referenceSharedBufferValues(bool reference) {
+    if (badState("referenceSharedBufferValues")) {
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+
+    mReferenceSharedBufferValues = reference;
+
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+int ModelBuilder::shareLargeValues(bool share) {
+    if (badState("shareLargeValues")) {
+        return ANEURALNETWORKS_BAD_STATE;
+    }
+
+    mShareLargeValues = share;
+
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int ModelBuilder::createCompilation(CompilationBuilder** compilation,
                                     const std::vector<std::shared_ptr<Device>>& devices,
                                     bool explicitDeviceList) {
@@ -508,7 +593,8 @@ int ModelBuilder::finish() {
     // We sort the operations so that they will be in the appropriate
     // order for a single-threaded, op at a time execution.
     // TODO: we don't need this if we always run the partitioner.
-    if (!sortIntoRunOrder()) {
+    OperandConsumers operandConsumers(mOperands, mOperations);
+    if (!sortIntoRunOrder(operandConsumers)) {
         // We expect sortIntoRunOrder() to have logged an appropriate error message.
         mInvalidModel = true;
         return ANEURALNETWORKS_BAD_DATA;
@@ -530,7 +616,11 @@ int ModelBuilder::finish() {
         graphDump("ModelBuilder::finish", modelForValidation, nullptr);
     }
 
+    // The removed trailing arguments are constants, which have no readers
+    // listed, so only the sorting has to be applied.
     removeTrailingArgumentsWithDefaultValues();
+    operandConsumers.renumber(mSortedOperationIndexMap);
+    mOperandConsumers = std::move(operandConsumers);
 
     mCompletedModel = true;
     return ANEURALNETWORKS_NO_ERROR;
@@ -792,7 +882,7 @@ uint32_t ModelBuilder::getNumTrailingArgumentsToRemove(const Operation& operatio
     return 0;
 }
 
-bool ModelBuilder::sortIntoRunOrder() {
+bool ModelBuilder::sortIntoRunOrder(const OperandConsumers& operandConsumers) {
     // Note that this may be called before the model has been
     // validated, so we must code defensively.  However, we can assume
     // an Operation's inputs and outputs have legal indices -- this
@@ -805,22 +895,19 @@ bool ModelBuilder::sortIntoRunOrder() {
 
     // Tracks the operations that can be executed.
     std::vector<uint32_t> sortedOperationIndexMap;
+    sortedOperationIndexMap.reserve(operationCount());
     std::vector<uint32_t> opsReadyToRun;
     std::vector<Operation> runOrder;
+    runOrder.reserve(operationCount());
 
     // Tracks how many inputs are needed for each operation to be ready to run.
-    std::multimap<uint32_t, uint32_t> operandToOperations;
     std::vector<uint32_t> unknownInputCount(operationCount());
     for (uint32_t operationIndex = 0; operationIndex < operationCount(); operationIndex++) {
         uint32_t& count = unknownInputCount[operationIndex];
         count = 0;
         for (uint32_t operandIndex : mOperations[operationIndex].inputs) {
-            auto lifetime = mOperands[operandIndex].lifetime;
-            if (lifetime == Operand::LifeTime::TEMPORARY_VARIABLE ||
-                lifetime == Operand::LifeTime::SUBGRAPH_OUTPUT) {
+            if (isWrittenByOperation(mOperands[operandIndex])) {
                 count++;
-                operandToOperations.insert(
-                        std::pair<uint32_t, uint32_t>(operandIndex, operationIndex));
             }
         }
         if (count == 0) {
@@ -834,19 +921,20 @@ bool ModelBuilder::sortIntoRunOrder() {
         opsReadyToRun.pop_back();
         const Operation& operation = mOperations[opIndex];
 
-        runOrder.push_back(mOperations[opIndex]);
-        sortedOperationIndexMap.push_back(opIndex);
-
-        // Mark all its outputs as known.
+        // Mark all its outputs as known. The model is not validated yet, but
+        // only the outputs counted as unknown inputs above have readers.
         for (uint32_t operandIndex : operation.outputs) {
-            auto range = operandToOperations.equal_range(operandIndex);
-            for (auto i = range.first; i != range.second; i++) {
-                uint32_t& count = unknownInputCount[i->second];
+            for (uint32_t consumer : operandConsumers.get(operandIndex)) {
+                uint32_t& count = unknownInputCount[consumer];
                 if (--count == 0) {
-                    opsReadyToRun.push_back(i->second);
+                    opsReadyToRun.push_back(consumer);
                 }
             }
         }
+
+        // Each operation is visited once, so it can be moved to its place.
+        runOrder.push_back(std::move(mOperations[opIndex]));
+        sortedOperationIndexMap.push_back(opIndex);
     }
 
     if (runOrder.size() != mOperations.size()) {
@@ -855,6 +943,10 @@ bool ModelBuilder::sortIntoRunOrder() {
         // operand, because there is at least one Operation that never
         // became ready.
         LOG(ERROR) << "Graph contains at least one cycle or one never-written operand";
+        // Put back the operations that were moved.
+        for (uint32_t i = 0; i < runOrder.size(); i++) {
+            mOperations[sortedOperationIndexMap[i]] = std::move(runOrder[i]);
+        }
         return false;
     }
 
@@ -863,6 +955,48 @@ bool ModelBuilder::sortIntoRunOrder() {
     return true;
 }
 
+OperandConsumers::OperandConsumers(const std::vector<Operand>& operands,
+                                   const std::vector<Operation>& operations)
+    : mOffsets(operands.size() + 1, 0) {
+    // Count the readers of each operand, turn the counts into offsets, and
+    // fill in the readers in operation order.
+    const size_t operandCount = operands.size();
+    for (const Operation& operation : operations) {
+        for (uint32_t operandIndex : operation.inputs) {
+            CHECK_LT(operandIndex, operandCount);
+            if (isWrittenByOperation(operands[operandIndex])) {
+                mOffsets[operandIndex + 1]++;
+            }
+        }
+    }
+    for (size_t i = 0; i < operandCount; i++) {
+        mOffsets[i + 1] += mOffsets[i];
+    }
+    mConsumers.resize(mOffsets[operandCount]);
+    std::vector<uint32_t> next(mOffsets.begin(), mOffsets.end() - 1);
+    for (uint32_t operationIndex = 0; operationIndex < operations.size(); operationIndex++) {
+        for (uint32_t operandIndex : operations[operationIndex].inputs) {
+            if (isWrittenByOperation(operands[operandIndex])) {
+                mConsumers[next[operandIndex]++] = operationIndex;
+            }
+        }
+    }
+}
+
+void OperandConsumers::renumber(const std::vector<uint32_t>& oldIndexes) {
+    std::vector<uint32_t> newIndexes(oldIndexes.size());
+    for (uint32_t i = 0; i < oldIndexes.size(); i++) {
+        newIndexes[oldIndexes[i]] = i;
+    }
+    for (uint32_t& consumer : mConsumers) {
+        CHECK_LT(consumer, newIndexes.size());
+        consumer = newIndexes[consumer];
+    }
+    for (size_t i = 0; i + 1 < mOffsets.size(); i++) {
+        std::sort(mConsumers.begin() + mOffsets[i], mConsumers.begin() + mOffsets[i + 1]);
+    }
+}
+
 // A helper class to simplify state management when creating a Model.
 class ModelBuilder::ModelMaker {
    public:
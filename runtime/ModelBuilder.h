@@ -34,8 +34,53 @@ namespace nn {
 class CompilationBuilder;
 class Device;
 class ExecutionPlan;
+class PartitioningProfile;
 class RuntimeMemory;
 
+// For each operand of a model that an operation writes (a temporary or a
+// subgraph output), the indexes of the operations that read it, stored in
+// compressed sparse row form so that it can be built in linear time and takes
+// two allocations regardless of the size of the model. Other operands have no
+// readers listed. An operation that reads an operand more than once is listed
+// that many times. The operations of an operand are in increasing order.
+class OperandConsumers {
+   public:
+    // A range of operation indexes.
+    class Range {
+       public:
+        Range(const uint32_t* begin, const uint32_t* end) : mBegin(begin), mEnd(end) {}
+        const uint32_t* begin() const { return mBegin; }
+        const uint32_t* end() const { return mEnd; }
+        size_t size() const { return mEnd - mBegin; }
+        bool empty() const { return mBegin == mEnd; }
+
+       private:
+        const uint32_t* mBegin;
+        const uint32_t* mEnd;
+    };
+
+    OperandConsumers() = default;
+    // The inputs of "operations" must be less than the size of "operands".
+    OperandConsumers(const std::vector<Operand>& operands,
+                     const std::vector<Operation>& operations);
+
+    // Renumbers the operations after they have been reordered, so that
+    // operation i is now the one that was operation oldIndexes[i].
+    void renumber(const std::vector<uint32_t>& oldIndexes);
+
+    Range get(uint32_t operandIndex) const {
+        CHECK_LT(operandIndex + 1, mOffsets.size());
+        return Range(mConsumers.data() + mOffsets[operandIndex],
+                     mConsumers.data() + mOffsets[operandIndex + 1]);
+    }
+
+   private:
+    // The consumers of operand i are mConsumers[mOffsets[i]] through
+    // mConsumers[mOffsets[i + 1] - 1].
+    std::vector<uint32_t> mOffsets;
+    std::vector<uint32_t> mConsumers;
+};
+
 class ModelBuilder {
    public:
     ModelBuilder() {}
@@ -43,6 +88,11 @@ class ModelBuilder {
     int getExtensionType(const char* extensionName, uint16_t typeWithinExtension, int32_t* type);
     // Adds an operand to the model.
     int addOperand(const ANeuralNetworksOperandType& type);
+    // Adds "count" operands to the model, with consecutive indexes. Either all
+    // of them are added or none is.
+    int addOperands(uint32_t count, const ANeuralNetworksOperandType* types);
+    // Preallocates room for the given total numbers of operands and operations.
+    int reserve(uint32_t operandCount, uint32_t operationCount);
     int setOperandValue(uint32_t index, const void* buffer, size_t length);
     int setOperandValueFromMemory(uint32_t index, const RuntimeMemory* memory, uint32_t offset,
                                   size_t length);
@@ -56,6 +106,8 @@ class ModelBuilder {
     int identifyInputsAndOutputs(uint32_t inputCount, const uint32_t* inputs, uint32_t outputCount,
                                  const uint32_t* outputs);
     int relaxComputationFloat32toFloat16(bool allow);
+    int referenceSharedBufferValues(bool reference);
+    int shareLargeValues(bool share);
     bool isComputationFloat32RelaxedToFloat16() const { return mRelaxComputationFloat32toFloat16; }
 
     int finish();
@@ -111,6 +163,12 @@ class ModelBuilder {
     const std::vector<uint32_t>& getSortedOperationMapping() const {
         return mSortedOperationIndexMap;
     }
+    // Returns the indexes of the operations that read operand "index". Only
+    // valid after finish().
+    OperandConsumers::Range getOperandConsumers(uint32_t index) const {
+        CHECK(mCompletedModel);
+        return mOperandConsumers.get(index);
+    }
     const uint8_t* getPointerToOperandValue(uint32_t offset) const {
         return mSmallOperandValues.data() + offset;
     }
@@ -127,9 +185,11 @@ class ModelBuilder {
     }
 
     // simulateFailureResultCode == ANEURALNETWORKS_NO_ERROR means behave normally.
+    // useCostModel selects DeviceManager::kPartitioningCostModel.
     int partitionTheWork(const std::vector<std::shared_ptr<Device>>& devices, uint32_t preference,
                          uint32_t priority, const OptionalTimePoint& deadline, ExecutionPlan* plan,
-                         int simulateFailureResultCode = ANEURALNETWORKS_NO_ERROR) const;
+                         int simulateFailureResultCode = ANEURALNETWORKS_NO_ERROR,
+                         bool useCostModel = false) const;
 
    private:
     // TODO(b/132322449): move partitionTheWork, findBestDeviceForEachOperation,
@@ -146,12 +206,26 @@ class ModelBuilder {
     // (*bestDeviceForOperation)[i] == devices.size() is a special value meaning
     // that this is a control flow operation scheduled for interpreted execution
     // (see LogicalStep).
+    //
+    // If useCostModel is true, the devices are chosen to minimize the
+    // estimated cost of the whole model rather than of each operation.
+    //
+    // profile may be nullptr. Otherwise, the measurements in the profile take
+    // precedence over getPerformance().
     int findBestDeviceForEachOperation(uint32_t preference,
                                        const std::vector<std::shared_ptr<Device>>& devices,
+                                       bool useCostModel, const PartitioningProfile* profile,
                                        std::vector<int>* bestDeviceForOperation) const;
     float getPerformance(uint32_t preference, const std::shared_ptr<Device> device) const;
     float getPerformance(uint32_t preference, const std::shared_ptr<Device> device,
                          uint32_t operationIndex) const;
+    // Returns the measured performance of each operation on each device, in
+    // the units of getPerformance(), or an empty vector if the profile has no
+    // usable measurements. Element [i][d] is negative if operation i has not
+    // been measured on devices[d].
+    std::vector<std::vector<float>> getMeasuredPerformance(
+            uint32_t preference, const std::vector<std::shared_ptr<Device>>& devices,
+            const PartitioningProfile& profile) const;
     bool supportedByControlFlowInterpreter(uint32_t operationIndex) const;
 
     // Returns true if the operation is IF or WHILE and has an inner or outer
@@ -161,7 +235,8 @@ class ModelBuilder {
     int partitionTheWorkInternal(uint32_t sourceModelIndex,
                                  const std::vector<std::shared_ptr<Device>>& devices,
                                  uint32_t preference, uint32_t priority,
-                                 const OptionalTimePoint& deadline, ExecutionPlan* plan) const;
+                                 const OptionalTimePoint& deadline, bool useCostModel,
+                                 ExecutionPlan* plan) const;
 
     // Return true if either mCompleteModel or mInvalidModel is true.
     bool badState(const char* name);
@@ -175,8 +250,9 @@ class ModelBuilder {
     uint32_t getNumTrailingArgumentsToRemove(const Operation& operation) const;
 
     // Sorts the operations to be in the correct order for single threaded
-    // node-at-a-time execution.
-    bool sortIntoRunOrder();
+    // node-at-a-time execution. "operandConsumers" indexes the operations in
+    // their current order.
+    bool sortIntoRunOrder(const OperandConsumers& operandConsumers);
 
     // Copies the large values to a shared memory, if we have any.
     int copyLargeValuesToSharedMemory();
@@ -186,6 +262,8 @@ class ModelBuilder {
     // The mapping from sorted index to the original index of operations in mOperations.
     // mSortedOperationIndexMap is empty before sortIntoRunOrder() is called.
     std::vector<uint32_t> mSortedOperationIndexMap;
+    // The readers of each operand. Built by finish().
+    OperandConsumers mOperandConsumers;
     // Is at least one of those operations an OEM_OPERATION?
     bool mHasOEMOperation = false;
     // Is at least one of those operations an extension operation?
@@ -211,8 +289,16 @@ class ModelBuilder {
     };
     // Operand index and buffer pointer for all the large operand values of this model.
     std::vector<LargeValue> mLargeOperandValues;
-    // The shared memory region that will contain the large values.
-    std::unique_ptr<MemoryAshmem> mLargeValueMemory;
+    // The shared memory region that will contain the large values. It may be
+    // shared with other models (see LargeValuePoolCache).
+    std::shared_ptr<MemoryAshmem> mLargeValueMemory;
+    // Whether large values in buffers allocated with
+    // ANeuralNetworks_allocateSharedBuffer are referenced in place instead of
+    // being copied to mLargeValueMemory.
+    bool mReferenceSharedBufferValues = false;
+    // Whether mLargeValueMemory may be shared with other models whose large
+    // values are identical.
+    bool mShareLargeValues = false;
 
     // Once the model has been finished, we should not allow further
     // modifications to the model.
@@ -36,6 +36,7 @@
 
 #include "BurstBuilder.h"
 #include "CompilationBuilder.h"
+#include "CompletionQueue.h"
 #include "Event.h"
 #include "ExecutionBuilder.h"
 #include "ExecutionCallback.h"
@@ -834,6 +835,47 @@ int ANeuralNetworksExecution_compute(ANeuralNetworksExecution* execution) {
     return r->computeSynchronously();
 }
 
+int ANeuralNetworksExecution_computeBatch(ANeuralNetworksExecution* const* executions,
+                                          uint32_t count) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksExecution_computeBatch");
+    if (!executions && count != 0) {
+        LOG(ERROR) << "ANeuralNetworksExecution_computeBatch passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    std::vector<ExecutionBuilder*> r(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!executions[i]) {
+            LOG(ERROR) << "ANeuralNetworksExecution_computeBatch passed a nullptr";
+            return ANEURALNETWORKS_UNEXPECTED_NULL;
+        }
+        r[i] = reinterpret_cast<ExecutionBuilder*>(executions[i]);
+    }
+    return ExecutionBuilder::computeBatch(r);
+}
+
+int ANeuralNetworksExecution_cancel(ANeuralNetworksExecution* execution) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksExecution_cancel");
+    if (!execution) {
+        LOG(ERROR) << "ANeuralNetworksExecution_cancel passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ExecutionBuilder* r = reinterpret_cast<ExecutionBuilder*>(execution);
+    return r->cancel();
+}
+
+int ANeuralNetworksExecution_startComputeWithCompletionQueue(
+        ANeuralNetworksExecution* execution, ANeuralNetworksCompletionQueue* queue) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION,
+               "ANeuralNetworksExecution_startComputeWithCompletionQueue");
+    if (!execution || !queue) {
+        LOG(ERROR) << "ANeuralNetworksExecution_startComputeWithCompletionQueue passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ExecutionBuilder* r = reinterpret_cast<ExecutionBuilder*>(execution);
+    CompletionQueue* q = reinterpret_cast<CompletionQueue*>(queue);
+    return r->computeWithCompletionQueue(q);
+}
+
 int ANeuralNetworksExecution_setMeasureTiming(ANeuralNetworksExecution* execution, bool measure) {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksExecution_setMeasureTiming");
     if (!execution) {
@@ -888,6 +930,53 @@ void ANeuralNetworksBurst_free(ANeuralNetworksBurst* burst) {
     delete b;
 }
 
+int ANeuralNetworksCompletionQueue_create(ANeuralNetworksCompletionQueue** queue) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksCompletionQueue_create");
+    if (!queue) {
+        LOG(ERROR) << "ANeuralNetworksCompletionQueue_create passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    std::unique_ptr<CompletionQueue> q = CompletionQueue::create();
+    *queue = reinterpret_cast<ANeuralNetworksCompletionQueue*>(q.release());
+    return *queue ? ANEURALNETWORKS_NO_ERROR : ANEURALNETWORKS_OP_FAILED;
+}
+
+void ANeuralNetworksCompletionQueue_free(ANeuralNetworksCompletionQueue* queue) {
+    NNTRACE_RT(NNTRACE_PHASE_TERMINATION, "ANeuralNetworksCompletionQueue_free");
+    // Free of nullptr is valid.
+    CompletionQueue* q = reinterpret_cast<CompletionQueue*>(queue);
+    if (q && q->hasRunningComputations()) {
+        LOG(ERROR) << "ANeuralNetworksCompletionQueue_free passed a queue with running "
+                      "computations and is therefore ignored";
+        return;
+    }
+    delete q;
+}
+
+int ANeuralNetworksCompletionQueue_getFd(const ANeuralNetworksCompletionQueue* queue, int* fd) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksCompletionQueue_getFd");
+    if (!queue || !fd) {
+        LOG(ERROR) << "ANeuralNetworksCompletionQueue_getFd passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    const CompletionQueue* q = reinterpret_cast<const CompletionQueue*>(queue);
+    *fd = q->getFd();
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
+int ANeuralNetworksCompletionQueue_dequeue(ANeuralNetworksCompletionQueue* queue,
+                                           ANeuralNetworksExecution** executions,
+                                           int* resultCodes, uint32_t capacity, uint32_t* count) {
+    NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksCompletionQueue_dequeue");
+    if (!queue || !count || (capacity != 0 && (!executions || !resultCodes))) {
+        LOG(ERROR) << "ANeuralNetworksCompletionQueue_dequeue passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    CompletionQueue* q = reinterpret_cast<CompletionQueue*>(queue);
+    *count = q->dequeue(reinterpret_cast<ExecutionBuilder**>(executions), resultCodes, capacity);
+    return ANEURALNETWORKS_NO_ERROR;
+}
+
 int ANeuralNetworksExecution_burstCompute(ANeuralNetworksExecution* execution,
                                           ANeuralNetworksBurst* burst) {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksExecution_burstCompute");
@@ -1032,6 +1121,21 @@ int ANeuralNetworksMemory_createFromFd(size_t size, int prot, int fd, size_t off
     return ANEURALNETWORKS_NO_ERROR;
 }
 
+int ANeuralNetworks_allocateSharedBuffer(size_t size, void** buffer) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworks_allocateSharedBuffer");
+    if (buffer == nullptr) {
+        LOG(ERROR) << "ANeuralNetworks_allocateSharedBuffer passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    return SharedBufferRegistry::get().allocate(size, buffer);
+}
+
+void ANeuralNetworks_freeSharedBuffer(void* buffer) {
+    NNTRACE_RT(NNTRACE_PHASE_TERMINATION, "ANeuralNetworks_freeSharedBuffer");
+    // No validation.  Free of nullptr is valid.
+    SharedBufferRegistry::get().free(buffer);
+}
+
 int ANeuralNetworksMemory_createFromAHardwareBuffer(const AHardwareBuffer* ahwb,
                                                     ANeuralNetworksMemory** memory) {
     NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksMemory_createFromAHardwareBuffer");
@@ -1097,6 +1201,28 @@ int ANeuralNetworksModel_addOperand(ANeuralNetworksModel* model,
     return m->addOperand(*type);
 }
 
+int ANeuralNetworksModel_addOperands(ANeuralNetworksModel* model, uint32_t count,
+                                     const ANeuralNetworksOperandType* types) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksModel_addOperands");
+    if (!model || (!types && count != 0)) {
+        LOG(ERROR) << "ANeuralNetworksModel_addOperands passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ModelBuilder* m = reinterpret_cast<ModelBuilder*>(model);
+    return m->addOperands(count, types);
+}
+
+int ANeuralNetworksModel_reserve(ANeuralNetworksModel* model, uint32_t operandCount,
+                                 uint32_t operationCount) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksModel_reserve");
+    if (!model) {
+        LOG(ERROR) << "ANeuralNetworksModel_reserve passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ModelBuilder* m = reinterpret_cast<ModelBuilder*>(model);
+    return m->reserve(operandCount, operationCount);
+}
+
 int ANeuralNetworksModel_setOperandValue(ANeuralNetworksModel* model, int32_t index,
                                          const void* buffer, size_t length) {
     NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksModel_setOperandValue");
@@ -1181,6 +1307,26 @@ int ANeuralNetworksModel_relaxComputationFloat32toFloat16(ANeuralNetworksModel*
     return m->relaxComputationFloat32toFloat16(allow);
 }
 
+int ANeuralNetworksModel_referenceSharedBufferValues(ANeuralNetworksModel* model, bool reference) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksModel_referenceSharedBufferValues");
+    if (!model) {
+        LOG(ERROR) << "ANeuralNetworksModel_referenceSharedBufferValues passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ModelBuilder* m = reinterpret_cast<ModelBuilder*>(model);
+    return m->referenceSharedBufferValues(reference);
+}
+
+int ANeuralNetworksModel_shareLargeValues(ANeuralNetworksModel* model, bool share) {
+    NNTRACE_RT(NNTRACE_PHASE_PREPARATION, "ANeuralNetworksModel_shareLargeValues");
+    if (!model) {
+        LOG(ERROR) << "ANeuralNetworksModel_shareLargeValues passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    ModelBuilder* m = reinterpret_cast<ModelBuilder*>(model);
+    return m->shareLargeValues(share);
+}
+
 int ANeuralNetworksCompilation_create(ANeuralNetworksModel* model,
                                       ANeuralNetworksCompilation** compilation) {
     NNTRACE_RT(NNTRACE_PHASE_COMPILATION, "ANeuralNetworksCompilation_create");
@@ -1263,6 +1409,27 @@ int ANeuralNetworksCompilation_setTimeout(ANeuralNetworksCompilation* compilatio
     return c->setTimeoutDuration(duration);
 }
 
+int ANeuralNetworksCompilation_setPipelineDepth(ANeuralNetworksCompilation* compilation,
+                                                uint32_t depth) {
+    NNTRACE_RT(NNTRACE_PHASE_COMPILATION, "ANeuralNetworksCompilation_setPipelineDepth");
+    if (!compilation) {
+        LOG(ERROR) << "ANeuralNetworksCompilation_setPipelineDepth passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    CompilationBuilder* c = reinterpret_cast<CompilationBuilder*>(compilation);
+    return c->setPipelineDepth(depth);
+}
+
+int ANeuralNetworksCompilation_warm(const ANeuralNetworksCompilation* compilation) {
+    NNTRACE_RT(NNTRACE_PHASE_COMPILATION, "ANeuralNetworksCompilation_warm");
+    if (!compilation) {
+        LOG(ERROR) << "ANeuralNetworksCompilation_warm passed a nullptr";
+        return ANEURALNETWORKS_UNEXPECTED_NULL;
+    }
+    const CompilationBuilder* c = reinterpret_cast<const CompilationBuilder*>(compilation);
+    return c->warm();
+}
+
 int ANeuralNetworksExecution_create(ANeuralNetworksCompilation* compilation,
                                     ANeuralNetworksExecution** execution) {
     NNTRACE_RT(NNTRACE_PHASE_EXECUTION, "ANeuralNetworksExecution_create");
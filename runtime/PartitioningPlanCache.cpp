@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PartitioningPlanCache"
+
+#include "PartitioningPlanCache.h"
+
+#include <LegacyUtils.h>
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Manager.h"
+#include "PartitioningProfile.h"
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// The first line of a plan cache file. Change it whenever the format changes.
+constexpr char kHeader[] = "nnapi-partitioning-plan 1";
+
+}  // namespace
+
+std::unique_ptr<PartitioningPlanCache> PartitioningPlanCache::load(const std::string& cacheDir,
+                                                                   const uint8_t* token,
+                                                                   std::string key,
+                                                                   uint32_t maxOperationCount) {
+    CHECK(cacheDir.empty() || cacheDir.back() == '/');
+    // Can't use std::make_unique because the constructor is private.
+    // '3' identifies the partitioning profile (see PartitioningProfile).
+    std::unique_ptr<PartitioningPlanCache> cache(new PartitioningPlanCache(
+            getPartitioningCacheFileName(cacheDir, token, "PartitioningPlanCache", '4'),
+            std::move(key)));
+    std::string content;
+    if (cache->mFileName.empty() || !android::base::ReadFileToString(cache->mFileName, &content)) {
+        return cache;
+    }
+
+    std::istringstream lines(content);
+    std::string line;
+    if (!std::getline(lines, line) || line != kHeader) {
+        LOG(WARNING) << "Ignoring partitioning plan cache " << cache->mFileName
+                     << " with unknown format";
+        return cache;
+    }
+    if (!std::getline(lines, line) || line != cache->mKey) {
+        VLOG(COMPILATION) << "Ignoring partitioning plan cache " << cache->mFileName
+                          << " for other devices or settings";
+        return cache;
+    }
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        uint32_t sourceModelIndex = 0;
+        uint32_t operationCount = 0;
+        fields >> sourceModelIndex >> operationCount;
+        if (!fields.fail() && operationCount > maxOperationCount) {
+            // Don't trust the count with an allocation.
+            VLOG(COMPILATION) << "Ignoring the assignment of " << operationCount
+                              << " operations in partitioning plan cache " << cache->mFileName;
+            continue;
+        }
+        std::vector<int> assignment(operationCount);
+        for (int& deviceIndex : assignment) {
+            fields >> deviceIndex;
+        }
+        if (fields.fail() || cache->mAssignments.count(sourceModelIndex) != 0) {
+            LOG(WARNING) << "Ignoring corrupt partitioning plan cache " << cache->mFileName;
+            cache->mAssignments.clear();
+            return cache;
+        }
+        cache->mAssignments[sourceModelIndex] = std::move(assignment);
+    }
+    VLOG(COMPILATION) << "Loaded partitioning plan cache " << cache->mFileName << " with "
+                      << cache->mAssignments.size() << " models";
+    return cache;
+}
+
+std::string PartitioningPlanCache::makeKey(const std::vector<std::shared_ptr<Device>>& devices,
+                                           uint32_t preference, int32_t priority,
+                                           uint32_t partitioning) {
+    std::ostringstream key;
+    key << preference << " " << priority << " " << partitioning;
+    for (const auto& device : devices) {
+        key << " | " << PartitioningProfile::getDeviceKey(*device);
+    }
+    return key.str();
+}
+
+const std::vector<int>* PartitioningPlanCache::getAssignment(uint32_t sourceModelIndex) const {
+    const auto it = mAssignments.find(sourceModelIndex);
+    return it != mAssignments.end() ? &it->second : nullptr;
+}
+
+void PartitioningPlanCache::recordAssignment(uint32_t sourceModelIndex,
+                                             std::vector<int> assignment) {
+    mAssignments[sourceModelIndex] = std::move(assignment);
+    mHasNewAssignments = true;
+}
+
+bool PartitioningPlanCache::save() {
+    if (!mHasNewAssignments || mFileName.empty()) {
+        return true;
+    }
+    std::ostringstream content;
+    content << kHeader << "\n" << mKey << "\n";
+    for (const auto& [sourceModelIndex, assignment] : mAssignments) {
+        content << sourceModelIndex << " " << assignment.size();
+        for (int deviceIndex : assignment) {
+            content << " " << deviceIndex;
+        }
+        content << "\n";
+    }
+
+    if (!replacePartitioningCacheFile(mFileName, content.str())) {
+        LOG(ERROR) << "Failed to write partitioning plan cache " << mFileName;
+        return false;
+    }
+    mHasNewAssignments = false;
+    return true;
+}
+
+void PartitioningPlanCache::remove() {
+    mAssignments.clear();
+    mHasNewAssignments = false;
+    mUsedAssignment = false;
+    if (!mFileName.empty()) {
+        std::remove(mFileName.c_str());
+    }
+}
+
+}  // namespace nn
+}  // namespace android
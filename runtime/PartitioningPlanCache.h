@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PLAN_CACHE_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PLAN_CACHE_H
+
+#include <android-base/macros.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+class Device;
+
+// The device assignment of a partitioned compilation (see
+// ModelBuilder::findBestDeviceForEachOperation), stored next to the
+// compilation cache so that later compilations of the model don't have to
+// slice the model and ask every driver which operations it supports.
+//
+// Only the assignment is stored: the execution plan is rebuilt from it, which
+// is deterministic and cheap compared to querying the drivers. An assignment
+// is only valid for the devices, preference, priority, and partitioning mode
+// it was found for (see makeKey()).
+class PartitioningPlanCache {
+    DISALLOW_COPY_AND_ASSIGN(PartitioningPlanCache);
+
+   public:
+    // Loads the assignment of the compilations cached with "token" in
+    // "cacheDir", which must be empty or end with '/'. Returns an empty cache
+    // if there is no valid assignment for "key" yet. Assignments of more than
+    // "maxOperationCount" operations, the operation count of the largest
+    // source model, can't belong to the model and are ignored.
+    static std::unique_ptr<PartitioningPlanCache> load(const std::string& cacheDir,
+                                                       const uint8_t* token, std::string key,
+                                                       uint32_t maxOperationCount);
+
+    // Identifies the circumstances under which an assignment is valid.
+    static std::string makeKey(const std::vector<std::shared_ptr<Device>>& devices,
+                               uint32_t preference, int32_t priority, uint32_t partitioning);
+
+    // Returns the recorded assignment of the operations of the source model
+    // (see SourceModels), or nullptr if there is none. Each element is an
+    // index in the devices vector, or the number of devices for interpreted
+    // control flow.
+    const std::vector<int>* getAssignment(uint32_t sourceModelIndex) const;
+
+    void recordAssignment(uint32_t sourceModelIndex, std::vector<int> assignment);
+
+    // Notes that an assignment returned by getAssignment() was used to build
+    // the plan, so that a plan that fails to compile is retried without the
+    // cache (see usedAssignment()).
+    void noteAssignmentUsed() { mUsedAssignment = true; }
+
+    bool usedAssignment() const { return mUsedAssignment; }
+
+    // Writes the cache if it has new assignments. Returns false on failure.
+    bool save();
+
+    // Deletes the stored assignment, for example because it produced a plan
+    // that failed to compile.
+    void remove();
+
+   private:
+    PartitioningPlanCache(std::string fileName, std::string key)
+        : mFileName(std::move(fileName)), mKey(std::move(key)) {}
+
+    const std::string mFileName;
+    const std::string mKey;
+    std::map<uint32_t, std::vector<int>> mAssignments;
+    bool mHasNewAssignments = false;
+    bool mUsedAssignment = false;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PLAN_CACHE_H
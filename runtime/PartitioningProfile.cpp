@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PartitioningProfile"
+
+#include "PartitioningProfile.h"
+
+#include <LegacyUtils.h>
+#include <TokenHasher.h>
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Manager.h"
+
+namespace android {
+namespace nn {
+
+namespace {
+
+// The first line of a profile file. Change it whenever the format changes.
+constexpr char kHeader[] = "nnapi-partitioning-profile 1";
+
+// A profile is written in the background after this many executions, and
+// when it is destroyed.
+constexpr uint32_t kSaveInterval = 64;
+
+// Serializes the updates of profile files, so that two profiles of the same
+// compilations don't lose each other's measurements.
+std::mutex fileMutex;
+
+}  // namespace
+
+std::string getPartitioningCacheFileName(const std::string& cacheDir, const uint8_t* token,
+                                         const std::string& purpose, char suffix) {
+    TokenHasher hasher(token);
+    if (token == nullptr || !hasher.updateFromString(purpose.c_str()) || !hasher.finish()) {
+        return "";
+    }
+    const uint8_t* fileToken = hasher.getCacheToken();
+    std::string fileName(kByteSizeOfCacheToken * 2, '0');
+    for (uint32_t i = 0; i < kByteSizeOfCacheToken; i++) {
+        fileName[i * 2] = 'A' + (fileToken[i] & 0x0F);
+        fileName[i * 2 + 1] = 'A' + (fileToken[i] >> 4);
+    }
+    // '1' and '2' identify the model and data cache files of drivers.
+    return cacheDir + fileName + suffix;
+}
+
+bool replacePartitioningCacheFile(const std::string& fileName, const std::string& content) {
+    std::string tempFileName = fileName + ".XXXXXX";
+    const android::base::unique_fd fd(mkstemp(tempFileName.data()));
+    if (!fd.ok()) {
+        return false;
+    }
+    if (!android::base::WriteStringToFd(content, fd) ||
+        std::rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+        std::remove(tempFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<PartitioningProfile> PartitioningProfile::load(const std::string& cacheDir,
+                                                               const uint8_t* token,
+                                                               uint32_t operationCount) {
+    CHECK(cacheDir.empty() || cacheDir.back() == '/');
+    // Can't use std::make_shared because the constructor is private.
+    std::shared_ptr<PartitioningProfile> profile(new PartitioningProfile(
+            getPartitioningCacheFileName(cacheDir, token, "PartitioningProfile", '3'),
+            operationCount));
+    profile->mSteps = profile->read();
+    VLOG(COMPILATION) << "Loaded partitioning profile " << profile->mFileName << " with "
+                      << profile->mSteps.size() << " steps";
+    return profile;
+}
+
+PartitioningProfile::Steps PartitioningProfile::read() const {
+    std::string content;
+    if (mFileName.empty() || !android::base::ReadFileToString(mFileName, &content)) {
+        return {};
+    }
+
+    std::istringstream lines(content);
+    std::string line;
+    if (!std::getline(lines, line) || line != kHeader) {
+        LOG(WARNING) << "Ignoring partitioning profile " << mFileName << " with unknown format";
+        return {};
+    }
+    Steps steps;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        StepTiming timing;
+        uint32_t stepOperationCount = 0;
+        fields >> timing.count >> timing.totalDuration >> stepOperationCount;
+        // A step has at most every operation of the model, which bounds the allocation below.
+        if (fields.fail() || stepOperationCount > mOperationCount) {
+            LOG(WARNING) << "Ignoring corrupt partitioning profile " << mFileName;
+            return {};
+        }
+        std::vector<uint32_t> operations(stepOperationCount);
+        for (uint32_t& operation : operations) {
+            fields >> operation;
+        }
+        std::string deviceKey;
+        fields.get();  // The separator.
+        std::getline(fields, deviceKey);
+        if (fields.fail() || timing.count == 0 || deviceKey.empty() ||
+            !std::is_sorted(operations.begin(), operations.end()) ||
+            (!operations.empty() && operations.back() >= mOperationCount)) {
+            LOG(WARNING) << "Ignoring corrupt partitioning profile " << mFileName;
+            return {};
+        }
+        steps[{std::move(deviceKey), std::move(operations)}] = timing;
+    }
+    return steps;
+}
+
+PartitioningProfile::~PartitioningProfile() {
+    save();
+}
+
+std::string PartitioningProfile::getDeviceKey(const Device& device) {
+    std::string key = device.getName() + " " + device.getVersionString();
+    std::replace(key.begin(), key.end(), '\n', ' ');
+    return key;
+}
+
+void PartitioningProfile::record(const Device& device, std::vector<uint32_t> operations,
+                                 Duration duration) {
+    std::sort(operations.begin(), operations.end());
+    StepKey key(getDeviceKey(device), std::move(operations));
+    bool startSave = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (StepTiming* timing : {&mSteps[key], &mUnsavedSteps[key]}) {
+            timing->count++;
+            timing->totalDuration += duration.count();
+        }
+        if (++mUnsavedCount >= kSaveInterval && !mSaveInProgress) {
+            mSaveInProgress = true;
+            startSave = true;
+        }
+    }
+    if (startSave) {
+        // Write the profile on another thread so that the execution that
+        // recorded the step does not wait for the file system.
+        std::thread([weakProfile = weak_from_this()] {
+            if (const auto profile = weakProfile.lock()) {
+                profile->save();
+                std::lock_guard<std::mutex> lock(profile->mMutex);
+                profile->mSaveInProgress = false;
+            }
+        }).detach();
+    }
+}
+
+void PartitioningProfile::forEachStep(const StepCallback& callback) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const auto& [key, timing] : mSteps) {
+        callback(key.first, key.second, Duration(timing.totalDuration / timing.count));
+    }
+}
+
+bool PartitioningProfile::save() {
+    std::lock_guard<std::mutex> fileLock(fileMutex);
+    Steps unsavedSteps;
+    uint32_t unsavedCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mUnsavedCount == 0 || mFileName.empty()) {
+            return true;
+        }
+        unsavedSteps = std::move(mUnsavedSteps);
+        mUnsavedSteps.clear();
+        unsavedCount = mUnsavedCount;
+        mUnsavedCount = 0;
+    }
+
+    // Add the new measurements to the file as it is now, not as it was loaded.
+    Steps steps = read();
+    for (const auto& [key, timing] : unsavedSteps) {
+        StepTiming& savedTiming = steps[key];
+        savedTiming.count += timing.count;
+        savedTiming.totalDuration += timing.totalDuration;
+    }
+    std::ostringstream content;
+    content << kHeader << "\n";
+    for (const auto& [key, timing] : steps) {
+        content << timing.count << " " << timing.totalDuration << " " << key.second.size();
+        for (uint32_t operation : key.second) {
+            content << " " << operation;
+        }
+        content << " " << key.first << "\n";
+    }
+
+    const bool saved = replacePartitioningCacheFile(mFileName, content.str());
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!saved) {
+        LOG(ERROR) << "Failed to write partitioning profile " << mFileName;
+        for (const auto& [key, timing] : unsavedSteps) {
+            StepTiming& unsavedTiming = mUnsavedSteps[key];
+            unsavedTiming.count += timing.count;
+            unsavedTiming.totalDuration += timing.totalDuration;
+        }
+        mUnsavedCount += unsavedCount;
+        return false;
+    }
+    // Keep the measurements that were recorded while the file was written.
+    for (const auto& [key, timing] : mUnsavedSteps) {
+        StepTiming& savedTiming = steps[key];
+        savedTiming.count += timing.count;
+        savedTiming.totalDuration += timing.totalDuration;
+    }
+    mSteps = std::move(steps);
+    return true;
+}
+
+}  // namespace nn
+}  // namespace android
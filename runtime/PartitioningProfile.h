@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PROFILE_H
+#define ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PROFILE_H
+
+#include <android-base/macros.h>
+#include <nnapi/Types.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace nn {
+
+class Device;
+
+// Returns the name of the file in "cacheDir" that stores "purpose" for the
+// compilations cached with "token", or an empty string if there is no token.
+// Like the cache files of drivers (see DriverDevice), the file name encodes a
+// token that is derived from the compilation token, followed by "suffix".
+std::string getPartitioningCacheFileName(const std::string& cacheDir, const uint8_t* token,
+                                         const std::string& purpose, char suffix);
+
+// Replaces the file "fileName" with "content". The content is written to a
+// uniquely named temporary file in the same directory, which is then renamed,
+// so that readers never see a partial file and concurrent writers never write
+// the same temporary file. Returns false on failure.
+bool replacePartitioningCacheFile(const std::string& fileName, const std::string& content);
+
+// The measured execution times of the steps of a model, used for profile
+// guided partitioning (see DeviceManager::kPartitioningProfileGuided).
+//
+// A profile belongs to the compilations of a model that share a compilation
+// cache token. Executions of these compilations record how long each step of
+// the main model took on its device, and the profile is stored next to the
+// compilation cache so that later compilations of the model can be
+// partitioned based on these measurements.
+class PartitioningProfile : public std::enable_shared_from_this<PartitioningProfile> {
+    DISALLOW_COPY_AND_ASSIGN(PartitioningProfile);
+
+   public:
+    // Called for every recorded step with the key of its device (see
+    // getDeviceKey()), the sorted indexes of its operations in the main model,
+    // and its mean execution time.
+    using StepCallback = std::function<void(const std::string& deviceKey,
+                                            const std::vector<uint32_t>& operations,
+                                            Duration meanDuration)>;
+
+    // Loads the profile of the compilations cached with "token" in "cacheDir",
+    // which must be empty or end with '/'. "operationCount" is the number of
+    // operations of the main model. Returns an empty profile if there is no
+    // valid profile yet.
+    static std::shared_ptr<PartitioningProfile> load(const std::string& cacheDir,
+                                                     const uint8_t* token,
+                                                     uint32_t operationCount);
+
+    // Writes the profile back if it has new measurements.
+    ~PartitioningProfile();
+
+    // Identifies a device and driver version in the profile.
+    static std::string getDeviceKey(const Device& device);
+
+    // Records an execution of the main model "operations" on "device" that
+    // took "duration". Thread safe. Once enough new measurements have been
+    // recorded, the profile is written on a background thread.
+    void record(const Device& device, std::vector<uint32_t> operations, Duration duration);
+
+    void forEachStep(const StepCallback& callback) const;
+
+    // Writes the profile if it has new measurements. The new measurements are
+    // added to the profile in the file, which other compilations with the same
+    // token may have written since it was loaded, and the profile picks up
+    // their measurements. Returns false on failure. Thread safe.
+    bool save();
+
+   private:
+    PartitioningProfile(std::string fileName, uint32_t operationCount)
+        : mFileName(std::move(fileName)), mOperationCount(operationCount) {}
+
+    struct StepTiming {
+        uint64_t count = 0;
+        // In nanoseconds.
+        uint64_t totalDuration = 0;
+    };
+    using StepKey = std::pair<std::string, std::vector<uint32_t>>;
+    using Steps = std::map<StepKey, StepTiming>;
+
+    // Returns the steps of the profile file, or no steps if there is no valid
+    // profile.
+    Steps read() const;
+
+    const std::string mFileName;
+    // The number of operations of the main model.
+    const uint32_t mOperationCount;
+    mutable std::mutex mMutex;
+    Steps mSteps;
+    // The measurements recorded since the profile was last written, which are
+    // also included in mSteps.
+    Steps mUnsavedSteps;
+    // The number of executions recorded since the profile was last written.
+    uint32_t mUnsavedCount = 0;
+    // Whether a background thread has been started to write the profile.
+    bool mSaveInProgress = false;
+};
+
+}  // namespace nn
+}  // namespace android
+
+#endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_PARTITIONING_PROFILE_H
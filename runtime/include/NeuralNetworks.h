@@ -2231,6 +2231,369 @@ int ANeuralNetworksCompilation_getPreferredMemoryPaddingForOutput(
 int ANeuralNetworksExecution_setReusable(ANeuralNetworksExecution* execution, bool reusable)
         __NNAPI_INTRODUCED_IN(31);
 
+/**
+ * Sets the depth of the execution pipeline of a compilation.
+ *
+ * By default, each computation of an {@link ANeuralNetworksExecution} runs all the partitions of
+ * its compilation independently of the other computations. When the application streams
+ * back-to-back computations of the same compilation, for example one per video frame, a device
+ * may then be idle while another device runs its partition of the model.
+ *
+ * With a pipeline depth greater than 0, the computations of the compilation are pipelined: the
+ * computations are scheduled in the order in which they are started, each partition runs one
+ * computation at a time in that order, and the next computation may run a partition as soon as
+ * the previous computation is done with it. For example, a computation may run its first
+ * partition while the previous computation runs its second partition. At most "depth"
+ * computations are scheduled at the same time; starting another computation with
+ * {@link ANeuralNetworksExecution_compute}, {@link ANeuralNetworksExecution_burstCompute} or
+ * {@link ANeuralNetworksExecution_startCompute} blocks until one of them has completed.
+ * Computations started with {@link ANeuralNetworksExecution_startComputeWithDependencies} are
+ * not pipelined.
+ *
+ * Pipelining does not change the results of the computations. It has no effect if the
+ * compilation is not partitioned, or if its model has control flow or operands of unknown size
+ * between partitions.
+ *
+ * See {@link ANeuralNetworksCompilation} for information on multithreaded usage.
+ *
+ * @param compilation The compilation to be modified.
+ * @param depth The maximum number of pipelined computations, or 0 to disable pipelining.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if compilation is NULL.
+ *         ANEURALNETWORKS_BAD_STATE if the compilation has been finished.
+ */
+int ANeuralNetworksCompilation_setPipelineDepth(ANeuralNetworksCompilation* compilation,
+                                                uint32_t depth)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Starts reading the constant operand values of a compilation into memory.
+ *
+ * The values of a model set with {@link ANeuralNetworksModel_setOperandValueFromMemory} from a
+ * memory created with {@link ANeuralNetworksMemory_createFromFd} on a file are read from the file
+ * as they are first accessed, which may make the first computation of the compilation slow. This
+ * function asks the system to start reading the values of the model and of the models it
+ * references in the background, and returns without waiting for them. Calling this function is
+ * optional and does not change the results of the computations.
+ *
+ * See {@link ANeuralNetworksCompilation} for information on multithreaded usage.
+ *
+ * @param compilation The compilation whose values are to be read.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if compilation is NULL.
+ *         ANEURALNETWORKS_BAD_STATE if the compilation has not been finished or is invalid.
+ */
+int ANeuralNetworksCompilation_warm(const ANeuralNetworksCompilation* compilation)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Preallocates room in a model for the given total numbers of operands and operations.
+ *
+ * Building a model with many operands and operations is faster if the model knows their
+ * numbers in advance. Calling this function is optional and does not change the model: a
+ * model may still have more or fewer operands and operations than reserved.
+ *
+ * Attempting to modify a model once {@link ANeuralNetworksModel_finish} has been
+ * called will return an error.
+ *
+ * See {@link ANeuralNetworksModel} for information on multithreaded usage.
+ *
+ * @param model The model to be modified.
+ * @param operandCount The expected total number of operands of the model.
+ * @param operationCount The expected total number of operations of the model.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if model is NULL.
+ *         ANEURALNETWORKS_BAD_STATE if the model has been finished.
+ *         ANEURALNETWORKS_BAD_DATA if a count exceeds the maximum size of a model.
+ */
+int ANeuralNetworksModel_reserve(ANeuralNetworksModel* model, uint32_t operandCount,
+                                 uint32_t operationCount)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Specifies whether large constant values in shared buffers are referenced in place.
+ *
+ * By default, {@link ANeuralNetworksModel_finish} copies the values set with
+ * {@link ANeuralNetworksModel_setOperandValue} that are larger than
+ * {@link ANEURALNETWORKS_MAX_SIZE_OF_IMMEDIATELY_COPIED_VALUES} into shared memory, so that
+ * the application may free its buffers once the model is finished. While the model is being
+ * finished, the values thus take twice their size.
+ *
+ * If reference is true, such a value whose buffer lies within a buffer allocated with
+ * {@link ANeuralNetworks_allocateSharedBuffer} is not copied: the model references the shared
+ * buffer, as if the value had been set with {@link ANeuralNetworksModel_setOperandValueFromMemory}.
+ * The shared buffer must then not be modified or freed until the model and every compilation
+ * and execution created from it have been freed. Values in other buffers are still copied.
+ *
+ * The default is false. The setting applies to all values of the model, including those set
+ * before this function is called.
+ *
+ * Attempting to modify a model once {@link ANeuralNetworksModel_finish} has been
+ * called will return an error.
+ *
+ * See {@link ANeuralNetworksModel} for information on multithreaded usage.
+ *
+ * @param model The model to be modified.
+ * @param reference True if large values in shared buffers are referenced in place.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if model is NULL.
+ *         ANEURALNETWORKS_BAD_STATE if the model has been finished.
+ */
+int ANeuralNetworksModel_referenceSharedBufferValues(ANeuralNetworksModel* model, bool reference)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Specifies whether the shared memory of large constant values may be shared with other models.
+ *
+ * By default, {@link ANeuralNetworksModel_finish} copies the values set with
+ * {@link ANeuralNetworksModel_setOperandValue} that are larger than
+ * {@link ANEURALNETWORKS_MAX_SIZE_OF_IMMEDIATELY_COPIED_VALUES} into shared memory of the model's
+ * own. If share is true and another live model of the process that also allows sharing has
+ * exactly the same such values, at the same places, the two models use the same shared memory,
+ * so that the values are resident only once. This helps processes that build several variants of
+ * a model with the same weights, at the cost of a hash of the values when the model is finished.
+ * The results of the model are the same either way.
+ *
+ * The default is false. The setting applies to all values of the model, including those set
+ * before this function is called. Values that are referenced in place (see
+ * {@link ANeuralNetworksModel_referenceSharedBufferValues}) are not copied and not shared.
+ *
+ * Attempting to modify a model once {@link ANeuralNetworksModel_finish} has been
+ * called will return an error.
+ *
+ * See {@link ANeuralNetworksModel} for information on multithreaded usage.
+ *
+ * @param model The model to be modified.
+ * @param share True if the large values may be shared with other models.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if model is NULL.
+ *         ANEURALNETWORKS_BAD_STATE if the model has been finished.
+ */
+int ANeuralNetworksModel_shareLargeValues(ANeuralNetworksModel* model, bool share)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Adds several operands to a model.
+ *
+ * This is equivalent to calling {@link ANeuralNetworksModel_addOperand} for each element of
+ * types in order, except that either all operands are added or none is. The operands are
+ * given consecutive indexes, starting with the number of operands the model had before the
+ * call.
+ *
+ * Attempting to modify a model once {@link ANeuralNetworksModel_finish} has been
+ * called will return an error.
+ *
+ * See {@link ANeuralNetworksModel} for information on multithreaded usage.
+ *
+ * @param model The model to be modified.
+ * @param count The number of operands to add.
+ * @param types An array of count {@link ANeuralNetworksOperandType}s that describe the
+ *              operands. Neither the array nor the dimensions it points to need to outlive
+ *              the call to {@link ANeuralNetworksModel_addOperands}.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if model is NULL, or if types is NULL and count is
+ *         not 0.
+ *         ANEURALNETWORKS_BAD_DATA if the model would have too many operands, or if one of the
+ *         types is invalid.
+ *         ANEURALNETWORKS_BAD_STATE if the model has been finished or is invalid.
+ */
+int ANeuralNetworksModel_addOperands(ANeuralNetworksModel* model, uint32_t count,
+                                     const ANeuralNetworksOperandType* types)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Schedules synchronous evaluation of several executions of the same compilation.
+ *
+ * This is equivalent to calling {@link ANeuralNetworksExecution_compute} for each element of
+ * executions in order, except that the executions are checked together before any of them is
+ * computed, and that they are computed back to back on the calling thread, reusing the
+ * resources of the previous computation where the devices support it (see
+ * {@link ANeuralNetworksBurst}). It is useful to serve many small independent requests for the
+ * same compilation.
+ *
+ * If an execution cannot be computed, for example because not all of its inputs and outputs
+ * have been specified, this function fails without computing any of the executions. Otherwise
+ * every execution is computed, even if an earlier one fails, and each execution reports its
+ * own outcome, for example through {@link ANeuralNetworksExecution_getOutputOperandDimensions}.
+ *
+ * See {@link ANeuralNetworksExecution} for information on execution states and multithreaded
+ * usage.
+ *
+ * @param executions An array of count distinct executions created from the same compilation.
+ * @param count The number of executions.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if every execution completed normally. Otherwise, the result
+ *         code that {@link ANeuralNetworksExecution_compute} would return for the first
+ *         execution that failed, or:
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if executions or one of its elements is NULL.
+ *         ANEURALNETWORKS_BAD_DATA if the executions are not distinct, or were created from
+ *         different compilations.
+ *         ANEURALNETWORKS_BAD_STATE if one of the executions is in flight, or has completed and
+ *         is not reusable (see {@link ANeuralNetworksExecution_setReusable}).
+ */
+int ANeuralNetworksExecution_computeBatch(ANeuralNetworksExecution* const* executions,
+                                          uint32_t count)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Cancels the computation of an execution that is in flight.
+ *
+ * This is useful when the results of a computation are no longer needed, for example because a
+ * newer camera frame has arrived. Drivers ignore cancellation: a partition that a driver has
+ * already started runs to completion, and only the partitions that have not started yet are
+ * skipped. Operations run by the runtime on the CPU stop before the next operation or iteration
+ * of a WHILE loop. A cancelled computation does not fall back to the CPU.
+ *
+ * The computation then completes as usual, with ANEURALNETWORKS_OP_FAILED unless it was done
+ * before it could be stopped, and the contents of the outputs are unspecified. The caller must
+ * still wait for the computation to complete, for example with
+ * {@link ANeuralNetworksEvent_wait}, before it frees or reuses the execution.
+ *
+ * {@link ANeuralNetworksExecution_startComputeWithDependencies} starts all the partitions of its
+ * computation before it returns, so such a computation can only be cancelled while that call is
+ * in progress. If the execution is not in flight, this function has no effect, and a later
+ * computation of a reusable execution is not cancelled.
+ *
+ * Unlike other functions that take an execution, this function may be called from another
+ * thread while the execution is being computed.
+ *
+ * @param execution The execution to be cancelled.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if execution is NULL.
+ */
+int ANeuralNetworksExecution_cancel(ANeuralNetworksExecution* execution)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Create a {@link ANeuralNetworksCompletionQueue}.
+ *
+ * @param queue The newly created object or NULL if unsuccessful.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if queue is NULL.
+ *         ANEURALNETWORKS_OP_FAILED if the file descriptor of the queue could not be created.
+ */
+int ANeuralNetworksCompletionQueue_create(ANeuralNetworksCompletionQueue** queue)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Destroys the completion queue.
+ *
+ * The queue must not be destroyed while computations started with it have not completed; the
+ * call is then ignored. Executions that have completed but have not been dequeued are simply
+ * dropped from the queue.
+ *
+ * @param queue The completion queue to be destroyed. Passing NULL is acceptable and results
+ *              in no operation.
+ */
+void ANeuralNetworksCompletionQueue_free(ANeuralNetworksCompletionQueue* queue)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Gets a file descriptor that is readable exactly when the completion queue is not empty.
+ *
+ * The file descriptor is owned by the queue and stays valid until the queue is destroyed. The
+ * application may wait for it with poll(), epoll or similar, but must not read from it, write to
+ * it or close it.
+ *
+ * @param queue The completion queue.
+ * @param fd The file descriptor.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if queue or fd is NULL.
+ */
+int ANeuralNetworksCompletionQueue_getFd(const ANeuralNetworksCompletionQueue* queue, int* fd)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Takes executions whose computations have completed from the completion queue, in the order
+ * in which they completed. Doesn't block.
+ *
+ * A dequeued execution has completed as if its computation had been waited for with
+ * {@link ANeuralNetworksEvent_wait}: its outputs, output dimensions and duration are available,
+ * and it may be freed or, if it is reusable, computed again.
+ *
+ * @param queue The completion queue.
+ * @param executions An array of at least capacity elements that receives the executions.
+ * @param resultCodes An array of at least capacity elements that receives, for each execution,
+ *                    the result code {@link ANeuralNetworksEvent_wait} would have returned.
+ * @param capacity The maximum number of executions to take.
+ * @param count The number of executions taken, which is 0 if the queue is empty.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if queue, count, executions or resultCodes is NULL.
+ */
+int ANeuralNetworksCompletionQueue_dequeue(ANeuralNetworksCompletionQueue* queue,
+                                           ANeuralNetworksExecution** executions,
+                                           int* resultCodes, uint32_t capacity, uint32_t* count)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Schedules asynchronous evaluation of the execution, and posts the execution to a completion
+ * queue when the evaluation completes.
+ *
+ * This is equivalent to {@link ANeuralNetworksExecution_startCompute}, except that no
+ * {@link ANeuralNetworksEvent} is created: the application learns that the evaluation has
+ * completed from {@link ANeuralNetworksCompletionQueue_dequeue}. The execution must not be
+ * freed before it has been dequeued.
+ *
+ * See {@link ANeuralNetworksExecution} for information on execution states and multithreaded
+ * usage.
+ *
+ * @param execution The execution to be scheduled and executed.
+ * @param queue The completion queue the execution is posted to. It must not be destroyed until
+ *              the execution has completed.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if the evaluation is successfully scheduled.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if execution or queue is NULL.
+ */
+int ANeuralNetworksExecution_startComputeWithCompletionQueue(
+        ANeuralNetworksExecution* execution, ANeuralNetworksCompletionQueue* queue)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Allocates a buffer in shared memory for execution inputs and outputs.
+ *
+ * Inputs and outputs specified with {@link ANeuralNetworksExecution_setInput} and
+ * {@link ANeuralNetworksExecution_setOutput} in ordinary application memory are copied into and
+ * out of shared memory on each execution, because drivers may run in a different process. If the
+ * buffer given to those functions lies within a buffer returned by this function, the runtime
+ * passes the shared memory to the drivers and no copy is made, as if the argument had been
+ * specified with {@link ANeuralNetworksExecution_setInputFromMemory} or
+ * {@link ANeuralNetworksExecution_setOutputFromMemory}.
+ *
+ * The buffer is aligned to the page size, which satisfies the alignment returned by
+ * {@link ANeuralNetworksCompilation_getPreferredMemoryAlignmentForInput} and
+ * {@link ANeuralNetworksCompilation_getPreferredMemoryAlignmentForOutput}.
+ *
+ * @param size The size of the buffer in bytes. It must be greater than 0 and less than 2^32.
+ * @param buffer The allocated buffer.
+ *
+ * @return ANEURALNETWORKS_NO_ERROR if successful.
+ *         ANEURALNETWORKS_UNEXPECTED_NULL if buffer is NULL.
+ *         ANEURALNETWORKS_BAD_DATA if size is invalid.
+ *         ANEURALNETWORKS_OUT_OF_MEMORY if the buffer can't be allocated.
+ */
+int ANeuralNetworks_allocateSharedBuffer(size_t size, void** buffer)
+        __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
+/**
+ * Frees a buffer allocated with {@link ANeuralNetworks_allocateSharedBuffer}.
+ *
+ * The buffer must not be freed while an execution that uses it is being computed, and must not
+ * be used by an execution that is computed after it has been freed.
+ *
+ * @param buffer The buffer to free. Freeing NULL has no effect.
+ */
+void ANeuralNetworks_freeSharedBuffer(void* buffer) __NNAPI_INTRODUCED_IN(__ANDROID_API_FUTURE__);
+
 __END_DECLS
 
 #endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_NEURAL_NETWORKS_H
@@ -6210,6 +6210,27 @@ typedef struct ANeuralNetworksSymmPerChannelQuantParams {
  */
 typedef struct ANeuralNetworksBurst ANeuralNetworksBurst;
 
+/**
+ * ANeuralNetworksCompletionQueue is an opaque type that collects the executions whose
+ * asynchronous computations have completed, so that a single thread can wait for many
+ * computations at once.
+ *
+ * <p>To use:<ul>
+ *    <li>Create a new completion queue by calling the
+ *        {@link ANeuralNetworksCompletionQueue_create} function.</li>
+ *    <li>Start computations with
+ *        {@link ANeuralNetworksExecution_startComputeWithCompletionQueue}.</li>
+ *    <li>Wait for the file descriptor returned by
+ *        {@link ANeuralNetworksCompletionQueue_getFd} to become readable, for example with
+ *        poll(), and take the completed executions with
+ *        {@link ANeuralNetworksCompletionQueue_dequeue}.</li>
+ *    <li>Destroy the completion queue with
+ *        {@link ANeuralNetworksCompletionQueue_free}.</li></ul></p>
+ *
+ * <p>A completion queue can be used by several threads at the same time.</p>
+ */
+typedef struct ANeuralNetworksCompletionQueue ANeuralNetworksCompletionQueue;
+
 /**
  * ANeuralNetworksOperandType describes the type of an operand.
  *
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestNeuralNetworksWrapper.h"
+
+// Benchmarks for the per-computation overhead of the runtime, measured on a
+// model that does almost no work: a single ADD of two small tensors.
+
+namespace android {
+namespace nn {
+namespace {
+
+using namespace test_wrapper;
+
+constexpr uint32_t kElementCount = 4;
+
+class ExecutionOverhead : public benchmark::Fixture {
+   public:
+    void SetUp(const benchmark::State& /*state*/) override {
+        const OperandType tensorType(Type::TENSOR_FLOAT32, {kElementCount});
+        const OperandType activationType(Type::INT32, {});
+        const uint32_t input0 = mModel.addOperand(&tensorType);
+        const uint32_t input1 = mModel.addOperand(&tensorType);
+        const uint32_t activation = mModel.addConstantOperand(&activationType, int32_t{0});
+        const uint32_t output = mModel.addOperand(&tensorType);
+        mModel.addOperation(ANEURALNETWORKS_ADD, {input0, input1, activation}, {output});
+        mModel.identifyInputsAndOutputs({input0, input1}, {output});
+        CHECK(mModel.finish() == Result::NO_ERROR);
+        mCompilation = std::make_unique<Compilation>(&mModel);
+        CHECK(mCompilation->finish() == Result::NO_ERROR);
+    }
+
+    void TearDown(const benchmark::State& /*state*/) override { mCompilation.reset(); }
+
+   protected:
+    void setArguments(Execution* execution) {
+        CHECK(execution->setInput(0, mInput0.data(), sizeof(float) * kElementCount) ==
+              Result::NO_ERROR);
+        CHECK(execution->setInput(1, mInput1.data(), sizeof(float) * kElementCount) ==
+              Result::NO_ERROR);
+        CHECK(execution->setOutput(0, mOutput.data(), sizeof(float) * kElementCount) ==
+              Result::NO_ERROR);
+    }
+
+    Model mModel;
+    std::unique_ptr<Compilation> mCompilation;
+    std::vector<float> mInput0 = std::vector<float>(kElementCount, 1.0f);
+    std::vector<float> mInput1 = std::vector<float>(kElementCount, 2.0f);
+    std::vector<float> mOutput = std::vector<float>(kElementCount);
+};
+
+// A new execution for every computation, as before reusable executions.
+BENCHMARK_DEFINE_F(ExecutionOverhead, OneShot)(benchmark::State& state) {
+    for (auto _ : state) {
+        Execution execution(mCompilation.get());
+        setArguments(&execution);
+        CHECK(execution.compute(Execution::ComputeMode::SYNC) == Result::NO_ERROR);
+    }
+}
+
+// One reusable execution for all computations.
+BENCHMARK_DEFINE_F(ExecutionOverhead, Reusable)(benchmark::State& state) {
+    Execution execution(mCompilation.get());
+    CHECK(execution.setReusable(true) == Result::NO_ERROR);
+    setArguments(&execution);
+    for (auto _ : state) {
+        CHECK(execution.compute(Execution::ComputeMode::SYNC) == Result::NO_ERROR);
+    }
+}
+
+BENCHMARK_REGISTER_F(ExecutionOverhead, OneShot);
+BENCHMARK_REGISTER_F(ExecutionOverhead, Reusable);
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "TestNeuralNetworksWrapper.h"
+
+// Benchmarks for building and finishing models of 1K to 128K operations. The
+// complexity reported for each benchmark shows how its time grows with the
+// number of operations.
+
+namespace android {
+namespace nn {
+namespace {
+
+using namespace test_wrapper;
+
+// Builds a model in which ADD operation i reads the outputs of operations
+// i - 1 and i - 2. The operations are added in reverse order so that
+// ANeuralNetworksModel_finish has to sort them into run order.
+void buildLadder(Model* model, uint32_t operationCount) {
+    const OperandType tensorType(Type::TENSOR_FLOAT32, {1});
+    const OperandType activationType(Type::INT32, {});
+
+    // Operands 0 and 1 are the inputs, 2 is the activation, and 3 + i is the
+    // output of operation i.
+    CHECK(model->reserve(operationCount + 3, operationCount) == Result::NO_ERROR);
+    const uint32_t input0 = model->addOperand(&tensorType);
+    const uint32_t input1 = model->addOperand(&tensorType);
+    const uint32_t activation = model->addConstantOperand(&activationType, int32_t{0});
+    for (uint32_t i = 0; i < operationCount; i++) {
+        model->addOperand(&tensorType);
+    }
+    const auto output = [](uint32_t i) { return 3 + i; };
+    for (uint32_t i = operationCount; i-- > 0;) {
+        const uint32_t first = i >= 1 ? output(i - 1) : input0;
+        const uint32_t second = i >= 2 ? output(i - 2) : input1;
+        model->addOperation(ANEURALNETWORKS_ADD, {first, second, activation}, {output(i)});
+    }
+    model->identifyInputsAndOutputs({input0, input1}, {output(operationCount - 1)});
+}
+
+void BM_ModelConstruction(benchmark::State& state) {
+    const uint32_t operationCount = state.range(0);
+    for (auto _ : state) {
+        Model model;
+        buildLadder(&model, operationCount);
+        CHECK(model.isValid());
+    }
+    state.SetComplexityN(operationCount);
+}
+
+void BM_ModelFinish(benchmark::State& state) {
+    const uint32_t operationCount = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto model = std::make_unique<Model>();
+        buildLadder(model.get(), operationCount);
+        state.ResumeTiming();
+        CHECK(model->finish() == Result::NO_ERROR);
+        // Don't time the destruction of the model.
+        state.PauseTiming();
+        model.reset();
+        state.ResumeTiming();
+    }
+    state.SetComplexityN(operationCount);
+}
+
+BENCHMARK(BM_ModelConstruction)->RangeMultiplier(4)->Range(1 << 10, 1 << 17)->Complexity();
+BENCHMARK(BM_ModelFinish)->RangeMultiplier(4)->Range(1 << 10, 1 << 17)->Complexity();
+
+}  // namespace
+}  // namespace nn
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -20,7 +20,13 @@
 #include <android-base/logging.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
 #include "TestNeuralNetworksWrapper.h"
+#include "TestUtils.h"
 
 namespace android::nn {
 namespace {
@@ -37,55 +43,56 @@ constexpr int32_t kNoActivation = ANEURALNETWORKS_FUSED_NONE;
 
 class ControlFlowTest : public ::testing::Test {};
 
-TEST_F(ControlFlowTest, InfiniteLoop) {
-    // Expected result: execution aborted after the specified timeout.
-    // Model: given n <= 1.0, never returns.
-    //
-    // i = 1.0
-    // while i >= n:
-    //     i = i + 1.0
-
+// Model: given n <= 1.0, never returns.
+//
+// i = 1.0
+// while i >= n:
+//     i = i + 1.0
+void makeInfiniteLoopModel(Model* conditionModel, Model* bodyModel, Model* model) {
     OperandType boolType(Type::TENSOR_BOOL8, {1});
     OperandType activationType(Type::INT32, {});
     OperandType counterType(Type::TENSOR_FLOAT32, {1});
 
-    Model conditionModel;
     {
-        uint32_t i = conditionModel.addOperand(&counterType);
-        uint32_t n = conditionModel.addOperand(&counterType);
-        uint32_t out = conditionModel.addOperand(&boolType);
-        conditionModel.addOperation(ANEURALNETWORKS_GREATER_EQUAL, {i, n}, {out});
-        conditionModel.identifyInputsAndOutputs({i, n}, {out});
-        ASSERT_EQ(conditionModel.finish(), Result::NO_ERROR);
-        ASSERT_TRUE(conditionModel.isValid());
+        uint32_t i = conditionModel->addOperand(&counterType);
+        uint32_t n = conditionModel->addOperand(&counterType);
+        uint32_t out = conditionModel->addOperand(&boolType);
+        conditionModel->addOperation(ANEURALNETWORKS_GREATER_EQUAL, {i, n}, {out});
+        conditionModel->identifyInputsAndOutputs({i, n}, {out});
+        ASSERT_EQ(conditionModel->finish(), Result::NO_ERROR);
+        ASSERT_TRUE(conditionModel->isValid());
     }
 
-    Model bodyModel;
     {
-        uint32_t i = bodyModel.addOperand(&counterType);
-        uint32_t n = bodyModel.addOperand(&counterType);
-        uint32_t one = bodyModel.addConstantOperand(&counterType, 1.0f);
-        uint32_t noActivation = bodyModel.addConstantOperand(&activationType, kNoActivation);
-        uint32_t iOut = bodyModel.addOperand(&counterType);
-        bodyModel.addOperation(ANEURALNETWORKS_ADD, {i, one, noActivation}, {iOut});
-        bodyModel.identifyInputsAndOutputs({i, n}, {iOut});
-        ASSERT_EQ(bodyModel.finish(), Result::NO_ERROR);
-        ASSERT_TRUE(bodyModel.isValid());
+        uint32_t i = bodyModel->addOperand(&counterType);
+        uint32_t n = bodyModel->addOperand(&counterType);
+        uint32_t one = bodyModel->addConstantOperand(&counterType, 1.0f);
+        uint32_t noActivation = bodyModel->addConstantOperand(&activationType, kNoActivation);
+        uint32_t iOut = bodyModel->addOperand(&counterType);
+        bodyModel->addOperation(ANEURALNETWORKS_ADD, {i, one, noActivation}, {iOut});
+        bodyModel->identifyInputsAndOutputs({i, n}, {iOut});
+        ASSERT_EQ(bodyModel->finish(), Result::NO_ERROR);
+        ASSERT_TRUE(bodyModel->isValid());
     }
 
-    Model model;
     {
-        uint32_t iInit = model.addConstantOperand(&counterType, 1.0f);
-        uint32_t n = model.addOperand(&counterType);
-        uint32_t conditionOperand = model.addModelOperand(&conditionModel);
-        uint32_t bodyOperand = model.addModelOperand(&bodyModel);
-        uint32_t iOut = model.addOperand(&counterType);
-        model.addOperation(ANEURALNETWORKS_WHILE, {conditionOperand, bodyOperand, iInit, n},
-                           {iOut});
-        model.identifyInputsAndOutputs({n}, {iOut});
-        ASSERT_EQ(model.finish(), Result::NO_ERROR);
-        ASSERT_TRUE(model.isValid());
+        uint32_t iInit = model->addConstantOperand(&counterType, 1.0f);
+        uint32_t n = model->addOperand(&counterType);
+        uint32_t conditionOperand = model->addModelOperand(conditionModel);
+        uint32_t bodyOperand = model->addModelOperand(bodyModel);
+        uint32_t iOut = model->addOperand(&counterType);
+        model->addOperation(ANEURALNETWORKS_WHILE, {conditionOperand, bodyOperand, iInit, n},
+                            {iOut});
+        model->identifyInputsAndOutputs({n}, {iOut});
+        ASSERT_EQ(model->finish(), Result::NO_ERROR);
+        ASSERT_TRUE(model->isValid());
     }
+}
+
+TEST_F(ControlFlowTest, InfiniteLoop) {
+    // Expected result: execution aborted after the specified timeout.
+    Model conditionModel, bodyModel, model;
+    ASSERT_NO_FATAL_FAILURE(makeInfiniteLoopModel(&conditionModel, &bodyModel, &model));
 
     Compilation compilation(&model);
     ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
@@ -102,6 +109,44 @@ TEST_F(ControlFlowTest, InfiniteLoop) {
             << "result = " << static_cast<int>(result);
 }
 
+TEST_F(ControlFlowTest, CancelInfiniteLoop) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        // Expected result: execution aborted when it is cancelled, long before
+        // the loop timeout. Only the CPU is known to stop a loop that is
+        // cancelled.
+        Model conditionModel, bodyModel, model;
+        ASSERT_NO_FATAL_FAILURE(makeInfiniteLoopModel(&conditionModel, &bodyModel, &model));
+
+        const ANeuralNetworksDevice* cpuDevice = getCpuDevice();
+        if (cpuDevice == nullptr) {
+            GTEST_SKIP();
+        }
+        auto [n, compilation] = Compilation::createForDevice(&model, cpuDevice);
+        ASSERT_EQ(n, Result::NO_ERROR);
+        ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+        float input = 0;
+        float output;
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, &input), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, &output), Result::NO_ERROR);
+        ASSERT_EQ(execution.setLoopTimeout(operation_while::kTimeoutNsMaximum), Result::NO_ERROR);
+        std::atomic<bool> done = false;
+        std::thread canceller([&execution, &done] {
+            // Cancelling has no effect until the computation has started.
+            while (!done) {
+                EXPECT_EQ(execution.cancel(), Result::NO_ERROR);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        EXPECT_EQ(execution.compute(Execution::ComputeMode::SYNC), Result::OP_FAILED);
+        done = true;
+        canceller.join();
+    } else {
+        GTEST_SKIP();
+    }
+}
+
 TEST_F(ControlFlowTest, GetLoopTimeouts) {
     uint64_t defaultTimeout = ANeuralNetworks_getDefaultLoopTimeout();
     uint64_t maximumTimeout = ANeuralNetworks_getMaximumLoopTimeout();
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "Manager.h"
+#include "NeuralNetworks.h"
+#include "TestNeuralNetworksWrapper.h"
+#include "TestUtils.h"
+
+// Tests of the hybrid execution of float operations with large constant weights on the CPU
+// device, see DeviceManager::setCpuHybridWeightsTolerance.
+
+namespace {
+
+using namespace android::nn::test_wrapper;
+using DeviceManager = android::nn::DeviceManager;
+
+// The relative error of the quantized weights that the tests allow.
+constexpr float kTolerance = 0.01f;
+
+// Returns weights that are not exactly representable in int8, so that the hybrid results differ
+// from the float results.
+std::vector<float> makeWeights(uint32_t numRows, uint32_t numColumns) {
+    std::vector<float> weights(numRows * numColumns);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = std::sin(0.37f * i + 0.11f);
+    }
+    return weights;
+}
+
+// Returns ||actual - expected|| / ||expected|| in the L2 norm.
+float relativeError(const std::vector<float>& actual, const std::vector<float>& expected) {
+    double squaredError = 0.0;
+    double squaredNorm = 0.0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const double error = static_cast<double>(actual[i]) - expected[i];
+        squaredError += error * error;
+        squaredNorm += static_cast<double>(expected[i]) * expected[i];
+    }
+    return static_cast<float>(std::sqrt(squaredError / squaredNorm));
+}
+
+class CpuHybridWeightsTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        mCpuDevice = android::nn::getCpuDevice();
+        if (mCpuDevice == nullptr) {
+            GTEST_SKIP();
+        }
+        mOldTolerance = DeviceManager::get()->getCpuHybridWeightsTolerance();
+    }
+
+    void TearDown() override {
+        if (mCpuDevice != nullptr) {
+            DeviceManager::get()->setCpuHybridWeightsTolerance(mOldTolerance);
+        }
+    }
+
+    // Compiles "model" for the CPU device with the hybrid weights tolerance "tolerance" and
+    // computes it twice, so that the second computation uses the cached weights. Model input i
+    // is set from inputs[i], and the last output is returned in "output".
+    void compute(const Model& model, float tolerance, const std::vector<std::vector<float>>& inputs,
+                 const std::vector<uint32_t>& outputSizes, std::vector<float>* output) {
+        // The tolerance is read when the CPU device prepares the model.
+        DeviceManager::get()->setCpuHybridWeightsTolerance(tolerance);
+        auto [result, compilation] = Compilation::createForDevice(&model, mCpuDevice);
+        ASSERT_EQ(result, Result::NO_ERROR);
+        ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+        std::vector<std::vector<float>> outputs;
+        for (int computation = 0; computation < 2; ++computation) {
+            std::vector<std::vector<float>> currentOutputs;
+            for (uint32_t size : outputSizes) {
+                currentOutputs.emplace_back(size, 0.0f);
+            }
+            Execution execution(&compilation);
+            for (uint32_t i = 0; i < inputs.size(); ++i) {
+                ASSERT_EQ(execution.setInput(i, inputs[i].data(), inputs[i].size() * sizeof(float)),
+                          Result::NO_ERROR);
+            }
+            for (uint32_t i = 0; i < currentOutputs.size(); ++i) {
+                ASSERT_EQ(execution.setOutput(i, currentOutputs[i].data(),
+                                              currentOutputs[i].size() * sizeof(float)),
+                          Result::NO_ERROR);
+            }
+            ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+            if (computation > 0) {
+                // The cached weights must give the same results as the ones just derived.
+                ASSERT_EQ(currentOutputs, outputs);
+            }
+            outputs = std::move(currentOutputs);
+        }
+        *output = outputs.back();
+    }
+
+    // Checks that the hybrid result is close to, but not the same as, the float result.
+    void checkHybrid(const Model& model, const std::vector<std::vector<float>>& inputs,
+                     const std::vector<uint32_t>& outputSizes) {
+        std::vector<float> expected;
+        ASSERT_NO_FATAL_FAILURE(compute(model, 0.0f, inputs, outputSizes, &expected));
+        std::vector<float> actual;
+        ASSERT_NO_FATAL_FAILURE(compute(model, kTolerance, inputs, outputSizes, &actual));
+        EXPECT_NE(actual, expected) << "The weights were not quantized";
+        // The error of a dot product is bounded by the error of the weights times the norm of
+        // the input, which this allows for with some margin.
+        EXPECT_LE(relativeError(actual, expected), 4 * kTolerance);
+    }
+
+    ANeuralNetworksDevice* mCpuDevice = nullptr;
+    float mOldTolerance = 0.0f;
+};
+
+TEST_F(CpuHybridWeightsTest, FullyConnected) {
+    constexpr uint32_t kBatches = 2;
+    constexpr uint32_t kInputSize = 128;
+    constexpr uint32_t kNumUnits = 64;
+    const std::vector<float> weights = makeWeights(kNumUnits, kInputSize);
+    const std::vector<float> bias(kNumUnits, 0.25f);
+
+    OperandType inputType(Type::TENSOR_FLOAT32, {kBatches, kInputSize});
+    OperandType weightsType(Type::TENSOR_FLOAT32, {kNumUnits, kInputSize});
+    OperandType biasType(Type::TENSOR_FLOAT32, {kNumUnits});
+    OperandType outputType(Type::TENSOR_FLOAT32, {kBatches, kNumUnits});
+    OperandType activationType(Type::INT32, {});
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t weightsOperand = model.addOperand(&weightsType);
+    model.setOperandValue(weightsOperand, weights.data(), weights.size() * sizeof(float));
+    const uint32_t biasOperand = model.addOperand(&biasType);
+    model.setOperandValue(biasOperand, bias.data(), bias.size() * sizeof(float));
+    const uint32_t activation =
+            model.addConstantOperand(&activationType, ANEURALNETWORKS_FUSED_NONE);
+    const uint32_t output = model.addOperand(&outputType);
+    model.addOperation(ANEURALNETWORKS_FULLY_CONNECTED,
+                       {input, weightsOperand, biasOperand, activation}, {output});
+    model.identifyInputsAndOutputs({input}, {output});
+    ASSERT_TRUE(model.isValid());
+    ASSERT_EQ(model.finish(), Result::NO_ERROR);
+
+    std::vector<float> in(kBatches * kInputSize);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = std::cos(0.13f * i);
+    }
+    checkHybrid(model, {in}, {kBatches * kNumUnits});
+}
+
+TEST_F(CpuHybridWeightsTest, Svdf) {
+    constexpr uint32_t kBatches = 2;
+    constexpr uint32_t kInputSize = 128;
+    constexpr uint32_t kNumUnits = 16;
+    constexpr int32_t kRank = 2;
+    constexpr uint32_t kNumFilters = kNumUnits * kRank;
+    constexpr uint32_t kMemorySize = 4;
+    const std::vector<float> weightsFeature = makeWeights(kNumFilters, kInputSize);
+    std::vector<float> weightsTime(kNumFilters * kMemorySize);
+    for (size_t i = 0; i < weightsTime.size(); ++i) {
+        weightsTime[i] = 0.5f + 0.1f * (i % 5);
+    }
+    const std::vector<float> bias(kNumUnits, 0.25f);
+
+    OperandType inputType(Type::TENSOR_FLOAT32, {kBatches, kInputSize});
+    OperandType weightsFeatureType(Type::TENSOR_FLOAT32, {kNumFilters, kInputSize});
+    OperandType weightsTimeType(Type::TENSOR_FLOAT32, {kNumFilters, kMemorySize});
+    OperandType biasType(Type::TENSOR_FLOAT32, {kNumUnits});
+    OperandType stateType(Type::TENSOR_FLOAT32, {kBatches, kMemorySize * kNumFilters});
+    OperandType outputType(Type::TENSOR_FLOAT32, {kBatches, kNumUnits});
+    OperandType scalarType(Type::INT32, {});
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t weightsFeatureOperand = model.addOperand(&weightsFeatureType);
+    model.setOperandValue(weightsFeatureOperand, weightsFeature.data(),
+                          weightsFeature.size() * sizeof(float));
+    const uint32_t weightsTimeOperand = model.addOperand(&weightsTimeType);
+    model.setOperandValue(weightsTimeOperand, weightsTime.data(),
+                          weightsTime.size() * sizeof(float));
+    const uint32_t biasOperand = model.addOperand(&biasType);
+    model.setOperandValue(biasOperand, bias.data(), bias.size() * sizeof(float));
+    const uint32_t stateIn = model.addOperand(&stateType);
+    const uint32_t rank = model.addConstantOperand(&scalarType, kRank);
+    const uint32_t activation = model.addConstantOperand(&scalarType, ANEURALNETWORKS_FUSED_NONE);
+    const uint32_t stateOut = model.addOperand(&stateType);
+    const uint32_t output = model.addOperand(&outputType);
+    model.addOperation(ANEURALNETWORKS_SVDF,
+                       {input, weightsFeatureOperand, weightsTimeOperand, biasOperand, stateIn,
+                        rank, activation},
+                       {stateOut, output});
+    model.identifyInputsAndOutputs({input, stateIn}, {stateOut, output});
+    ASSERT_TRUE(model.isValid());
+    ASSERT_EQ(model.finish(), Result::NO_ERROR);
+
+    std::vector<float> in(kBatches * kInputSize);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = std::cos(0.13f * i);
+    }
+    std::vector<float> state(kBatches * kMemorySize * kNumFilters);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = 0.01f * (i % 7);
+    }
+    checkHybrid(model, {in, state}, {kBatches * kMemorySize * kNumFilters, kBatches * kNumUnits});
+}
+
+}  // namespace
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "TestNeuralNetworksWrapper.h"
+#include "TestUtils.h"
+
+// Tests of operations that keep data in the operation cache of a CPU prepared model. Every
+// model is compiled for the CPU device and computed several times with the same compilation,
+// so that later computations use the data cached by the first one.
+
+namespace {
+
+using namespace android::nn::test_wrapper;
+using android::nn::getCpuDevice;
+
+uint8_t quantize(float value, float scale, int32_t zeroPoint) {
+    const int32_t quantized = zeroPoint + static_cast<int32_t>(std::round(value / scale));
+    return static_cast<uint8_t>(std::clamp(quantized, 0, 255));
+}
+
+float dequantize(uint8_t value, float scale, int32_t zeroPoint) {
+    return scale * (static_cast<int32_t>(value) - zeroPoint);
+}
+
+class CpuOperationCacheTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        mCpuDevice = getCpuDevice();
+        if (mCpuDevice == nullptr) {
+            GTEST_SKIP();
+        }
+    }
+
+    ANeuralNetworksDevice* mCpuDevice = nullptr;
+};
+
+TEST_F(CpuOperationCacheTest, QuantizedLogistic) {
+    constexpr float kInputScale = 1.0f / 16.0f;
+    constexpr int32_t kInputZeroPoint = 128;
+    // LOGISTIC requires this output quantization.
+    constexpr float kOutputScale = 1.0f / 256.0f;
+    constexpr int32_t kOutputZeroPoint = 0;
+
+    // The input covers every quantized value, so the whole table is checked.
+    OperandType inputType(Type::TENSOR_QUANT8_ASYMM, {1, 256}, kInputScale, kInputZeroPoint);
+    OperandType outputType(Type::TENSOR_QUANT8_ASYMM, {1, 256}, kOutputScale, kOutputZeroPoint);
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t output = model.addOperand(&outputType);
+    model.addOperation(ANEURALNETWORKS_LOGISTIC, {input}, {output});
+    model.identifyInputsAndOutputs({input}, {output});
+    ASSERT_TRUE(model.isValid());
+    ASSERT_EQ(model.finish(), Result::NO_ERROR);
+
+    auto [result, compilation] = Compilation::createForDevice(&model, mCpuDevice);
+    ASSERT_EQ(result, Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+    std::vector<uint8_t> inputData(256);
+    for (size_t i = 0; i < inputData.size(); ++i) {
+        inputData[i] = static_cast<uint8_t>(i);
+    }
+    // Reverse the input on the second computation, so that the cached table is not only
+    // read in the order in which it was built.
+    for (bool reversed : {false, true, false}) {
+        std::vector<uint8_t> in = inputData;
+        if (reversed) {
+            std::reverse(in.begin(), in.end());
+        }
+        std::vector<uint8_t> out(in.size(), 0);
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, in.data(), in.size()), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, out.data(), out.size()), Result::NO_ERROR);
+        ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+        for (size_t i = 0; i < in.size(); ++i) {
+            const float x = dequantize(in[i], kInputScale, kInputZeroPoint);
+            const uint8_t expected =
+                    quantize(1.0f / (1.0f + std::exp(-x)), kOutputScale, kOutputZeroPoint);
+            EXPECT_LE(std::abs(out[i] - expected), 1) << "input " << static_cast<int>(in[i]);
+        }
+    }
+}
+
+TEST_F(CpuOperationCacheTest, QuantizedSoftmaxWithBetaInput) {
+    constexpr float kInputScale = 1.0f / 32.0f;
+    constexpr int32_t kInputZeroPoint = 128;
+    // SOFTMAX requires this output quantization.
+    constexpr float kOutputScale = 1.0f / 256.0f;
+    constexpr int32_t kOutputZeroPoint = 0;
+    constexpr uint32_t kBatches = 2;
+    constexpr uint32_t kDepth = 16;
+
+    OperandType inputType(Type::TENSOR_QUANT8_ASYMM, {kBatches, kDepth}, kInputScale,
+                          kInputZeroPoint);
+    OperandType outputType(Type::TENSOR_QUANT8_ASYMM, {kBatches, kDepth}, kOutputScale,
+                           kOutputZeroPoint);
+    OperandType betaType(Type::FLOAT32, {});
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t beta = model.addOperand(&betaType);
+    const uint32_t output = model.addOperand(&outputType);
+    model.addOperation(ANEURALNETWORKS_SOFTMAX, {input, beta}, {output});
+    model.identifyInputsAndOutputs({input, beta}, {output});
+    ASSERT_TRUE(model.isValid());
+    ASSERT_EQ(model.finish(), Result::NO_ERROR);
+
+    auto [result, compilation] = Compilation::createForDevice(&model, mCpuDevice);
+    ASSERT_EQ(result, Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+    std::vector<uint8_t> in(kBatches * kDepth);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = static_cast<uint8_t>((i * 37) % 256);
+    }
+    // The cached exp() table depends on beta, so it must follow a beta that changes between
+    // computations.
+    for (float betaValue : {1.0f, 0.5f, 0.5f, 1.0f}) {
+        std::vector<uint8_t> out(in.size(), 0);
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, in.data(), in.size()), Result::NO_ERROR);
+        ASSERT_EQ(execution.setInput(1, &betaValue), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, out.data(), out.size()), Result::NO_ERROR);
+        ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+        for (uint32_t b = 0; b < kBatches; ++b) {
+            const uint8_t* row = in.data() + b * kDepth;
+            const uint8_t maxValue = *std::max_element(row, row + kDepth);
+            float sum = 0.0f;
+            for (uint32_t d = 0; d < kDepth; ++d) {
+                sum += std::exp(betaValue * kInputScale * (row[d] - maxValue));
+            }
+            for (uint32_t d = 0; d < kDepth; ++d) {
+                const float expected =
+                        std::exp(betaValue * kInputScale * (row[d] - maxValue)) / sum;
+                EXPECT_LE(std::abs(out[b * kDepth + d] -
+                                   quantize(expected, kOutputScale, kOutputZeroPoint)),
+                          1)
+                        << "beta " << betaValue << " batch " << b << " element " << d;
+            }
+        }
+    }
+}
+
+TEST_F(CpuOperationCacheTest, SparseFullyConnected) {
+    constexpr uint32_t kBatches = 3;
+    constexpr uint32_t kInputSize = 128;
+    constexpr uint32_t kNumUnits = 64;
+
+    // Keep one 4-column block in eight, so that the weights are stored in sparse form.
+    std::vector<float> weights(kNumUnits * kInputSize, 0.0f);
+    for (uint32_t unit = 0; unit < kNumUnits; ++unit) {
+        for (uint32_t block = unit % 8; block < kInputSize / 4; block += 8) {
+            for (uint32_t j = 0; j < 4; ++j) {
+                weights[unit * kInputSize + block * 4 + j] =
+                        static_cast<float>((unit + block + j) % 7) - 3.0f;
+            }
+        }
+    }
+    std::vector<float> bias(kNumUnits);
+    for (uint32_t unit = 0; unit < kNumUnits; ++unit) {
+        bias[unit] = 0.5f * unit;
+    }
+
+    OperandType inputType(Type::TENSOR_FLOAT32, {kBatches, kInputSize});
+    OperandType weightsType(Type::TENSOR_FLOAT32, {kNumUnits, kInputSize});
+    OperandType biasType(Type::TENSOR_FLOAT32, {kNumUnits});
+    OperandType outputType(Type::TENSOR_FLOAT32, {kBatches, kNumUnits});
+    OperandType activationType(Type::INT32, {});
+    Model model;
+    const uint32_t input = model.addOperand(&inputType);
+    const uint32_t weightsOperand = model.addOperand(&weightsType);
+    model.setOperandValue(weightsOperand, weights.data(), weights.size() * sizeof(float));
+    const uint32_t biasOperand = model.addOperand(&biasType);
+    model.setOperandValue(biasOperand, bias.data(), bias.size() * sizeof(float));
+    const uint32_t activation =
+            model.addConstantOperand(&activationType, ANEURALNETWORKS_FUSED_NONE);
+    const uint32_t output = model.addOperand(&outputType);
+    model.addOperation(ANEURALNETWORKS_FULLY_CONNECTED,
+                       {input, weightsOperand, biasOperand, activation}, {output});
+    model.identifyInputsAndOutputs({input}, {output});
+    ASSERT_TRUE(model.isValid());
+    ASSERT_EQ(model.finish(), Result::NO_ERROR);
+
+    auto [result, compilation] = Compilation::createForDevice(&model, mCpuDevice);
+    ASSERT_EQ(result, Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+
+    for (uint32_t computation = 0; computation < 3; ++computation) {
+        std::vector<float> in(kBatches * kInputSize);
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = static_cast<float>((i * 5 + computation) % 11) * 0.25f - 1.0f;
+        }
+        std::vector<float> out(kBatches * kNumUnits, 0.0f);
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, in.data(), in.size() * sizeof(float)), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, out.data(), out.size() * sizeof(float)),
+                  Result::NO_ERROR);
+        ASSERT_EQ(execution.compute(), Result::NO_ERROR);
+        for (uint32_t b = 0; b < kBatches; ++b) {
+            for (uint32_t unit = 0; unit < kNumUnits; ++unit) {
+                float expected = bias[unit];
+                for (uint32_t i = 0; i < kInputSize; ++i) {
+                    expected += in[b * kInputSize + i] * weights[unit * kInputSize + i];
+                }
+                EXPECT_NEAR(out[b * kNumUnits + unit], expected, 1e-4f)
+                        << "computation " << computation << " batch " << b << " unit " << unit;
+            }
+        }
+    }
+}
+
+}  // namespace
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+
+#include "ExecutionPipeline.h"
+
+namespace android::nn {
+namespace {
+
+using Ticket = ExecutionPipeline::Ticket;
+
+// How long to wait before concluding that a call blocks.
+constexpr auto kBlockingTimeout = std::chrono::milliseconds(50);
+
+template <typename T>
+bool isBlocked(const std::future<T>& future) {
+    return future.wait_for(kBlockingTimeout) == std::future_status::timeout;
+}
+
+TEST(ExecutionPipelineTest, StagesRunInAdmissionOrder) {
+    ExecutionPipeline pipeline(/*depth=*/2, /*stageCount=*/2);
+    const Ticket first = pipeline.enter();
+    const Ticket second = pipeline.enter();
+
+    pipeline.waitForStage(first, 0);
+    auto secondStage0 =
+            std::async(std::launch::async, [&pipeline, second] { pipeline.waitForStage(second, 0); });
+    EXPECT_TRUE(isBlocked(secondStage0));
+
+    // The second execution runs stage 0 while the first one runs stage 1.
+    pipeline.finishStage(first, 0);
+    secondStage0.get();
+    pipeline.waitForStage(first, 1);
+
+    auto secondStage1 =
+            std::async(std::launch::async, [&pipeline, second] { pipeline.waitForStage(second, 1); });
+    pipeline.finishStage(second, 0);
+    EXPECT_TRUE(isBlocked(secondStage1));
+    pipeline.finishStage(first, 1);
+    secondStage1.get();
+    pipeline.finishStage(second, 1);
+
+    pipeline.leave(first);
+    pipeline.leave(second);
+}
+
+TEST(ExecutionPipelineTest, LeavingSkipsUnfinishedStages) {
+    ExecutionPipeline pipeline(/*depth=*/2, /*stageCount=*/2);
+    const Ticket first = pipeline.enter();
+    const Ticket second = pipeline.enter();
+
+    // The first execution fails in stage 0.
+    pipeline.waitForStage(first, 0);
+    pipeline.leave(first);
+
+    pipeline.waitForStage(second, 0);
+    pipeline.finishStage(second, 0);
+    pipeline.waitForStage(second, 1);
+    pipeline.finishStage(second, 1);
+    pipeline.leave(second);
+}
+
+TEST(ExecutionPipelineTest, FinishingStagesOutOfOrder) {
+    ExecutionPipeline pipeline(/*depth=*/3, /*stageCount=*/1);
+    const Ticket first = pipeline.enter();
+    const Ticket second = pipeline.enter();
+    const Ticket third = pipeline.enter();
+
+    // The second execution leaves before the first one runs the stage.
+    pipeline.leave(second);
+    auto thirdStage0 =
+            std::async(std::launch::async, [&pipeline, third] { pipeline.waitForStage(third, 0); });
+    EXPECT_TRUE(isBlocked(thirdStage0));
+    pipeline.waitForStage(first, 0);
+    pipeline.finishStage(first, 0);
+    thirdStage0.get();
+
+    pipeline.leave(first);
+    pipeline.leave(third);
+}
+
+TEST(ExecutionPipelineTest, DepthBoundsAdmittedExecutions) {
+    ExecutionPipeline pipeline(/*depth=*/1, /*stageCount=*/1);
+    const Ticket first = pipeline.enter();
+    auto second = std::async(std::launch::async, [&pipeline] { return pipeline.enter(); });
+    EXPECT_TRUE(isBlocked(second));
+    pipeline.leave(first);
+    const Ticket secondTicket = second.get();
+    EXPECT_GT(secondTicket, first);
+    pipeline.leave(secondTicket);
+}
+
+}  // namespace
+}  // namespace android::nn
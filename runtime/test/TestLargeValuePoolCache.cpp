@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "LargeValuePoolCache.h"
+#include "Manager.h"
+#include "TestNeuralNetworksWrapper.h"
+
+namespace android::nn {
+namespace {
+
+using Value = LargeValuePoolCache::Value;
+
+TEST(LargeValuePoolCacheTest, SharesPoolsWithSameContents) {
+    LargeValuePoolCache cache;
+    const std::vector<uint8_t> a(100, 1), b(100, 2);
+    const std::vector<Value> values = {{.buffer = a.data(), .offset = 0, .length = 100},
+                                       {.buffer = b.data(), .offset = 128, .length = 100}};
+
+    auto [n, pool] = cache.getPool(228, values);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(pool->getPointer()[0], 1);
+    EXPECT_EQ(pool->getPointer()[128], 2);
+
+    // Equal values in other buffers.
+    const std::vector<uint8_t> aCopy = a, bCopy = b;
+    auto [n2, pool2] = cache.getPool(228, {{.buffer = aCopy.data(), .offset = 0, .length = 100},
+                                           {.buffer = bCopy.data(), .offset = 128, .length = 100}});
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(pool2, pool);
+
+    // The same values in another order.
+    auto [n3, pool3] = cache.getPool(228, {{.buffer = b.data(), .offset = 0, .length = 100},
+                                           {.buffer = a.data(), .offset = 128, .length = 100}});
+    ASSERT_EQ(n3, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_NE(pool3, pool);
+
+    const LargeValuePoolCache::Stats stats = cache.getStats();
+    EXPECT_EQ(stats.allocations, 2u);
+    EXPECT_EQ(stats.shares, 1u);
+    EXPECT_EQ(stats.sharedBytes, 228u);
+}
+
+TEST(LargeValuePoolCacheTest, FreesPoolWithLastUser) {
+    LargeValuePoolCache cache;
+    const std::vector<uint8_t> a(200, 3), b(200, 4);
+    const std::vector<Value> values = {{.buffer = a.data(), .offset = 0, .length = 200}};
+    {
+        auto [n, pool] = cache.getPool(200, values);
+        ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    }
+    auto [n, pool] = cache.getPool(200, values);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(cache.getStats().allocations, 2u);
+    EXPECT_EQ(cache.getStats().shares, 0u);
+    EXPECT_EQ(cache.getStats().pools, 1u);
+
+    // The freed pool of other values is forgotten when a pool is allocated.
+    pool.reset();
+    auto [n2, pool2] = cache.getPool(200, {{.buffer = b.data(), .offset = 0, .length = 200}});
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(cache.getStats().allocations, 3u);
+    EXPECT_EQ(cache.getStats().pools, 1u);
+}
+
+// The parameter is whether the models opt in with ANeuralNetworksModel_shareLargeValues.
+class LargeValuePoolSharingTest : public ::testing::TestWithParam<bool> {
+   protected:
+    void SetUp() override {
+        // Don't share the pools of models that have not opted in.
+        mShareLargeValuePools = DeviceManager::get()->shareLargeValuePools();
+        DeviceManager::get()->setShareLargeValuePools(false);
+    }
+
+    void TearDown() override {
+        DeviceManager::get()->setShareLargeValuePools(mShareLargeValuePools);
+    }
+
+    bool mShareLargeValuePools = false;
+};
+
+TEST_P(LargeValuePoolSharingTest, ModelsWithSameWeights) {
+    using namespace test_wrapper;
+    const std::vector<float> weights(64, 0.5f);
+    static_assert(sizeof(float) * 64 > ANEURALNETWORKS_MAX_SIZE_OF_IMMEDIATELY_COPIED_VALUES);
+    const auto makeModel = [&weights](Model* model, bool share) {
+        ASSERT_EQ(ANeuralNetworksModel_shareLargeValues(model->getHandle(), share),
+                  ANEURALNETWORKS_NO_ERROR);
+        const OperandType tensorType(Type::TENSOR_FLOAT32, {64});
+        const OperandType activationType(Type::INT32, {});
+        const uint32_t input = model->addOperand(&tensorType);
+        const uint32_t value = model->addOperand(&tensorType);
+        model->setOperandValue(value, weights.data(), weights.size() * sizeof(float));
+        const uint32_t activation = model->addConstantOperand(&activationType, int32_t{0});
+        const uint32_t output = model->addOperand(&tensorType);
+        model->addOperation(ANEURALNETWORKS_ADD, {input, value, activation}, {output});
+        model->identifyInputsAndOutputs({input}, {output});
+        ASSERT_EQ(model->finish(), Result::NO_ERROR);
+    };
+
+    const LargeValuePoolCache::Stats before = LargeValuePoolCache::get().getStats();
+    Model first, second;
+    ASSERT_NO_FATAL_FAILURE(makeModel(&first, GetParam()));
+    ASSERT_NO_FATAL_FAILURE(makeModel(&second, GetParam()));
+    const LargeValuePoolCache::Stats after = LargeValuePoolCache::get().getStats();
+    if (GetParam()) {
+        EXPECT_EQ(after.allocations, before.allocations + 1);
+        EXPECT_EQ(after.shares, before.shares + 1);
+        EXPECT_EQ(after.sharedBytes, before.sharedBytes + weights.size() * sizeof(float));
+
+        // A model that has not opted in does not share the pool of the others.
+        Model third;
+        ASSERT_NO_FATAL_FAILURE(makeModel(&third, false));
+        EXPECT_EQ(LargeValuePoolCache::get().getStats().shares, after.shares);
+    } else {
+        // Each model has a pool of its own that the cache does not know of.
+        EXPECT_EQ(after.allocations, before.allocations);
+        EXPECT_EQ(after.shares, before.shares);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Sharing, LargeValuePoolSharingTest, ::testing::Bool());
+
+}  // namespace
+}  // namespace android::nn
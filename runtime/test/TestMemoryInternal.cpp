@@ -26,6 +26,7 @@
 
 #include "Manager.h"
 #include "Memory.h"
+#include "MemoryRecycler.h"
 #include "TestMemory.h"
 #include "TestNeuralNetworksWrapper.h"
 
@@ -70,6 +71,8 @@ void MemoryLeakTest::SetUp() {
 
 void MemoryLeakTest::TearDown() {
     android::nn::DeviceManager::get()->setUseCpuOnly(mIsCpuOnly);
+    // The recycler keeps the memories of finished executions for later ones.
+    android::nn::MemoryRecycler::get().clear();
     const size_t endingMapCount = GetAshmemMappingsCount();
     ASSERT_EQ(mStartingMapCount, endingMapCount);
 }
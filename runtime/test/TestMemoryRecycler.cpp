@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <utility>
+
+#include "MemoryRecycler.h"
+
+namespace android::nn {
+namespace {
+
+constexpr size_t kMaxPooledBytes = 1024 * 1024;
+constexpr auto kLongIdleTimeout = std::chrono::hours(1);
+
+TEST(MemoryRecyclerTest, SizeClasses) {
+    const uint32_t pageSize = getpagesize();
+    EXPECT_EQ(MemoryRecycler::getSizeClass(1), pageSize);
+    EXPECT_EQ(MemoryRecycler::getSizeClass(pageSize), pageSize);
+    EXPECT_EQ(MemoryRecycler::getSizeClass(pageSize + 1), 2 * pageSize);
+    EXPECT_EQ(MemoryRecycler::getSizeClass(3 * pageSize), 4 * pageSize);
+    EXPECT_EQ(MemoryRecycler::getSizeClass(1u << 31), 1u << 31);
+    EXPECT_EQ(MemoryRecycler::getSizeClass((1u << 31) + 1), (1u << 31) + 1);
+}
+
+TEST(MemoryRecyclerTest, ReusesMemoryOfSameSizeClass) {
+    MemoryRecycler recycler(kMaxPooledBytes, kLongIdleTimeout);
+    auto [n, memory] = recycler.allocateAshmem(100);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    ASSERT_NE(memory, nullptr);
+    EXPECT_EQ(memory->getSize(), MemoryRecycler::getSizeClass(100));
+    const MemoryAshmem* first = memory.get();
+    recycler.recycle(std::move(memory));
+    EXPECT_EQ(recycler.getPooledBytes(), MemoryRecycler::getSizeClass(100));
+
+    auto [n2, memory2] = recycler.allocateAshmem(200);
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(memory2.get(), first);
+    EXPECT_EQ(recycler.getPooledBytes(), 0u);
+
+    // A larger size class needs a new memory.
+    auto [n3, memory3] = recycler.allocateAshmem(kMaxPooledBytes / 2);
+    ASSERT_EQ(n3, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_NE(memory3.get(), first);
+
+    const MemoryRecycler::Stats stats = recycler.getStats();
+    EXPECT_EQ(stats.allocations, 2u);
+    EXPECT_EQ(stats.reuses, 1u);
+}
+
+TEST(MemoryRecyclerTest, KeepsAtMostMaxPooledBytes) {
+    MemoryRecycler recycler(kMaxPooledBytes, kLongIdleTimeout);
+    auto [n, memory] = recycler.allocateAshmem(kMaxPooledBytes);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    auto [n2, memory2] = recycler.allocateAshmem(1);
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    recycler.recycle(std::move(memory));
+    EXPECT_EQ(recycler.getPooledBytes(), kMaxPooledBytes);
+    // There is no room left for this memory.
+    recycler.recycle(std::move(memory2));
+    EXPECT_EQ(recycler.getPooledBytes(), kMaxPooledBytes);
+}
+
+TEST(MemoryRecyclerTest, DropsIdleMemories) {
+    MemoryRecycler recycler(kMaxPooledBytes, std::chrono::milliseconds(1));
+    auto [n, memory] = recycler.allocateAshmem(1);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    recycler.recycle(std::move(memory));
+    EXPECT_GT(recycler.getPooledBytes(), 0u);
+    usleep(10 * 1000);
+    auto [n2, memory2] = recycler.allocateAshmem(1);
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(recycler.getPooledBytes(), 0u);
+    EXPECT_EQ(recycler.getStats().reuses, 0u);
+}
+
+TEST(MemoryRecyclerTest, Clear) {
+    MemoryRecycler recycler(kMaxPooledBytes, kLongIdleTimeout);
+    auto [n, memory] = recycler.allocateAshmem(1);
+    ASSERT_EQ(n, ANEURALNETWORKS_NO_ERROR);
+    recycler.recycle(std::move(memory));
+    recycler.clear();
+    EXPECT_EQ(recycler.getPooledBytes(), 0u);
+    auto [n2, memory2] = recycler.allocateAshmem(1);
+    ASSERT_EQ(n2, ANEURALNETWORKS_NO_ERROR);
+    EXPECT_EQ(recycler.getStats().reuses, 0u);
+}
+
+TEST(MemoryRecyclerTest, RecyclingNullIsANoOp) {
+    MemoryRecycler recycler(kMaxPooledBytes, kLongIdleTimeout);
+    recycler.recycle(std::unique_ptr<MemoryAshmem>());
+    recycler.recycle(std::unique_ptr<MemoryRuntimeAHWB>());
+    EXPECT_EQ(recycler.getPooledBytes(), 0u);
+}
+
+}  // namespace
+}  // namespace android::nn
@@ -146,6 +146,16 @@ class Model {
         }
     }
 
+    // Preallocates room for the given total numbers of operands and operations.
+    Result reserve(uint32_t operandCount, uint32_t operationCount) {
+        if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+            return static_cast<Result>(
+                    ANeuralNetworksModel_reserve(mModel, operandCount, operationCount));
+        } else {
+            return Result::FEATURE_LEVEL_TOO_LOW;
+        }
+    }
+
     uint32_t addOperand(const OperandType* type) {
         if (ANeuralNetworksModel_addOperand(mModel, &(type->operandType)) !=
             ANEURALNETWORKS_NO_ERROR) {
@@ -310,6 +320,15 @@ class Compilation {
                 mCompilation, cacheDir.c_str(), token.data()));
     }
 
+    Result setPipelineDepth(uint32_t depth) {
+        if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+            return static_cast<Result>(
+                    ANeuralNetworksCompilation_setPipelineDepth(mCompilation, depth));
+        } else {
+            return Result::FEATURE_LEVEL_TOO_LOW;
+        }
+    }
+
     Result finish() { return static_cast<Result>(ANeuralNetworksCompilation_finish(mCompilation)); }
 
     Result getPreferredMemoryAlignmentForInput(uint32_t index, uint32_t* alignment) const {
@@ -434,6 +453,14 @@ class Execution {
         return static_cast<Result>(ANeuralNetworksExecution_setLoopTimeout(mExecution, duration));
     }
 
+    Result cancel() {
+        if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+            return static_cast<Result>(ANeuralNetworksExecution_cancel(mExecution));
+        } else {
+            return Result::FEATURE_LEVEL_TOO_LOW;
+        }
+    }
+
     Result enableInputAndOutputPadding(bool enable) {
         if (__builtin_available(android __NNAPI_FL5_MIN_ANDROID_API__, *)) {
             return static_cast<Result>(
@@ -19,6 +19,7 @@
 #include <SampleDriver.h>
 #include <Utils.h>
 #include <ValidateHal.h>
+#include <android-base/file.h>
 #include <gtest/gtest.h>
 
 #include <algorithm>
@@ -42,6 +43,8 @@
 #include "ModelBuilder.h"
 #include "NeuralNetworks.h"
 #include "NeuralNetworksOEM.h"
+#include "PartitioningPlanCache.h"
+#include "PartitioningProfile.h"
 #include "TestNeuralNetworksWrapper.h"
 
 // Uncomment the following line to generate some debugging output that
@@ -155,6 +158,7 @@ namespace V1_3 = ::android::hardware::neuralnetworks::V1_3;
 using CompilationBuilder = ::android::nn::CompilationBuilder;
 using Device = ::android::nn::Device;
 using DeviceManager = ::android::nn::DeviceManager;
+using Duration = ::android::nn::Duration;
 using ExecutePreference = ::android::nn::test_wrapper::ExecutePreference;
 using ExecutePriority = ::android::nn::test_wrapper::ExecutePriority;
 using ExecutionPlan = ::android::nn::ExecutionPlan;
@@ -168,6 +172,8 @@ using ModelBuilder = ::android::nn::ModelBuilder;
 using Operand = ::android::nn::Operand;
 using Operation = ::android::nn::Operation;
 using OptionalTimePoint = ::android::nn::OptionalTimePoint;
+using PartitioningPlanCache = ::android::nn::PartitioningPlanCache;
+using PartitioningProfile = ::android::nn::PartitioningProfile;
 using Result = ::android::nn::test_wrapper::Result;
 using SampleDriver = ::android::nn::sample_driver::SampleDriver;
 using SharedDevice = ::android::nn::SharedDevice;
@@ -826,10 +832,12 @@ class PartitioningModel : private WrapperModel {
     // Run the partitioning algorithm to create an ExecutionPlan.
     int partitionTheWork(const std::vector<std::shared_ptr<Device>>& devices,
                          ExecutePreference preference, ExecutePriority priority,
-                         const OptionalTimePoint& deadline, ExecutionPlan* plan) {
+                         const OptionalTimePoint& deadline, ExecutionPlan* plan,
+                         bool useCostModel = false) {
         return reinterpret_cast<ModelBuilder*>(getHandle())
                 ->partitionTheWork(devices, static_cast<uint32_t>(preference),
-                                   static_cast<int32_t>(priority), deadline, plan);
+                                   static_cast<int32_t>(priority), deadline, plan,
+                                   ANEURALNETWORKS_NO_ERROR, useCostModel);
     }
 
 #ifdef VERBOSE
@@ -1974,6 +1982,208 @@ TEST_F(PartitioningTest, SetPartitioning) {
     ASSERT_EQ(cPWithoutFallback.getExecutionPlan().forTest_getKind(), ExecutionPlan::Kind::ERROR);
 }
 
+TEST_F(PartitioningTest, CostModel) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // "fast" is the best device for operations 0 and 2, and "all" is the best
+    // device for operation 1.
+    const auto devices = makeDevices({{"fast", 0.5, 1 << 0}, {"all", 0.6, ~0U}});
+
+    // Choosing the best device for each operation independently alternates
+    // between the two devices.
+    ExecutionPlan planPerOperation;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                     ExecutePriority::DEFAULT, {}, &planPerOperation),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(planPerOperation.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    const auto& steps = planPerOperation.forTest_compoundGetSteps();
+    ASSERT_EQ(steps.size(), size_t(3));
+    EXPECT_EQ(steps[0]->executionStep()->getDevice()->getName(), "fast");
+    EXPECT_EQ(steps[1]->executionStep()->getDevice()->getName(), "all");
+    EXPECT_EQ(steps[2]->executionStep()->getDevice()->getName(), "fast");
+
+    // The cost model finds that the two additional steps and the operands
+    // passed between them cost more than "fast" saves.
+    ExecutionPlan planCostModel;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                     ExecutePriority::DEFAULT, {}, &planCostModel,
+                                     /*useCostModel=*/true),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(planCostModel.forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+    EXPECT_EQ(planCostModel.forTest_simpleGetDevice()->getName(), "all");
+
+    // The cost model is selected through the partitioning setting.
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback |
+                                          DeviceManager::kPartitioningCostModel),
+              Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    ASSERT_EQ(compilation.getExecutionPlan().forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+    EXPECT_EQ(compilation.getExecutionPlan().forTest_simpleGetDevice()->getName(), "all");
+}
+
+TEST_F(PartitioningTest, StepDependencies) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd0, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd2, opnd3});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // Two independent operations, each on its own device, can run concurrently.
+    const auto devices = makeDevices({{"0", 0.5, 1 << 0}, {"1", 0.5, 1 << 1}});
+    ExecutionPlan plan;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                     ExecutePriority::DEFAULT, {}, &plan),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    ASSERT_EQ(plan.forTest_compoundGetSteps().size(), size_t(2));
+    EXPECT_TRUE(plan.getStepDependencies(0).empty());
+    EXPECT_TRUE(plan.getStepDependencies(1).empty());
+    EXPECT_TRUE(plan.canRunStepsConcurrently());
+
+    // A chain of steps has to run one step at a time.
+    PartitioningModel chainModel;
+    uint32_t chainOpnd0 = chainModel.addFloatOperand();
+    uint32_t chainOpnd1 = chainModel.addFloatOperand();
+    uint32_t chainOpnd2 = chainModel.addOperation2To1V1_0(0, chainOpnd0, chainOpnd1);
+    uint32_t chainOpnd3 = chainModel.addOperation2To1V1_0(1, chainOpnd2, chainOpnd1);
+    chainModel.identifyInputsAndOutputs({chainOpnd0, chainOpnd1}, {chainOpnd3});
+    chainModel.finish();
+    ASSERT_TRUE(chainModel.isValid());
+    ExecutionPlan chainPlan;
+    ASSERT_EQ(chainModel.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                          ExecutePriority::DEFAULT, {}, &chainPlan),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(chainPlan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    ASSERT_EQ(chainPlan.forTest_compoundGetSteps().size(), size_t(2));
+    EXPECT_TRUE(chainPlan.getStepDependencies(0).empty());
+    EXPECT_EQ(chainPlan.getStepDependencies(1), std::vector<uint32_t>{0});
+    EXPECT_FALSE(chainPlan.canRunStepsConcurrently());
+}
+
+TEST_F(PartitioningTest, ConcurrentSteps) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(kFirstEncodingADD, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(kFirstEncodingMUL, opnd0, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(kFirstEncodingADD, opnd2, opnd3);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd2, opnd3, opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // The ADD and MUL of the model inputs are independent steps on different devices, and the
+    // final ADD depends on both of them.
+    const auto devices = makeDevices(
+            {{"add", 0.5, 1 << kFirstEncodingADD}, {"mul", 0.5, 1 << kFirstEncodingMUL}});
+    PartitioningCompilation compilation(&model, devices);
+    ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback),
+              Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    const ExecutionPlan& plan = compilation.getExecutionPlan();
+    ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    ASSERT_EQ(plan.forTest_compoundGetSteps().size(), size_t(3));
+    ASSERT_TRUE(plan.canRunStepsConcurrently());
+
+    const bool concurrentSteps = DeviceManager::get()->concurrentSteps();
+    for (bool concurrent : {false, true}) {
+        SCOPED_TRACE(concurrent ? "concurrent" : "sequential");
+        DeviceManager::get()->setConcurrentSteps(concurrent);
+        WrapperOperandType type(WrapperType::TENSOR_FLOAT32, {1});
+        const float input0 = 2.0f, input1 = 3.0f;
+        float output2 = -1.0f, output3 = -1.0f, output4 = -1.0f;
+        WrapperExecution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, &input0, &type.operandType), Result::NO_ERROR);
+        ASSERT_EQ(execution.setInput(1, &input1, &type.operandType), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, &output2, &type.operandType), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(1, &output3, &type.operandType), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(2, &output4, &type.operandType), Result::NO_ERROR);
+        const Result result = execution.compute();
+        DeviceManager::get()->setConcurrentSteps(concurrentSteps);
+        ASSERT_EQ(result, Result::NO_ERROR);
+        EXPECT_EQ(output2, 5.0f);
+        EXPECT_EQ(output3, 6.0f);
+        EXPECT_EQ(output4, 11.0f);
+    }
+}
+
+TEST_F(PartitioningTest, ConcurrentStepCompilations) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd4});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    const auto devices = makeDevices({{"0", 0.5, 1 << 0}, {"1", 0.5, 1 << 1}});
+    DeviceManager* deviceManager = DeviceManager::get();
+    const uint32_t maxConcurrentStepCompilations =
+            deviceManager->getMaxConcurrentStepCompilations();
+    for (uint32_t limit : {1u, 2u, 8u}) {
+        SCOPED_TRACE(limit);
+        deviceManager->setMaxConcurrentStepCompilations(limit);
+        ExecutionPlan plan;
+        ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                         ExecutePriority::DEFAULT, {}, &plan),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+        const auto& steps = plan.forTest_compoundGetSteps();
+        ASSERT_EQ(steps.size(), size_t(3));
+        for (const auto& step : steps) {
+            EXPECT_NE(step->executionStep()->getPreparedStepModel(), nullptr);
+        }
+    }
+    deviceManager->setMaxConcurrentStepCompilations(maxConcurrentStepCompilations);
+}
+
+TEST_F(PartitioningTest, PlannedTemporaries) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    uint32_t opnd4 = model.addOperation2To1V1_0(0, opnd3, opnd1);
+    uint32_t opnd5 = model.addOperation2To1V1_0(1, opnd4, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd5});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // A chain of four steps with a temporary between each pair of steps.
+    const auto devices = makeDevices({{"0", 0.5, 1 << 0}, {"1", 0.5, 1 << 1}});
+    ExecutionPlan plan;
+    ASSERT_EQ(model.partitionTheWork(devices, ExecutePreference::PREFER_LOW_POWER,
+                                     ExecutePriority::DEFAULT, {}, &plan),
+              ANEURALNETWORKS_NO_ERROR);
+    ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::COMPOUND);
+    ASSERT_EQ(plan.forTest_compoundGetSteps().size(), size_t(4));
+    const auto* locations = plan.forTest_compoundGetPlannedTemporaryLocations();
+    ASSERT_NE(locations, nullptr);
+    ASSERT_EQ(locations->size(), size_t(3));
+    const auto& location2 = locations->at({0, opnd2});
+    const auto& location3 = locations->at({0, opnd3});
+    const auto& location4 = locations->at({0, opnd4});
+
+    // opnd3 is written while opnd2 is read, and opnd4 while opnd3 is read.
+    EXPECT_NE(location2.offset, location3.offset);
+    EXPECT_NE(location3.offset, location4.offset);
+    // opnd4 is written after the last read of opnd2, so they can share memory.
+    EXPECT_EQ(location2.offset, location4.offset);
+}
+
 // Regression test for http://b/69166603:
 //     "partitioned compilation and execution yields wrong results when model output is step model
 //     input"
@@ -2208,8 +2418,11 @@ class DynamicTemporariesTest : public PartitioningTest {
     void declareHalVersions(HalVersion padDeviceVersion, HalVersion addDeviceVersion);
     void makeModelAndValidate();
     void compileModelAndComparePlan(bool noFallback = true);
+    // If "reusable" is true, computes a reusable execution twice, with
+    // different input values.
     void executeCompilationAndCompareOutput(bool opnd2ModelOutputBigEnough,
-                                            bool opnd4ModelOutputBigEnough);
+                                            bool opnd4ModelOutputBigEnough,
+                                            bool reusable = false);
 
     // set by declareOutputDimensions()
     bool mOpnd2ModelAndPartitionOutputSpecified = false;
@@ -2369,15 +2582,17 @@ void DynamicTemporariesTest::compileModelAndComparePlan(bool noFallback) {
 }
 
 void DynamicTemporariesTest::executeCompilationAndCompareOutput(bool opnd2ModelOutputBigEnough,
-                                                                bool opnd4ModelOutputBigEnough) {
+                                                                bool opnd4ModelOutputBigEnough,
+                                                                bool reusable) {
     ASSERT_TRUE(opnd2ModelOutputBigEnough || !mOpnd2ModelAndPartitionOutputSpecified);
     ASSERT_TRUE(opnd4ModelOutputBigEnough || !mOpnd4ModelOutputSpecified);
 
     ASSERT_TRUE(mCompilation.has_value());
     WrapperExecution e(&mCompilation.value());
+    ASSERT_EQ(e.setReusable(reusable), Result::NO_ERROR);
 
     WrapperOperandType padTensorValueType(WrapperType::TENSOR_FLOAT32, {2});
-    const float padTensorValue[] = {3.0f, 5.0f};
+    float padTensorValue[] = {3.0f, 5.0f};
     e.setInput(0, &padTensorValue, &padTensorValueType.operandType);
 
     WrapperOperandType paddingsType(WrapperType::TENSOR_INT32, {1, 2});
@@ -2404,16 +2619,23 @@ void DynamicTemporariesTest::executeCompilationAndCompareOutput(bool opnd2ModelO
     const Result expectResult = opnd2ModelOutputBigEnough && opnd4ModelOutputBigEnough
                                         ? Result::NO_ERROR
                                         : Result::OUTPUT_INSUFFICIENT_SIZE;
-    ASSERT_EQ(e.compute(), expectResult);
-    if (expectResult == Result::NO_ERROR) {
-        float expected[4] = {0.0f, padTensorValue[0], padTensorValue[1], 0.0f};
-        ASSERT_TRUE(std::equal(std::begin(opnd2ModelOutput), std::end(opnd2ModelOutput),
-                               std::begin(expected)));
-        for (auto& elt : expected) {
-            elt *= 2;
+    for (int computation = 0; computation < (reusable ? 2 : 1); computation++) {
+        SCOPED_TRACE(computation);
+        if (computation > 0) {
+            padTensorValue[0] += 1.0f;
+            padTensorValue[1] += 1.0f;
+        }
+        ASSERT_EQ(e.compute(), expectResult);
+        if (expectResult == Result::NO_ERROR) {
+            float expected[4] = {0.0f, padTensorValue[0], padTensorValue[1], 0.0f};
+            ASSERT_TRUE(std::equal(std::begin(opnd2ModelOutput), std::end(opnd2ModelOutput),
+                                   std::begin(expected)));
+            for (auto& elt : expected) {
+                elt *= 2;
+            }
+            ASSERT_TRUE(std::equal(std::begin(opnd4ModelOutput), std::end(opnd4ModelOutput),
+                                   std::begin(expected)));
         }
-        ASSERT_TRUE(std::equal(std::begin(opnd4ModelOutput), std::end(opnd4ModelOutput),
-                               std::begin(expected)));
     }
 }
 
@@ -2457,6 +2679,53 @@ TEST_F(DynamicTemporariesTest, DynamicTemporariesUnspecifiedOutputs) {
     ASSERT_NO_FATAL_FAILURE(executeCompilationAndCompareOutput(true, true));
 }
 
+TEST_F(DynamicTemporariesTest, DynamicTemporariesPooledAcrossExecutions) {
+    // The purpose of this test is to confirm that later executions start with
+    // the dynamic temporary lengths learned by earlier executions and reuse
+    // their memory.
+
+    ASSERT_NO_FATAL_FAILURE(makeModelAndValidate());
+    ASSERT_NO_FATAL_FAILURE(compileModelAndComparePlan());
+    const DynamicTemporariesPool* pool =
+            mCompilation->getExecutionPlan().forTest_compoundGetDynamicTemporariesPool();
+    ASSERT_NE(pool, nullptr);
+
+    ASSERT_NO_FATAL_FAILURE(executeCompilationAndCompareOutput(true, true));
+    const auto firstStats = pool->getStats();
+    EXPECT_GT(firstStats.allocations, 0u);
+    EXPECT_GE(pool->getPaddedLength({0, mOpnds[3]}), 4 * sizeof(float));
+
+    ASSERT_NO_FATAL_FAILURE(executeCompilationAndCompareOutput(true, true));
+    const auto secondStats = pool->getStats();
+    EXPECT_EQ(secondStats.allocations, firstStats.allocations);
+    EXPECT_EQ(secondStats.reuses, firstStats.reuses + 1);
+}
+
+TEST_F(DynamicTemporariesTest, ReusableExecutionWithoutDynamicTemporaries) {
+    // The purpose of this test is to confirm that a reusable execution of a
+    // partitioned model without dynamic temporaries, which keeps its step
+    // executors across computations, reads the current input values every
+    // time.
+
+    ASSERT_NO_FATAL_FAILURE(declareOutputDimensions(/*opnd2ModelAndPartitionOutputSpecified=*/true,
+                                                    /*opnd3PartitionOutputSpecified=*/true,
+                                                    /*opnd4ModelOutputSpecified=*/true));
+    ASSERT_NO_FATAL_FAILURE(makeModelAndValidate());
+    ASSERT_NO_FATAL_FAILURE(compileModelAndComparePlan());
+    ASSERT_FALSE(mCompilation->getExecutionPlan().hasDynamicTemporaries());
+    ASSERT_NO_FATAL_FAILURE(executeCompilationAndCompareOutput(true, true, /*reusable=*/true));
+}
+
+TEST_F(DynamicTemporariesTest, ReusableExecutionWithDynamicTemporaries) {
+    // The purpose of this test is to confirm that a reusable execution of a
+    // partitioned model with dynamic temporaries computes correctly more than
+    // once.
+
+    ASSERT_NO_FATAL_FAILURE(makeModelAndValidate());
+    ASSERT_NO_FATAL_FAILURE(compileModelAndComparePlan());
+    ASSERT_NO_FATAL_FAILURE(executeCompilationAndCompareOutput(true, true, /*reusable=*/true));
+}
+
 TEST_F(DynamicTemporariesTest, DynamicTemporariesSpecifiedOutputs) {
     // The purpose of this test is to confirm that the partitioner can produce
     // dynamic temporaries and that the runtime can handle them properly.  Note
@@ -2556,9 +2825,15 @@ class CacheTest : public PartitioningTest {
         char* cacheDir = mkdtemp(cacheDirTemp);
         ASSERT_NE(cacheDir, nullptr);
         mCacheDir = cacheDir;
+        // The test devices differ in the operations they support while having
+        // the same name and version, so a cached device assignment would be
+        // reused for devices it is not valid for.
+        mCachePartitioningPlans = DeviceManager::get()->cachePartitioningPlans();
+        DeviceManager::get()->setCachePartitioningPlans(false);
     }
 
     virtual void TearDown() override {
+        DeviceManager::get()->setCachePartitioningPlans(mCachePartitioningPlans);
         if (!::testing::Test::HasFailure()) {
             std::filesystem::remove_all(mCacheDir);
         }
@@ -2709,6 +2984,7 @@ class CacheTest : public PartitioningTest {
     }
 
     std::string mCacheDir;
+    bool mCachePartitioningPlans = true;
 };
 
 // Test the case when no token is provided by the application and the execution plan has a
@@ -3017,6 +3293,218 @@ TEST_F(CacheTest, CacheTokenDifferentReferenceModelPartitions) {
     expectUniqueTokens({tokenOut1, tokenOut2});
 }
 
+// Test that measurements recorded in the partitioning profile override the capabilities.
+TEST_F(CacheTest, ProfileGuidedPartitioning) {
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd3});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    // According to their capabilities, "a" is faster than "b".
+    const auto devices = makeDevices({{"a", 0.5, ~0U}, {"b", 0.8, ~0U}});
+    const std::vector<uint8_t> token(ANEURALNETWORKS_BYTE_SIZE_OF_CACHE_TOKEN, 0);
+    auto getPlanDeviceName = [&](std::string* deviceName) {
+        PartitioningCompilation compilation(&model, devices);
+        ASSERT_EQ(compilation.setCaching(mCacheDir, token), Result::NO_ERROR);
+        ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback |
+                                              DeviceManager::kPartitioningProfileGuided),
+                  Result::NO_ERROR);
+        ASSERT_EQ(compilation.setPreference(ExecutePreference::PREFER_FAST_SINGLE_ANSWER),
+                  Result::NO_ERROR);
+        ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+        const ExecutionPlan& plan = compilation.getExecutionPlan();
+        ASSERT_NE(plan.getProfile(), nullptr);
+        ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+        *deviceName = plan.forTest_simpleGetDevice()->getName();
+    };
+
+    std::string deviceName;
+    ASSERT_NO_FATAL_FAILURE(getPlanDeviceName(&deviceName));
+    EXPECT_EQ(deviceName, "a");
+
+    // The measurements say that "b" is faster. The profile is written when it is destroyed.
+    {
+        const auto profile =
+                PartitioningProfile::load(mCacheDir + "/", token.data(), /*operationCount=*/2);
+        profile->record(*devices[0], {0, 1}, std::chrono::milliseconds(10));
+        profile->record(*devices[1], {1, 0}, std::chrono::milliseconds(1));
+    }
+    ASSERT_NO_FATAL_FAILURE(getPlanDeviceName(&deviceName));
+    EXPECT_EQ(deviceName, "b");
+
+    // The profile is only used for the compilations that are cached with the same token.
+    PartitioningCompilation uncached(&model, devices);
+    ASSERT_EQ(uncached.setPartitioning(DeviceManager::kPartitioningWithoutFallback |
+                                       DeviceManager::kPartitioningProfileGuided),
+              Result::NO_ERROR);
+    ASSERT_EQ(uncached.setPreference(ExecutePreference::PREFER_FAST_SINGLE_ANSWER),
+              Result::NO_ERROR);
+    ASSERT_EQ(uncached.finish(), Result::NO_ERROR);
+    EXPECT_EQ(uncached.getExecutionPlan().getProfile(), nullptr);
+    ASSERT_EQ(uncached.getExecutionPlan().forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+    EXPECT_EQ(uncached.getExecutionPlan().forTest_simpleGetDevice()->getName(), "a");
+}
+
+// Test that a corrupt profile is ignored, without allocating for sizes read from it.
+TEST_F(CacheTest, CorruptPartitioningProfile) {
+    const std::vector<uint8_t> token(ANEURALNETWORKS_BYTE_SIZE_OF_CACHE_TOKEN, 0);
+    const std::string cacheDir = mCacheDir + "/";
+    const std::string fileName = ::android::nn::getPartitioningCacheFileName(
+            cacheDir, token.data(), "PartitioningProfile", '3');
+    auto countSteps = [&] {
+        size_t count = 0;
+        PartitioningProfile::load(cacheDir, token.data(), /*operationCount=*/2)
+                ->forEachStep([&count](const auto&...) { count++; });
+        return count;
+    };
+    const std::string header = "nnapi-partitioning-profile 1\n";
+
+    ASSERT_TRUE(android::base::WriteStringToFile(header + "1 1000 2 0 1 device 1\n", fileName));
+    EXPECT_EQ(countSteps(), 1u);
+    // More operations than the model has.
+    ASSERT_TRUE(android::base::WriteStringToFile(header + "1 1000 4294967295 0 1 device 1\n",
+                                                 fileName));
+    EXPECT_EQ(countSteps(), 0u);
+    // An operation that the model does not have.
+    ASSERT_TRUE(android::base::WriteStringToFile(header + "1 1000 1 2 device 1\n", fileName));
+    EXPECT_EQ(countSteps(), 0u);
+    // A truncated line.
+    ASSERT_TRUE(android::base::WriteStringToFile(header + "1 1000", fileName));
+    EXPECT_EQ(countSteps(), 0u);
+}
+
+// Test that profiles of the same compilations add up their measurements instead of overwriting
+// each other.
+TEST_F(CacheTest, MergePartitioningProfiles) {
+    const auto devices = makeDevices({{"a", 0.5, ~0U}, {"b", 0.8, ~0U}});
+    const std::vector<uint8_t> token(ANEURALNETWORKS_BYTE_SIZE_OF_CACHE_TOKEN, 0);
+    const std::string cacheDir = mCacheDir + "/";
+    {
+        const auto profile1 =
+                PartitioningProfile::load(cacheDir, token.data(), /*operationCount=*/2);
+        const auto profile2 =
+                PartitioningProfile::load(cacheDir, token.data(), /*operationCount=*/2);
+        profile1->record(*devices[0], {0, 1}, std::chrono::milliseconds(10));
+        profile2->record(*devices[0], {0, 1}, std::chrono::milliseconds(20));
+        profile2->record(*devices[1], {0, 1}, std::chrono::milliseconds(1));
+        ASSERT_TRUE(profile1->save());
+        ASSERT_TRUE(profile2->save());
+
+        // A profile that has written its measurements also picks up the ones of the other.
+        size_t count = 0;
+        profile2->forEachStep([&count](const auto&...) { count++; });
+        EXPECT_EQ(count, 2u);
+    }
+
+    std::map<std::string, Duration> meanDurations;
+    PartitioningProfile::load(cacheDir, token.data(), /*operationCount=*/2)
+            ->forEachStep([&meanDurations](const std::string& deviceKey,
+                                           const std::vector<uint32_t>& operations,
+                                           Duration meanDuration) {
+                EXPECT_EQ(operations, (std::vector<uint32_t>{0, 1}));
+                meanDurations[deviceKey] = meanDuration;
+            });
+    EXPECT_EQ(meanDurations,
+              (std::map<std::string, Duration>{
+                      {PartitioningProfile::getDeviceKey(*devices[0]),
+                       std::chrono::milliseconds(15)},
+                      {PartitioningProfile::getDeviceKey(*devices[1]),
+                       std::chrono::milliseconds(1)}}));
+}
+
+// Test that the device assignment is cached and reused for the same devices and settings.
+TEST_F(CacheTest, PartitioningPlanCache) {
+    DeviceManager::get()->setCachePartitioningPlans(true);
+    PartitioningModel model;
+    uint32_t opnd0 = model.addFloatOperand();
+    uint32_t opnd1 = model.addFloatOperand();
+    uint32_t opnd2 = model.addOperation2To1V1_0(0, opnd0, opnd1);
+    uint32_t opnd3 = model.addOperation2To1V1_0(1, opnd2, opnd1);
+    model.identifyInputsAndOutputs({opnd0, opnd1}, {opnd3});
+    model.finish();
+    ASSERT_TRUE(model.isValid());
+
+    const std::vector<uint8_t> token(ANEURALNETWORKS_BYTE_SIZE_OF_CACHE_TOKEN, 0);
+    auto getPlanDeviceName = [&](const std::vector<std::shared_ptr<Device>>& devices,
+                                 ExecutePreference preference, std::string* deviceName) {
+        PartitioningCompilation compilation(&model, devices);
+        ASSERT_EQ(compilation.setCaching(mCacheDir, token), Result::NO_ERROR);
+        ASSERT_EQ(compilation.setPartitioning(DeviceManager::kPartitioningWithoutFallback),
+                  Result::NO_ERROR);
+        ASSERT_EQ(compilation.setPreference(preference), Result::NO_ERROR);
+        ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+        const ExecutionPlan& plan = compilation.getExecutionPlan();
+        EXPECT_EQ(plan.getPlanCache(), nullptr);
+        ASSERT_EQ(plan.forTest_getKind(), ExecutionPlan::Kind::SIMPLE);
+        *deviceName = plan.forTest_simpleGetDevice()->getName();
+    };
+
+    // According to their capabilities, "a" is faster than "b".
+    const auto devices = makeDevices({{"a", 0.5, ~0U}, {"b", 0.8, ~0U}});
+    std::string deviceName;
+    ASSERT_NO_FATAL_FAILURE(
+            getPlanDeviceName(devices, ExecutePreference::PREFER_FAST_SINGLE_ANSWER, &deviceName));
+    EXPECT_EQ(deviceName, "a");
+    auto loadAssignment = [&](std::vector<int>* assignment) {
+        const auto planCache = PartitioningPlanCache::load(
+                mCacheDir + "/", token.data(),
+                PartitioningPlanCache::makeKey(devices, ANEURALNETWORKS_PREFER_FAST_SINGLE_ANSWER,
+                                               ANEURALNETWORKS_PRIORITY_DEFAULT,
+                                               DeviceManager::kPartitioningWithoutFallback),
+                /*maxOperationCount=*/2);
+        ASSERT_NE(planCache->getAssignment(/*sourceModelIndex=*/0), nullptr);
+        *assignment = *planCache->getAssignment(/*sourceModelIndex=*/0);
+    };
+    std::vector<int> assignment;
+    ASSERT_NO_FATAL_FAILURE(loadAssignment(&assignment));
+    EXPECT_EQ(assignment, std::vector<int>({0, 0}));
+
+    // The drivers are not asked again: devices with the same names and
+    // versions are assumed to have the same capabilities, so "a" keeps the
+    // whole model although it is now slower than "b".
+    const auto slowerDevices = makeDevices({{"a", 0.9, ~0U}, {"b", 0.8, ~0U}});
+    ASSERT_NO_FATAL_FAILURE(getPlanDeviceName(
+            slowerDevices, ExecutePreference::PREFER_FAST_SINGLE_ANSWER, &deviceName));
+    EXPECT_EQ(deviceName, "a");
+
+    // A cached assignment that fails to compile is replaced by a fresh one.
+    const auto unsupportedDevices = makeDevices({{"a", 0.5, 0U}, {"b", 0.8, ~0U}});
+    ASSERT_NO_FATAL_FAILURE(getPlanDeviceName(
+            unsupportedDevices, ExecutePreference::PREFER_FAST_SINGLE_ANSWER, &deviceName));
+    EXPECT_EQ(deviceName, "b");
+    ASSERT_NO_FATAL_FAILURE(loadAssignment(&assignment));
+    EXPECT_EQ(assignment, std::vector<int>({1, 1}));
+
+    // Other settings invalidate the cached assignment.
+    ASSERT_NO_FATAL_FAILURE(
+            getPlanDeviceName(slowerDevices, ExecutePreference::PREFER_LOW_POWER, &deviceName));
+    EXPECT_EQ(deviceName, "b");
+}
+
+// Test that a cached assignment for more operations than any source model has
+// is ignored.
+TEST_F(CacheTest, CorruptPartitioningPlanCache) {
+    const std::vector<uint8_t> token(ANEURALNETWORKS_BYTE_SIZE_OF_CACHE_TOKEN, 0);
+    const auto devices = makeDevices({{"a", 0.5, ~0U}});
+    const std::string key = PartitioningPlanCache::makeKey(
+            devices, ANEURALNETWORKS_PREFER_FAST_SINGLE_ANSWER, ANEURALNETWORKS_PRIORITY_DEFAULT,
+            DeviceManager::kPartitioningWithoutFallback);
+    const std::string cacheDir = mCacheDir + "/";
+    const std::string fileName = ::android::nn::getPartitioningCacheFileName(
+            cacheDir, token.data(), "PartitioningPlanCache", '4');
+    ASSERT_TRUE(android::base::WriteStringToFile(
+            "nnapi-partitioning-plan 1\n" + key + "\n0 2 0 0\n1 4000000000 0\n", fileName));
+    const auto planCache =
+            PartitioningPlanCache::load(cacheDir, token.data(), key, /*maxOperationCount=*/2);
+    ASSERT_NE(planCache->getAssignment(/*sourceModelIndex=*/0), nullptr);
+    EXPECT_EQ(*planCache->getAssignment(/*sourceModelIndex=*/0), std::vector<int>({0, 0}));
+    EXPECT_EQ(planCache->getAssignment(/*sourceModelIndex=*/1), nullptr);
+}
+
 // Very basic tests of some of the PerformanceInfo functionality.
 // Placed in this file because partitioning is the consumer of this functionality.
 class PerfTest : public ::testing::Test {};
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include "TestNeuralNetworksWrapper.h"
+#include "TestUtils.h"
 
 using namespace android::nn::test_wrapper;
 
@@ -226,6 +227,42 @@ TEST_F(TrivialTest, AddThree) {
     ASSERT_EQ(CompareMatrices(expected3b, actual), 0);
 }
 
+TEST_F(TrivialTest, AddTwoWithCpuBurst) {
+    const ANeuralNetworksDevice* cpuDevice = android::nn::getCpuDevice();
+    if (cpuDevice == nullptr) {
+        GTEST_SKIP();
+    }
+
+    Model modelAdd2;
+    CreateAddTwoTensorModel(&modelAdd2);
+    auto [result, compilation] = Compilation::createForDevice(&modelAdd2, cpuDevice);
+    ASSERT_EQ(result, Result::NO_ERROR);
+    ASSERT_EQ(compilation.finish(), Result::NO_ERROR);
+    ANeuralNetworksBurst* burst = nullptr;
+    ASSERT_EQ(ANeuralNetworksBurst_create(compilation.getHandle(), &burst),
+              ANEURALNETWORKS_NO_ERROR);
+    auto guard = android::base::make_scope_guard([burst] { ANeuralNetworksBurst_free(burst); });
+
+    // Computations of the same burst must not see stale state of earlier ones.
+    for (const Matrix3x4* input : {&matrix2, &matrix3, &matrix2}) {
+        Matrix3x4 expected;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                expected[i][j] = matrix1[i][j] + (*input)[i][j];
+            }
+        }
+        Matrix3x4 actual;
+        memset(&actual, 0, sizeof(actual));
+        Execution execution(&compilation);
+        ASSERT_EQ(execution.setInput(0, matrix1, sizeof(Matrix3x4)), Result::NO_ERROR);
+        ASSERT_EQ(execution.setInput(1, *input, sizeof(Matrix3x4)), Result::NO_ERROR);
+        ASSERT_EQ(execution.setOutput(0, actual, sizeof(Matrix3x4)), Result::NO_ERROR);
+        ASSERT_EQ(ANeuralNetworksExecution_burstCompute(execution.getHandle(), burst),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(CompareMatrices(expected, actual), 0);
+    }
+}
+
 TEST_F(TrivialTest, FencedAddThree) {
     Model modelAdd3;
     CreateAddThreeTensorModel(&modelAdd3, matrix3);
@@ -21,6 +21,8 @@
 #include <android-base/unique_fd.h>
 #include <android/sharedmem.h>
 
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <utility>
 
@@ -77,6 +79,25 @@ class TestAshmem {
     test_wrapper::Memory mMemory;
 };
 
+// Returns the CPU device, or nullptr if it is not listed. The CPU device is only listed in
+// debuggable builds, so tests that need it should be skipped when this returns nullptr.
+inline ANeuralNetworksDevice* getCpuDevice() {
+    uint32_t numDevices = 0;
+    if (ANeuralNetworks_getDeviceCount(&numDevices) != ANEURALNETWORKS_NO_ERROR) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < numDevices; i++) {
+        ANeuralNetworksDevice* device = nullptr;
+        const char* name = nullptr;
+        if (ANeuralNetworks_getDevice(i, &device) == ANEURALNETWORKS_NO_ERROR &&
+            ANeuralNetworksDevice_getName(device, &name) == ANEURALNETWORKS_NO_ERROR &&
+            name != nullptr && strcmp(name, "nnapi-reference") == 0) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
 }  // namespace android::nn
 
 #endif  // ANDROID_FRAMEWORKS_ML_NN_RUNTIME_TEST_TEST_UTILS_H
@@ -21,7 +21,9 @@
 #include <android/log.h>
 #include <android/sharedmem.h>
 #include <gtest/gtest.h>
+#include <poll.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <future>
@@ -446,6 +448,126 @@ TEST_F(ValidationTestModel, AddOperand) {
     EXPECT_EQ(ANeuralNetworksModel_addOperand(mModel, &floatType), ANEURALNETWORKS_BAD_STATE);
 }
 
+TEST_F(ValidationTestModel, AddOperands) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        ANeuralNetworksOperandType floatType{
+                .type = ANEURALNETWORKS_FLOAT32, .dimensionCount = 0, .dimensions = nullptr};
+        const ANeuralNetworksOperandType types[] = {floatType, floatType};
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(nullptr, 2, types),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(mModel, 2, nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(mModel, 0, nullptr), ANEURALNETWORKS_NO_ERROR);
+
+        // Either all operands are added or none is.
+        const ANeuralNetworksOperandType partlyInvalidTypes[] = {floatType, kInvalidTensorType1};
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(mModel, 2, partlyInvalidTypes),
+                  ANEURALNETWORKS_BAD_DATA);
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(mModel, 2, types), ANEURALNETWORKS_NO_ERROR);
+        mNumOperands += 2;
+        const float value = 1.0f;
+        EXPECT_EQ(ANeuralNetworksModel_setOperandValue(mModel, 1, &value, sizeof(value)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksModel_setOperandValue(mModel, 2, &value, sizeof(value)),
+                  ANEURALNETWORKS_BAD_DATA);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestModel, Reserve) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksModel_reserve(nullptr, 16, 8), ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksModel_reserve(mModel, 16, 8), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksModel_reserve(mModel, 0xFFFFFFFF, 8), ANEURALNETWORKS_BAD_DATA);
+
+        modelFinish();
+        // These should fail, as the model is already finished.
+        EXPECT_EQ(ANeuralNetworksModel_reserve(mModel, 16, 8), ANEURALNETWORKS_BAD_STATE);
+        EXPECT_EQ(ANeuralNetworksModel_addOperands(mModel, 0, nullptr),
+                  ANEURALNETWORKS_BAD_STATE);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestModel, ReferenceSharedBufferValues) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksModel_referenceSharedBufferValues(nullptr, true),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksModel_referenceSharedBufferValues(mModel, true),
+                  ANEURALNETWORKS_NO_ERROR);
+
+        // The constant is too large to be copied when it is set.
+        constexpr uint32_t kLength = 64;
+        static_assert(kLength * sizeof(float) >
+                      ANEURALNETWORKS_MAX_SIZE_OF_IMMEDIATELY_COPIED_VALUES);
+        void* buffer = nullptr;
+        ASSERT_EQ(ANeuralNetworks_allocateSharedBuffer(kLength * sizeof(float), &buffer),
+                  ANEURALNETWORKS_NO_ERROR);
+        float* constant = static_cast<float*>(buffer);
+        std::fill(constant, constant + kLength, 2.0f);
+
+        const uint32_t input = addTensorOperand(ANEURALNETWORKS_TENSOR_FLOAT32, {kLength});
+        const uint32_t value = addTensorOperand(ANEURALNETWORKS_TENSOR_FLOAT32, {kLength});
+        const uint32_t activation = addScalarOperand();
+        const uint32_t output = addTensorOperand(ANEURALNETWORKS_TENSOR_FLOAT32, {kLength});
+        const int32_t none = ANEURALNETWORKS_FUSED_NONE;
+        ASSERT_EQ(ANeuralNetworksModel_setOperandValue(mModel, value, constant,
+                                                       kLength * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(ANeuralNetworksModel_setOperandValue(mModel, activation, &none, sizeof(none)),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(addOperation(ANEURALNETWORKS_ADD, {input, value, activation}, {output}),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(identifyInputsAndOutputs({input}, {output}), ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(modelFinish(), ANEURALNETWORKS_NO_ERROR);
+        // This should fail, as the model is already finished.
+        EXPECT_EQ(ANeuralNetworksModel_referenceSharedBufferValues(mModel, false),
+                  ANEURALNETWORKS_BAD_STATE);
+
+        ANeuralNetworksCompilation* compilation = nullptr;
+        ASSERT_EQ(ANeuralNetworksCompilation_create(mModel, &compilation),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(ANeuralNetworksCompilation_finish(compilation), ANEURALNETWORKS_NO_ERROR);
+        ANeuralNetworksExecution* execution = nullptr;
+        ASSERT_EQ(ANeuralNetworksExecution_create(compilation, &execution),
+                  ANEURALNETWORKS_NO_ERROR);
+        std::vector<float> inputData(kLength, 1.0f), outputData(kLength);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(execution, 0, nullptr, inputData.data(),
+                                                    kLength * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setOutput(execution, 0, nullptr, outputData.data(),
+                                                     kLength * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_compute(execution), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(outputData, std::vector<float>(kLength, 3.0f));
+
+        // The shared buffer must outlive the model.
+        ANeuralNetworksExecution_free(execution);
+        ANeuralNetworksCompilation_free(compilation);
+        ANeuralNetworksModel_free(mModel);
+        mModel = nullptr;
+        ANeuralNetworks_freeSharedBuffer(buffer);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestModel, ShareLargeValues) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksModel_shareLargeValues(nullptr, true),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksModel_shareLargeValues(mModel, true), ANEURALNETWORKS_NO_ERROR);
+        createModel();
+        // This should fail, as the model is already finished.
+        EXPECT_EQ(ANeuralNetworksModel_shareLargeValues(mModel, false),
+                  ANEURALNETWORKS_BAD_STATE);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
 TEST_F(ValidationTestModel, SetOperandSymmPerChannelQuantParams) {
     const int32_t operandIndex = addTensorOperand(ANEURALNETWORKS_TENSOR_QUANT8_SYMM_PER_CHANNEL);
 
@@ -1146,6 +1268,33 @@ TEST_F(ValidationTestCompilation, SetTimeout) {
               ANEURALNETWORKS_BAD_DATA);
 }
 
+TEST_F(ValidationTestCompilation, SetPipelineDepth) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksCompilation_setPipelineDepth(nullptr, 2),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompilation_setPipelineDepth(mCompilation, 2),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksCompilation_setPipelineDepth(mCompilation, 0),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksCompilation_finish(mCompilation), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksCompilation_setPipelineDepth(mCompilation, 2),
+                  ANEURALNETWORKS_BAD_STATE);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestCompilation, Warm) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksCompilation_warm(nullptr), ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompilation_warm(mCompilation), ANEURALNETWORKS_BAD_STATE);
+        EXPECT_EQ(ANeuralNetworksCompilation_finish(mCompilation), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksCompilation_warm(mCompilation), ANEURALNETWORKS_NO_ERROR);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
 TEST_F(ValidationTestCompilation, GetPreferredMemoryAlignmentAndPadding) {
     if (__builtin_available(android __NNAPI_FL5_MIN_ANDROID_API__, *)) {
         uint32_t result;
@@ -2240,6 +2389,208 @@ TEST_F(ValidationTestExecution, Compute) {
     EXPECT_EQ(ANeuralNetworksExecution_compute(nullptr), ANEURALNETWORKS_UNEXPECTED_NULL);
 }
 
+TEST_F(ValidationTestExecution, ComputeBatch) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        ANeuralNetworksExecution* execution;
+        ASSERT_EQ(ANeuralNetworksExecution_create(mCompilation, &execution),
+                  ANEURALNETWORKS_NO_ERROR);
+        float input0[] = {1.0f, 1.0f}, input1[] = {2.0f, 2.0f}, output0[2], output1[2];
+        int32_t input2[] = {0};
+        const auto setArguments = [&](ANeuralNetworksExecution* e, float* output) {
+            EXPECT_EQ(ANeuralNetworksExecution_setInput(e, 0, nullptr, input0, sizeof(input0)),
+                      ANEURALNETWORKS_NO_ERROR);
+            EXPECT_EQ(ANeuralNetworksExecution_setInput(e, 1, nullptr, input1, sizeof(input1)),
+                      ANEURALNETWORKS_NO_ERROR);
+            EXPECT_EQ(ANeuralNetworksExecution_setInput(e, 2, nullptr, input2, sizeof(input2)),
+                      ANEURALNETWORKS_NO_ERROR);
+            EXPECT_EQ(ANeuralNetworksExecution_setOutput(e, 0, nullptr, output, 2 * sizeof(float)),
+                      ANEURALNETWORKS_NO_ERROR);
+        };
+        setArguments(execution, output0);
+
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(nullptr, 1),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        ANeuralNetworksExecution* withNull[] = {execution, nullptr};
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(withNull, 2),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(nullptr, 0), ANEURALNETWORKS_NO_ERROR);
+
+        // This should fail, because the execution appears twice.
+        ANeuralNetworksExecution* duplicated[] = {execution, execution};
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(duplicated, 2), ANEURALNETWORKS_BAD_DATA);
+
+        // This should fail without computing "execution", because the inputs and outputs of
+        // mExecution have not been specified.
+        ANeuralNetworksExecution* unspecified[] = {execution, mExecution};
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(unspecified, 2),
+                  ANEURALNETWORKS_BAD_DATA);
+
+        // This should fail, because the executions belong to different compilations.
+        ANeuralNetworksCompilation* otherCompilation;
+        ASSERT_EQ(ANeuralNetworksCompilation_create(mModel, &otherCompilation),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(ANeuralNetworksCompilation_finish(otherCompilation), ANEURALNETWORKS_NO_ERROR);
+        ANeuralNetworksExecution* otherExecution;
+        ASSERT_EQ(ANeuralNetworksExecution_create(otherCompilation, &otherExecution),
+                  ANEURALNETWORKS_NO_ERROR);
+        setArguments(otherExecution, output1);
+        ANeuralNetworksExecution* mixed[] = {execution, otherExecution};
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(mixed, 2), ANEURALNETWORKS_BAD_DATA);
+        ANeuralNetworksExecution_free(otherExecution);
+        ANeuralNetworksCompilation_free(otherCompilation);
+
+        setArguments(mExecution, output1);
+        ANeuralNetworksExecution* batch[] = {execution, mExecution};
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(batch, 2), ANEURALNETWORKS_NO_ERROR);
+        for (float* output : {output0, output1}) {
+            EXPECT_EQ(output[0], 3.0f);
+            EXPECT_EQ(output[1], 3.0f);
+        }
+
+        // This should fail, because the executions are not reusable and have completed.
+        EXPECT_EQ(ANeuralNetworksExecution_computeBatch(batch, 2), ANEURALNETWORKS_BAD_STATE);
+
+        ANeuralNetworksExecution_free(execution);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestExecution, CompletionQueue) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_create(nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        ANeuralNetworksCompletionQueue* queue;
+        ASSERT_EQ(ANeuralNetworksCompletionQueue_create(&queue), ANEURALNETWORKS_NO_ERROR);
+        int fd = -1;
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_getFd(nullptr, &fd),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_getFd(queue, nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        ASSERT_EQ(ANeuralNetworksCompletionQueue_getFd(queue, &fd), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_GE(fd, 0);
+
+        ANeuralNetworksExecution* executions[2];
+        int resultCodes[2];
+        uint32_t count = 0;
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(nullptr, executions, resultCodes, 2,
+                                                         &count),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(queue, nullptr, resultCodes, 2, &count),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(queue, executions, nullptr, 2, &count),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(queue, executions, resultCodes, 2,
+                                                         nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(queue, executions, resultCodes, 2, &count),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(count, 0u);
+
+        EXPECT_EQ(ANeuralNetworksExecution_startComputeWithCompletionQueue(nullptr, queue),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworksExecution_startComputeWithCompletionQueue(mExecution, nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+
+        float input0[] = {1.0f, 1.0f}, input1[] = {2.0f, 2.0f}, output0[2];
+        int32_t input2[] = {0};
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 0, nullptr, input0, sizeof(input0)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 1, nullptr, input1, sizeof(input1)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 2, nullptr, input2, sizeof(input2)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(
+                ANeuralNetworksExecution_setOutput(mExecution, 0, nullptr, output0, sizeof(output0)),
+                ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(ANeuralNetworksExecution_startComputeWithCompletionQueue(mExecution, queue),
+                  ANEURALNETWORKS_NO_ERROR);
+
+        // The file descriptor becomes readable once the execution has completed.
+        pollfd pfd = {.fd = fd, .events = POLLIN};
+        ASSERT_EQ(poll(&pfd, 1, /*timeout=*/-1), 1);
+        EXPECT_EQ(ANeuralNetworksCompletionQueue_dequeue(queue, executions, resultCodes, 2, &count),
+                  ANEURALNETWORKS_NO_ERROR);
+        ASSERT_EQ(count, 1u);
+        EXPECT_EQ(executions[0], mExecution);
+        EXPECT_EQ(resultCodes[0], ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(output0[0], 3.0f);
+        EXPECT_EQ(output0[1], 3.0f);
+
+        // The file descriptor is no longer readable once the queue is empty.
+        EXPECT_EQ(poll(&pfd, 1, /*timeout=*/0), 0);
+
+        ANeuralNetworksCompletionQueue_free(queue);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestExecution, Cancel) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        EXPECT_EQ(ANeuralNetworksExecution_cancel(nullptr), ANEURALNETWORKS_UNEXPECTED_NULL);
+
+        // Cancelling an execution that is not in flight has no effect.
+        EXPECT_EQ(ANeuralNetworksExecution_cancel(mExecution), ANEURALNETWORKS_NO_ERROR);
+        float input0[] = {1.0f, 1.0f}, input1[] = {2.0f, 2.0f}, output[2];
+        int32_t input2[] = {0};
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 0, nullptr, input0, sizeof(input0)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 1, nullptr, input1, sizeof(input1)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 2, nullptr, input2, sizeof(input2)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setOutput(mExecution, 0, nullptr, output,
+                                                     sizeof(output)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_compute(mExecution), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_cancel(mExecution), ANEURALNETWORKS_NO_ERROR);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
+TEST_F(ValidationTestExecution, SharedBuffer) {
+    if (__builtin_available(android __ANDROID_API_FUTURE__, *)) {
+        void* buffer = nullptr;
+        EXPECT_EQ(ANeuralNetworks_allocateSharedBuffer(16, nullptr),
+                  ANEURALNETWORKS_UNEXPECTED_NULL);
+        EXPECT_EQ(ANeuralNetworks_allocateSharedBuffer(0, &buffer), ANEURALNETWORKS_BAD_DATA);
+        ASSERT_EQ(ANeuralNetworks_allocateSharedBuffer(32, &buffer), ANEURALNETWORKS_NO_ERROR);
+        ASSERT_NE(buffer, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer) % getpagesize(), 0u);
+
+        // The arguments are passed as offsets in the shared buffer.
+        float* input0 = static_cast<float*>(buffer);
+        float* input1 = input0 + 2;
+        int32_t* input2 = reinterpret_cast<int32_t*>(input0 + 4);
+        float* output = input0 + 6;
+        input0[0] = input0[1] = 1.0f;
+        input1[0] = input1[1] = 2.0f;
+        input2[0] = 0;
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 0, nullptr, input0,
+                                                    2 * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 1, nullptr, input1,
+                                                    2 * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setInput(mExecution, 2, nullptr, input2,
+                                                    sizeof(int32_t)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_setOutput(mExecution, 0, nullptr, output,
+                                                     2 * sizeof(float)),
+                  ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(ANeuralNetworksExecution_compute(mExecution), ANEURALNETWORKS_NO_ERROR);
+        EXPECT_EQ(output[0], 3.0f);
+        EXPECT_EQ(output[1], 3.0f);
+
+        ANeuralNetworks_freeSharedBuffer(buffer);
+        ANeuralNetworks_freeSharedBuffer(nullptr);
+    } else {
+        GTEST_SKIP();
+    }
+}
+
 TEST_F(ValidationTestExecution, StartCompute) {
     ANeuralNetworksExecution* execution;
     EXPECT_EQ(ANeuralNetworksExecution_create(mCompilation, &execution), ANEURALNETWORKS_NO_ERROR);